@@ -0,0 +1,100 @@
+#include "BVH.hpp"
+
+#include <algorithm>
+
+void BVH::AABB::expand(AABB const &other) {
+	for (uint32_t a = 0; a < 3; ++a) {
+		min[a] = std::min(min[a], other.min[a]);
+		max[a] = std::max(max[a], other.max[a]);
+	}
+}
+
+void BVH::build(std::vector< AABB > const &bounds) {
+	item_bounds = bounds;
+	item_leaf.assign(bounds.size(), 0);
+	items.resize(bounds.size());
+	for (uint32_t i = 0; i < uint32_t(items.size()); ++i) {
+		items[i] = i;
+	}
+
+	nodes.clear();
+	if (items.empty()) return;
+	nodes.reserve(2 * (items.size() / LeafSize + 1));
+	build_node(-1U, 0, uint32_t(items.size()));
+
+	node_dirty.assign(nodes.size(), 0);
+}
+
+uint32_t BVH::build_node(uint32_t parent, uint32_t first, uint32_t count) {
+	uint32_t index = uint32_t(nodes.size());
+	nodes.emplace_back(Node{
+		.parent = parent,
+		.first = first,
+		.count = count,
+	});
+
+	AABB centers; // bounds of the item centers, to pick a split axis
+	for (uint32_t i = first; i < first + count; ++i) {
+		AABB const &box = item_bounds[items[i]];
+		nodes[index].bounds.expand(box);
+		AABB center;
+		for (uint32_t a = 0; a < 3; ++a) {
+			center.min[a] = center.max[a] = 0.5f * (box.min[a] + box.max[a]);
+		}
+		centers.expand(center);
+	}
+
+	if (count <= LeafSize) {
+		for (uint32_t i = first; i < first + count; ++i) {
+			item_leaf[items[i]] = index;
+		}
+		return index;
+	}
+
+	// split at the median center along the widest axis (always halves the items, so the tree stays balanced):
+	uint32_t axis = 0;
+	for (uint32_t a = 1; a < 3; ++a) {
+		if (centers.max[a] - centers.min[a] > centers.max[axis] - centers.min[axis]) axis = a;
+	}
+	uint32_t half = count / 2;
+	std::nth_element(items.begin() + first, items.begin() + first + half, items.begin() + first + count, [&](uint32_t a, uint32_t b) {
+		return item_bounds[a].min[axis] + item_bounds[a].max[axis] < item_bounds[b].min[axis] + item_bounds[b].max[axis];
+	});
+
+	build_node(index, first, half); // always index + 1
+	uint32_t right = build_node(index, first + half, count - half);
+	nodes[index].right = right; // (nodes may have been re-allocated, so no references held across the recursion)
+	return index;
+}
+
+void BVH::refit_node(Node &node) {
+	node.bounds = AABB();
+	if (node.right == 0) {
+		for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+			node.bounds.expand(item_bounds[items[i]]);
+		}
+	} else {
+		node.bounds.expand(nodes[&node - nodes.data() + 1].bounds);
+		node.bounds.expand(nodes[node.right].bounds);
+	}
+}
+
+void BVH::refit(std::vector< uint32_t > const &moved) {
+	if (nodes.empty()) return;
+
+	// mark every node on the paths from the moved items' leaves to the root (stopping where paths join):
+	dirty_nodes.clear();
+	for (uint32_t item : moved) {
+		for (uint32_t n = item_leaf[item]; n != -1U && !node_dirty[n]; n = nodes[n].parent) {
+			node_dirty[n] = 1;
+			dirty_nodes.emplace_back(n);
+		}
+	}
+
+	// children come after parents in preorder, so going from high to low indices refits children first:
+	std::sort(dirty_nodes.begin(), dirty_nodes.end(), std::greater< uint32_t >());
+	for (uint32_t n : dirty_nodes) {
+		refit_node(nodes[n]);
+		node_dirty[n] = 0;
+	}
+}
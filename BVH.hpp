@@ -0,0 +1,82 @@
+#pragma once
+
+// A bounding volume hierarchy over axis-aligned boxes, used to frustum-cull whole groups of scene instances at once.
+// Built once by splitting at the median along the widest axis; when items move, refit() only recomputes the boxes on their paths to the root.
+
+#include "mat4.hpp"
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+struct BVH {
+	struct AABB {
+		vec3 min{ std::numeric_limits< float >::infinity(), std::numeric_limits< float >::infinity(), std::numeric_limits< float >::infinity() };
+		vec3 max{ -std::numeric_limits< float >::infinity(), -std::numeric_limits< float >::infinity(), -std::numeric_limits< float >::infinity() };
+		void expand(AABB const &other); // grow to also contain other
+	};
+
+	struct Node {
+		AABB bounds;
+		uint32_t parent = -1U;
+		uint32_t right = 0; // second child (the first is always the next node); 0 for leaves, since the root is never a child
+		uint32_t first = 0; // items[first, first + count) are everything under this node (for leaves and inner nodes alike)
+		uint32_t count = 0;
+	};
+	std::vector< Node > nodes; // preorder, so children always come after their parent
+	std::vector< uint32_t > items; // item ids, in leaf order
+	std::vector< AABB > item_bounds; // by item id
+	std::vector< uint32_t > item_leaf; // by item id: the leaf holding it
+
+	static constexpr uint32_t LeafSize = 4; // max items per leaf
+
+	// (re)build over items 0 .. bounds.size()-1:
+	void build(std::vector< AABB > const &bounds);
+
+	// recompute the boxes above items whose item_bounds were changed (ids may repeat):
+	void refit(std::vector< uint32_t > const &moved);
+
+	enum Visibility {
+		Outside, // skip the whole subtree
+		Intersecting, // look at the children (or, for a leaf, each item)
+		Inside, // take every item in the subtree without further tests
+	};
+
+	// walks the tree top-down, calling classify(node bounds) for each node reached.
+	// Calls emit(item, inside) for every item not rejected, where inside says an ancestor was classified as Inside (so the item needs no test of its own).
+	// Returns the number of nodes classified.
+	template< typename Classify, typename Emit >
+	uint32_t traverse(Classify &&classify, Emit &&emit) const {
+		if (nodes.empty()) return 0;
+		uint32_t tested = 0;
+
+		// median splits keep the tree balanced, so the stack only needs ~log2(items / LeafSize) entries:
+		std::array< uint32_t, 64 > stack;
+		uint32_t top = 0;
+		stack[top++] = 0;
+		while (top > 0) {
+			Node const &node = nodes[stack[--top]];
+			tested += 1;
+
+			Visibility visibility = classify(node.bounds);
+			if (visibility == Outside) continue;
+			if (visibility == Inside || node.right == 0) {
+				for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+					emit(items[i], visibility == Inside);
+				}
+				continue;
+			}
+
+			stack[top++] = node.right;
+			stack[top++] = uint32_t(&node - nodes.data()) + 1;
+		}
+		return tested;
+	}
+
+private:
+	uint32_t build_node(uint32_t parent, uint32_t first, uint32_t count); // returns the new node's index
+	void refit_node(Node &node);
+	std::vector< uint8_t > node_dirty; // scratch for refit
+	std::vector< uint32_t > dirty_nodes; // scratch for refit
+};
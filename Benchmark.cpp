@@ -0,0 +1,81 @@
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+// strings in the results are file names and device names, so only quotes, backslashes, and control characters need escaping:
+static void write_json_string(std::ostream &out, std::string const &str) {
+	static char const *hex = "0123456789abcdef";
+	out << '"';
+	for (char c : str) {
+		if (c == '"' || c == '\\') {
+			out << '\\' << c;
+		} else if (uint8_t(c) < 0x20) {
+			out << "\\u00" << hex[uint8_t(c) >> 4] << hex[uint8_t(c) & 0xf];
+		} else {
+			out << c;
+		}
+	}
+	out << '"';
+}
+
+// percentiles use the nearest-rank method, so every reported number is an actual sample:
+static void write_series(std::ostream &out, std::vector< double > const &samples) {
+	if (samples.empty()) {
+		out << "null";
+		return;
+	}
+
+	std::vector< double > sorted = samples;
+	std::sort(sorted.begin(), sorted.end());
+	auto percentile = [&](double p) {
+		size_t rank = size_t(std::ceil(p * double(sorted.size())));
+		return sorted[std::clamp< size_t >(rank, 1, sorted.size()) - 1];
+	};
+	double sum = 0.0;
+	for (double s : sorted) sum += s;
+
+	out << "{ \"min\": " << sorted.front()
+	    << ", \"median\": " << percentile(0.50)
+	    << ", \"p95\": " << percentile(0.95)
+	    << ", \"p99\": " << percentile(0.99)
+	    << ", \"max\": " << sorted.back()
+	    << ", \"mean\": " << sum / double(sorted.size())
+	    << ", \"samples\": " << sorted.size() << " }";
+}
+
+void Benchmark::write_json(std::ostream &out) const {
+	out << "{\n";
+	out << "\t\"scene\": "; write_json_string(out, scene); out << ",\n";
+	out << "\t\"events\": "; write_json_string(out, events); out << ",\n";
+	out << "\t\"device\": "; write_json_string(out, device); out << ",\n";
+	out << "\t\"frames\": " << frame_ms.size() << ",\n";
+	out << "\t\"cpu_ms\": {\n";
+	out << "\t\t\"update\": "; write_series(out, update_ms); out << ",\n";
+	out << "\t\t\"render\": "; write_series(out, render_ms); out << ",\n";
+	out << "\t\t\"submit\": "; write_series(out, submit_ms); out << ",\n";
+	out << "\t\t\"wait\": "; write_series(out, wait_ms); out << ",\n";
+	out << "\t\t\"frame\": "; write_series(out, frame_ms); out << "\n";
+	out << "\t},\n";
+	out << "\t\"gpu_ms\": "; write_series(out, gpu_ms); out << ",\n";
+	out << "\t\"memory\": { \"peak_host_bytes\": " << peak_host_bytes() << ", \"peak_device_bytes\": " << peak_device_bytes << " }\n";
+	out << "}\n";
+}
+
+uint64_t Benchmark::peak_host_bytes() {
+#if defined(__linux__) || defined(__APPLE__)
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+	#if defined(__APPLE__)
+	return uint64_t(usage.ru_maxrss); // (bytes on macOS)
+	#else
+	return uint64_t(usage.ru_maxrss) * 1024; // (KiB on linux)
+	#endif
+#else
+	return 0;
+#endif
+}
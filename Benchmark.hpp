@@ -0,0 +1,32 @@
+#pragma once
+
+// Frame-time statistics for --benchmark: RTG::run times each part of every frame on the CPU (Tutorial adds each frame's GPU time
+// from its timestamp queries), and write_json summarizes them once the event script runs out, so runs can be compared across commits.
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct Benchmark {
+	// what was run (copied into the results):
+	std::string scene;
+	std::string events;
+	std::string device;
+
+	// one sample per frame, in milliseconds:
+	std::vector< double > update_ms; // Application::update
+	std::vector< double > render_ms; // Application::render (recording and submitting the frame's commands)
+	std::vector< double > submit_ms; // queueing the finished frame for presentation (in headless mode: the copy back to host memory)
+	std::vector< double > wait_ms; // waiting for a free workspace and swapchain image (i.e., for the GPU to catch up)
+	std::vector< double > frame_ms; // all of the above
+	std::vector< double > gpu_ms; // first to last timestamp of the frame's command buffer (frames still in flight at exit are missing)
+
+	uint64_t peak_device_bytes = 0; // most device memory reserved by Helpers at once
+
+	// min/median/p95/p99/max/mean of every series, plus peak memory:
+	void write_json(std::ostream &out) const;
+
+	// peak resident set size of this process so far (0 where the platform doesn't say):
+	static uint64_t peak_host_bytes();
+};
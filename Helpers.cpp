@@ -5,10 +5,12 @@
 
 #include <vulkan/utility/vk_format_utils.h> // useful for byte counting
 
+#include <algorithm>
 #include <utility>
 #include <cassert>
 #include <cstring>
 #include <iostream>
+#include <string>
 
 Helpers::Allocation::Allocation(Allocation &&from) {
 	assert(handle == VK_NULL_HANDLE && offset == 0 && size == 0 && mapped == nullptr);
@@ -41,22 +43,66 @@ Helpers::Allocation::~Allocation() {
 
 //----------------------------
 
-Helpers::Allocation Helpers::allocate(VkDeviceSize size, VkDeviceSize alignment, uint32_t memory_type_index, MapFlag map) {
+// Allocations are carved out of large slabs of device memory (one vkAllocateMemory per slab instead of per buffer/image),
+// using a first-fit free list per slab. Slabs in host-visible memory stay mapped for their whole lifetime.
+
+Helpers::Allocation Helpers::allocate(VkDeviceSize size, VkDeviceSize alignment, uint32_t memory_type_index, MapFlag map, ResourceKind kind) {
 	Helpers::Allocation allocation;
 
-	VkMemoryAllocateInfo alloc_info{
-		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-		.allocationSize = size,
-		.memoryTypeIndex = memory_type_index,
-	};
+	if (map == Mapped && !(memory_properties.memoryTypes[memory_type_index].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) {
+		throw std::runtime_error("Asked for a mapped allocation from memory type " + std::to_string(memory_type_index) + ", which isn't host-visible.");
+	}
+	if (alignment == 0) alignment = 1;
+
+	// with a granularity of 1, buffers and images can share slabs:
+	if (buffer_image_granularity <= 1) kind = LinearResource;
+
+	MemorySlab *slab = nullptr;
+	VkDeviceSize offset = 0;
+
+	if (size > slab_size(memory_type_index) / 2) {
+		// big enough that it would mostly waste a shared slab:
+		slab = &create_slab(size, memory_type_index, kind, true);
+		offset = 0;
+	} else {
+		// first fit in an existing slab:
+		for (auto &candidate : slabs) {
+			if (candidate->dedicated || candidate->memory_type_index != memory_type_index || candidate->kind != kind) continue;
+			for (auto const &[range_offset, range_size] : candidate->free_ranges) {
+				VkDeviceSize aligned = (range_offset + alignment - 1) / alignment * alignment;
+				if (aligned + size <= range_offset + range_size) {
+					slab = candidate.get();
+					offset = aligned;
+					break;
+				}
+			}
+			if (slab) break;
+		}
+		// ...or in a fresh one:
+		if (!slab) {
+			slab = &create_slab(slab_size(memory_type_index), memory_type_index, kind, false);
+			offset = 0;
+		}
+	}
 
-	VK( vkAllocateMemory( rtg.device, &alloc_info, nullptr, &allocation.handle) );
+	{ //remove [offset, offset + size) from the slab's free ranges, keeping whatever is left on either side:
+		auto range = std::prev(slab->free_ranges.upper_bound(offset));
+		VkDeviceSize range_offset = range->first;
+		VkDeviceSize range_end = range->first + range->second;
+		assert(range_offset <= offset && offset + size <= range_end);
+		slab->free_ranges.erase(range);
+		if (range_offset < offset) slab->free_ranges.emplace(range_offset, offset - range_offset);
+		if (offset + size < range_end) slab->free_ranges.emplace(offset + size, range_end - (offset + size));
+	}
+	slab->live_bytes += size;
+	slab->live_allocations += 1;
 
+	allocation.handle = slab->handle;
 	allocation.size = size;
-	allocation.offset = 0;
+	allocation.offset = offset;
 
-	if (map == Mapped) { // mapping the memory into the host address space if requested:
-		VK( vkMapMemory(rtg.device, allocation.handle, 0, allocation.size, 0, &allocation.mapped) );
+	if (map == Mapped) { // the slab is already mapped; data() adds the offset:
+		allocation.mapped = slab->mapped;
 	}
 
 	return allocation;
@@ -65,21 +111,110 @@ Helpers::Allocation Helpers::allocate(VkDeviceSize size, VkDeviceSize alignment,
 // This version of our allocate function passes the work of allocating the memory to the other overload of the function, 
 // and the work of finding a memory type in the memoryTypeBits bit set that also has the memory properties in properties to a function called find_memory_type
 // The conveneince overload unpacks the Vulkan structs and calls the low-level overload
-Helpers::Allocation Helpers::allocate(VkMemoryRequirements const &req, VkMemoryPropertyFlags properties, MapFlag map) {
-	return allocate(req.size, req.alignment, find_memory_type(req.memoryTypeBits, properties), map);
+Helpers::Allocation Helpers::allocate(VkMemoryRequirements const &req, VkMemoryPropertyFlags properties, MapFlag map, ResourceKind kind) {
+	return allocate(req.size, req.alignment, find_memory_type(req.memoryTypeBits, properties), map, kind);
 }
 
 void Helpers::free(Helpers::Allocation &&allocation) {
-	if (allocation.mapped != nullptr) {
-		vkUnmapMemory(rtg.device, allocation.handle);
-		allocation.mapped = nullptr;
-	}
+	if (allocation.handle == VK_NULL_HANDLE) return; //nothing to free
 
-	vkFreeMemory(rtg.device, allocation.handle, nullptr);
+	auto found = std::find_if(slabs.begin(), slabs.end(), [&](std::unique_ptr< MemorySlab > const &slab){
+		return slab->handle == allocation.handle;
+	});
+	if (found == slabs.end()) {
+		throw std::runtime_error("Freeing an allocation that doesn't belong to any slab.");
+	}
+	MemorySlab &slab = **found;
+
+	{ //give the range back, merging with free neighbors:
+		VkDeviceSize offset = allocation.offset;
+		VkDeviceSize end = allocation.offset + allocation.size;
+		auto after = slab.free_ranges.lower_bound(offset);
+		if (after != slab.free_ranges.end() && after->first == end) {
+			end += after->second;
+			after = slab.free_ranges.erase(after);
+		}
+		if (after != slab.free_ranges.begin()) {
+			auto before = std::prev(after);
+			if (before->first + before->second == offset) {
+				offset = before->first;
+				slab.free_ranges.erase(before);
+			}
+		}
+		slab.free_ranges.emplace(offset, end - offset);
+	}
+	slab.live_bytes -= allocation.size;
+	slab.live_allocations -= 1;
 
 	allocation.handle = VK_NULL_HANDLE;
 	allocation.offset = 0;
 	allocation.size = 0;
+	allocation.mapped = nullptr;
+
+	// dedicated slabs only ever hold one allocation; shared slabs are kept around for reuse until destroy():
+	if (slab.dedicated) {
+		destroy_slab(slab);
+		slabs.erase(found);
+	}
+}
+
+VkDeviceSize Helpers::slab_size(uint32_t memory_type_index) const {
+	// 64MiB, but no more than an eighth of a (small) heap, e.g. 256MiB device-local host-visible windows:
+	VkDeviceSize heap_size = memory_properties.memoryHeaps[memory_properties.memoryTypes[memory_type_index].heapIndex].size;
+	return std::min< VkDeviceSize >(VkDeviceSize(64) << 20, heap_size / 8);
+}
+
+Helpers::MemorySlab &Helpers::create_slab(VkDeviceSize size, uint32_t memory_type_index, ResourceKind kind, bool dedicated) {
+	auto slab = std::make_unique< MemorySlab >();
+	slab->size = size;
+	slab->memory_type_index = memory_type_index;
+	slab->kind = kind;
+	slab->dedicated = dedicated;
+
+	VkMemoryAllocateInfo alloc_info{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+		.allocationSize = size,
+		.memoryTypeIndex = memory_type_index,
+	};
+
+	VK( vkAllocateMemory( rtg.device, &alloc_info, nullptr, &slab->handle) );
+
+	if (memory_properties.memoryTypes[memory_type_index].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) { // persistently map host-visible slabs:
+		VK( vkMapMemory(rtg.device, slab->handle, 0, VK_WHOLE_SIZE, 0, &slab->mapped) );
+	}
+
+	slab->free_ranges.emplace(0, size);
+
+	slabs.emplace_back(std::move(slab));
+	return *slabs.back();
+}
+
+void Helpers::destroy_slab(MemorySlab &slab) {
+	if (slab.live_allocations != 0) {
+		//not fatal, just sloppy, so complain but don't throw:
+		std::cerr << "Destroying a memory slab with " << slab.live_allocations << " live allocation(s)." << std::endl;
+	}
+	if (slab.mapped != nullptr) {
+		vkUnmapMemory(rtg.device, slab.handle);
+		slab.mapped = nullptr;
+	}
+	vkFreeMemory(rtg.device, slab.handle, nullptr);
+	slab.handle = VK_NULL_HANDLE;
+}
+
+Helpers::MemoryStats Helpers::memory_stats() const {
+	MemoryStats stats;
+	for (auto const &slab : slabs) {
+		stats.blocks += 1;
+		stats.allocations += slab->live_allocations;
+		stats.reserved_bytes += slab->size;
+		stats.live_bytes += slab->live_bytes;
+		for (auto const &[offset, size] : slab->free_ranges) {
+			stats.free_bytes += size;
+			stats.largest_free_range = std::max(stats.largest_free_range, size);
+		}
+	}
+	return stats;
 }
 
 //----------------------------
@@ -121,12 +256,14 @@ void Helpers::destroy_buffer(AllocatedBuffer &&buffer) {
 }
 
 
-Helpers::AllocatedImage Helpers::create_image(VkExtent2D const &extent, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, MapFlag map) {
+Helpers::AllocatedImage Helpers::create_image(VkExtent2D const &extent, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, MapFlag map, uint32_t mip_levels, uint32_t array_layers) {
 	// 1. create the VkImage
 	AllocatedImage image;
 	// refsol::Helpers_create_image(rtg, extent, format, tiling, usage, properties, (map == Mapped), &image);
 	image.extent = extent;
 	image.format = format;
+	image.mip_levels = mip_levels;
+	image.array_layers = array_layers;
 
 	VkImageCreateInfo create_info{
 		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
@@ -137,8 +274,8 @@ Helpers::AllocatedImage Helpers::create_image(VkExtent2D const &extent, VkFormat
 			.height = extent.height,
 			.depth = 1
 		},
-		.mipLevels = 1,
-		.arrayLayers = 1,
+		.mipLevels = mip_levels,
+		.arrayLayers = array_layers,
 		.samples = VK_SAMPLE_COUNT_1_BIT, // No multisampling
 		.tiling = tiling,
 		.usage = usage,
@@ -153,7 +290,7 @@ Helpers::AllocatedImage Helpers::create_image(VkExtent2D const &extent, VkFormat
 	vkGetImageMemoryRequirements(rtg.device, image.handle, &req); // Strangely enough, vkGetBufferMemoryRequirements is one of the very rare Vulkan functions that cannot return an error. So we don't wrap it with VK()
 
 	// 3. create the memory
-	image.allocation = allocate(req, properties, map);
+	image.allocation = allocate(req, properties, map, (tiling == VK_IMAGE_TILING_OPTIMAL ? OptimalImage : LinearResource));
 
 	// 4. bind the memory
 	VK( vkBindImageMemory(rtg.device, image.handle, image.allocation.handle, image.allocation.offset) );
@@ -167,6 +304,8 @@ void Helpers::destroy_image(AllocatedImage &&image) {
 	image.handle = VK_NULL_HANDLE;
 	image.extent = VkExtent2D{.width = 0, .height = 0};
 	image.format = VK_FORMAT_UNDEFINED;
+	image.mip_levels = 1;
+	image.array_layers = 1;
 
 	this->free(std::move(image.allocation));
 }
@@ -175,59 +314,78 @@ void Helpers::destroy_image(AllocatedImage &&image) {
 
 void Helpers::transfer_to_buffer(void const *data, size_t size, AllocatedBuffer &target) {
 	// refsol::Helpers_transfer_to_buffer(rtg, data, size, &target);
+	transfer_to_buffer({ {data, size} }, target);
+}
 
-	// NOTE: could let this stick around and use it for all uploads, but this function isn't for performant transfers anyway:
-	// Create a CPU-visible "staging" buffer:
-	AllocatedBuffer transfer_src = create_buffer(
-		size, 
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		Mapped
-	);
+void Helpers::transfer_to_buffer(std::vector< std::pair< void const *, size_t > > const &pieces, AllocatedBuffer &target) {
+	upload_to_buffer(pieces, target);
+	wait_for_upload(flush_uploads());
+}
 
-	// copy data to transfer buffer: // Copy data from CPU → staging buffer using memcpy
-	std::memcpy(transfer_src.allocation.data(), data, size);
+void Helpers::upload_to_buffer(void const *data, size_t size, AllocatedBuffer &target) {
+	upload_to_buffer({ {data, size} }, target);
+}
 
-	{ //record command buffer that does CPU->GPU transfer: // Use GPU to copy staging buffer → GPU-local buffer
-		// what's the difference between this transfer_command_buffer and the workspace.command_buffer used in Tutorial.cpp //??
-		VK( vkResetCommandBuffer(transfer_command_buffer, 0)); // reset the command buffer (clear old commands)
-		
-		VkCommandBufferBeginInfo begin_info{
-			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-			.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, // will record again every submit // what does this mean //??
-		};
+void Helpers::upload_to_buffer(std::vector< std::pair< void const *, size_t > > const &pieces, AllocatedBuffer &target) {
+	size_t size = 0;
+	for (auto const &[data, piece_size] : pieces) size += piece_size;
+	if (size == 0) return; // nothing to copy
+	assert(size <= target.size);
+
+	// get some host-coherent staging space (part of the staging ring, or its own buffer if it's huge):
+	VkBuffer transfer_src;
+	VkDeviceSize transfer_src_offset;
+	void *transfer_src_mapped;
+	stage(size, &transfer_src, &transfer_src_offset, &transfer_src_mapped);
+
+	// copy data to staging space: // Copy data from CPU → staging buffer using memcpy
+	// (pieces may point straight into memory-mapped files, so this is where they actually get paged in)
+	size_t offset = 0;
+	for (auto const &[data, piece_size] : pieces) {
+		if (piece_size == 0) continue;
+		std::memcpy(reinterpret_cast< char * >(transfer_src_mapped) + offset, data, piece_size);
+		offset += piece_size;
+	}
 
-		VK( vkBeginCommandBuffer(transfer_command_buffer, &begin_info));
+	{ //record the CPU->GPU transfer into the current batch: // Use GPU to copy staging buffer → GPU-local buffer
+		VkCommandBuffer transfer_command_buffer = begin_upload().transfer_commands;
 
 		VkBufferCopy copy_region{ //   Defines what part of each buffer to copy: 
-			.srcOffset = 0,
+			.srcOffset = transfer_src_offset,
 			.dstOffset = 0,
 			.size = size,
 		};
-		vkCmdCopyBuffer(transfer_command_buffer, transfer_src.handle, target.handle, 1, &copy_region);
-
-		VK( vkEndCommandBuffer(transfer_command_buffer) );
-	}
-
-	{// run command buffer
-		VkSubmitInfo submit_info{
-			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-			.commandBufferCount = 1,
-			.pCommandBuffers = &transfer_command_buffer
-		};
-
-		// Submits a sequence of semaphores or command buffers to a queue
-		VK( vkQueueSubmit(rtg.graphics_queue, 1, &submit_info, VK_NULL_HANDLE) );
+		vkCmdCopyBuffer(transfer_command_buffer, transfer_src, target.handle, 1, &copy_region);
+
+		if (separate_transfer_queue()) { // hand the buffer over to the graphics queue family (release here, acquire on flush):
+			VkBufferMemoryBarrier barrier{
+				.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+				.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+				.dstAccessMask = 0, // (ignored for a release)
+				.srcQueueFamilyIndex = rtg.transfer_queue_family.value(),
+				.dstQueueFamilyIndex = rtg.graphics_queue_family.value(),
+				.buffer = target.handle,
+				.offset = 0,
+				.size = VK_WHOLE_SIZE,
+			};
+			vkCmdPipelineBarrier(
+				transfer_command_buffer,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, // srcStageMask
+				VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, // dstStageMask
+				0, // no dependencyFlags
+				0, nullptr, // no memory barriers
+				1, &barrier, // 1 buffer barrier
+				0, nullptr // no image barriers
+			);
+
+			barrier.srcAccessMask = 0; // (ignored for an acquire)
+			barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+			upload_batches[current_upload_batch].buffer_acquires.emplace_back(barrier);
+		}
 	}
-
-	// wait for command buffer to finish:
-	VK( vkQueueWaitIdle(rtg.graphics_queue) );
-	
-	// don't leak buffer memory:
-	destroy_buffer(std::move(transfer_src)); // what does std::move do //??
 }
 
-void Helpers::transfer_to_image(void const *data, size_t size, AllocatedImage &target) {
+void Helpers::upload_to_image(void const *data, size_t size, AllocatedImage &target) {
 	// refsol::Helpers_transfer_to_image(rtg, data, size, &target);
 
 	assert(target.handle != VK_NULL_HANDLE); // target imgage should be allocated already
@@ -235,36 +393,38 @@ void Helpers::transfer_to_image(void const *data, size_t size, AllocatedImage &t
 	// check data is the right size [new]
 	size_t bytes_per_block = vkuFormatTexelBlockSize(target.format);
 	size_t texels_per_block = vkuFormatTexelsPerBlock(target.format);
-	assert(size == target.extent.width * target.extent.height * bytes_per_block / texels_per_block);
+	auto level_extent = [&](uint32_t level) { // each mip level is half the size of the one above (rounding down, but never below 1)
+		return VkExtent2D{ .width = std::max(1u, target.extent.width >> level), .height = std::max(1u, target.extent.height >> level) };
+	};
+	auto level_size = [&](uint32_t level) -> size_t {
+		VkExtent2D extent = level_extent(level);
+		return size_t(extent.width) * extent.height * target.array_layers * bytes_per_block / texels_per_block;
+	};
+	{
+		size_t expected = 0;
+		for (uint32_t level = 0; level < target.mip_levels; ++level) expected += level_size(level);
+		assert(size == expected);
+	}
 
-	// create a host-coherent source buffer
-	AllocatedBuffer transfer_src = create_buffer(
-		size,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT, // This buffer will be the source of a copy operatio
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, // he CPU can see this memory | CPU writes are automatically visible to GPU
-		Mapped
-	);
+	// get some host-coherent staging space (part of the staging ring, or its own buffer if it's huge)
+	VkBuffer transfer_src;
+	VkDeviceSize transfer_src_offset;
+	void *transfer_src_mapped;
+	stage(size, &transfer_src, &transfer_src_offset, &transfer_src_mapped);
 
-	// copy image data into the source buffer
+	// copy image data into the staging space
 	// Use *data*, not *&data*, because The function signature shows data is already a pointer (void const *data). The bug is using &data which takes the address of the pointer variable itself (on the stack) instead of the data it points to.  
-	std::memcpy(transfer_src.allocation.data(), data, size);
-
-	// begin recording a command buffer
-	VK( vkResetCommandBuffer(transfer_command_buffer, 0) );
+	std::memcpy(transfer_src_mapped, data, size);
 
-	VkCommandBufferBeginInfo begin_info{
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, // will record again every submit
-	};
-
-	VK( vkBeginCommandBuffer(transfer_command_buffer, &begin_info) );
+	// record into the current upload batch
+	VkCommandBuffer transfer_command_buffer = begin_upload().transfer_commands;
 
 	VkImageSubresourceRange whole_image{
 		.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,// Color data (not depth/stencil) 
 		.baseMipLevel = 0, // Start at mip 0 (full resolution)     
-		.levelCount = 1, // Only 1 mip level                                       
+		.levelCount = target.mip_levels, // Every mip level
 		.baseArrayLayer = 0, // Start at layer 0   
-		.layerCount = 1, // Only 1 layer 
+		.layerCount = target.array_layers, // Every layer
 	};
 
 	{ // put the receiving image in destination-optimal layout [new]
@@ -306,37 +466,43 @@ void Helpers::transfer_to_image(void const *data, size_t size, AllocatedImage &t
 	}
 
 	{ // copy the source buffer to the image [new]
-		// describe what part of the image to copy;
+		// describe what part of the image to copy -- one region per mip level, each starting where the previous level's data ended;
 		// parameters indicate buffer and image to copy between and the current format of the image:
-		VkBufferImageCopy region{
-			.bufferOffset = 0,
-			.bufferRowLength = target.extent.width,
-			.bufferImageHeight = target.extent.height,
-			.imageSubresource{ // Frustratingly, the imageSubresource field of VkBufferImageCopy is a VkImageSubresourceLayers not a VkImageSubresourceRange, otherwise we could have used our convenient whole_image structure from above.
-				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-				.mipLevel = 0,
-				.baseArrayLayer = 0,
-				.layerCount = 1,
-			},
-			.imageOffset{ .x = 0, .y = 0, .z = 0 },
-			.imageExtent{
-				.width = target.extent.width,
-				.height = target.extent.height,
-				.depth = 1
-			},
-		};
+		std::vector< VkBufferImageCopy > regions;
+		regions.reserve(target.mip_levels);
+		VkDeviceSize level_offset = transfer_src_offset;
+		for (uint32_t level = 0; level < target.mip_levels; ++level) {
+			VkExtent2D extent = level_extent(level);
+			regions.emplace_back(VkBufferImageCopy{
+				.bufferOffset = level_offset,
+				.bufferRowLength = extent.width,
+				.bufferImageHeight = extent.height,
+				.imageSubresource{ // Frustratingly, the imageSubresource field of VkBufferImageCopy is a VkImageSubresourceLayers not a VkImageSubresourceRange, otherwise we could have used our convenient whole_image structure from above.
+					.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+					.mipLevel = level,
+					.baseArrayLayer = 0,
+					.layerCount = target.array_layers,
+				},
+				.imageOffset{ .x = 0, .y = 0, .z = 0 },
+				.imageExtent{
+					.width = extent.width,
+					.height = extent.height,
+					.depth = 1
+				},
+			});
+			level_offset += level_size(level);
+		}
 
 		vkCmdCopyBufferToImage(
 			transfer_command_buffer,
-			transfer_src.handle,
+			transfer_src,
 			target.handle,
 			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			1, &region // region count, region ptr
+			uint32_t(regions.size()), regions.data() // region count, region ptr
 		);
-		// NOTE: if image had mip levels, would need to copy as additional regions here
 	}
 
-	{ // transition the image memory to shader-read-only-optimal layout [new]
+	if (!separate_transfer_queue()) { // transition the image memory to shader-read-only-optimal layout [new]
 		VkImageMemoryBarrier barrier{
 			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
 			.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT, // waits until all transfer writes are complete, then transitions the image
@@ -358,24 +524,229 @@ void Helpers::transfer_to_image(void const *data, size_t size, AllocatedImage &t
 			0, nullptr, // buffer memory barrier count, pointer (no buffer barriers)
 			1, &barrier // image memory barrier count, pointer (1 iamge barrier)
 		);
+	} else { // same transition, but also hand the image from the transfer queue family to the graphics queue family:
+		// the release half runs on the transfer queue now; the matching acquire half runs on the graphics queue when the batch is flushed
+		VkImageMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.dstAccessMask = 0, // (ignored for a release)
+			.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			.srcQueueFamilyIndex = rtg.transfer_queue_family.value(),
+			.dstQueueFamilyIndex = rtg.graphics_queue_family.value(),
+			.image = target.handle,
+			.subresourceRange = whole_image,
+		};
+
+		vkCmdPipelineBarrier(
+			transfer_command_buffer, // commandBuffer
+			VK_PIPELINE_STAGE_TRANSFER_BIT, // srcStageMask
+			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, // dstStageMask (transfer queues don't know about shader stages)
+			0, // no dependencyFlags
+			0, nullptr, // memory barrier count, pointer (no memory barriers)
+			0, nullptr, // buffer memory barrier count, pointer (no buffer barriers)
+			1, &barrier // image memory barrier count, pointer (1 iamge barrier)
+		);
+
+		barrier.srcAccessMask = 0; // (ignored for an acquire)
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		upload_batches[current_upload_batch].image_acquires.emplace_back(barrier);
 	}
+}
 
-	// end and submit the command buffer:
-	VK( vkEndCommandBuffer(transfer_command_buffer) );
+void Helpers::transfer_to_image(void const *data, size_t size, AllocatedImage &target) {
+	upload_to_image(data, size, target);
+	wait_for_upload(flush_uploads());
+}
 
-	VkSubmitInfo submit_info{ // what does this format mean//??
-		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-		.commandBufferCount = 1,
-		.pCommandBuffers = &transfer_command_buffer
-	};
+bool Helpers::separate_transfer_queue() const {
+	return rtg.transfer_queue_family.value() != rtg.graphics_queue_family.value();
+}
+
+Helpers::UploadBatch &Helpers::begin_upload() {
+	UploadBatch &batch = upload_batches[current_upload_batch];
+	if (!batch.recording) {
+		// this batch was last used UploadBatches flushes ago; make sure the GPU is done with it:
+		if (batch.serial != 0) retire_uploads(batch.serial);
+
+		VK( vkResetCommandBuffer(batch.transfer_commands, 0) ); // reset the command buffer (clear old commands)
+
+		VkCommandBufferBeginInfo begin_info{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+			.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, // will record again every submit
+		};
+		VK( vkBeginCommandBuffer(batch.transfer_commands, &begin_info) );
+
+		batch.recording = true;
+		batch.staging_end = staging_head;
+	}
+	return batch;
+}
+
+void Helpers::stage(size_t size, VkBuffer *buffer, VkDeviceSize *offset, void **mapped) {
+	VkDeviceSize capacity = staging_ring.size;
+
+	if (size > capacity / 2) { // too big to share the ring; give it its own staging buffer for the life of the batch:
+		AllocatedBuffer transfer_src = create_buffer(
+			size,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT, // This buffer will be the source of a copy operation
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, // the CPU can see this memory | CPU writes are automatically visible to GPU
+			Mapped
+		);
+		*buffer = transfer_src.handle;
+		*offset = 0;
+		*mapped = transfer_src.allocation.data();
+		begin_upload().oversized_staging.emplace_back(std::move(transfer_src));
+		return;
+	}
+
+	constexpr VkDeviceSize Alignment = 16; // keeps buffer->image copy offsets a multiple of every texel size we use
+
+	while (true) {
+		uint64_t start = (staging_head + Alignment - 1) / Alignment * Alignment;
+		if (start % capacity + size > capacity) start += capacity - start % capacity; // don't wrap around mid-upload; skip to the beginning
+		if (start + size - staging_tail <= capacity) {
+			staging_head = start + size;
+			*buffer = staging_ring.handle;
+			*offset = start % capacity;
+			*mapped = reinterpret_cast< char * >(staging_ring.allocation.data()) + *offset;
+			begin_upload().staging_end = staging_head;
+			return;
+		}
+
+		// ring is full; make room by waiting for the oldest batch (submitting the current one first if it's the only thing using the ring):
+		if (last_finished_upload < last_submitted_upload) {
+			retire_uploads(last_finished_upload + 1);
+		} else {
+			assert(upload_batches[current_upload_batch].recording);
+			flush_uploads();
+		}
+	}
+}
+
+Helpers::UploadToken Helpers::flush_uploads() {
+	UploadBatch &batch = upload_batches[current_upload_batch];
+	if (!batch.recording) return UploadToken{ .serial = last_submitted_upload }; // nothing new to submit
+
+	if (!separate_transfer_queue()) {
+		// make the copied data visible to whatever reads it next (images were already transitioned above):
+		VkMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+		};
+		vkCmdPipelineBarrier(
+			batch.transfer_commands,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, // srcStageMask
+			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, // dstStageMask
+			0, // no dependencyFlags
+			1, &barrier, // 1 memory barrier
+			0, nullptr, // no buffer barriers
+			0, nullptr // no image barriers
+		);
+	}
+
+	VK( vkEndCommandBuffer(batch.transfer_commands) );
+	batch.recording = false;
+	batch.serial = ++last_submitted_upload;
+
+	if (!separate_transfer_queue()) {
+		VkSubmitInfo submit_info{
+			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+			.commandBufferCount = 1,
+			.pCommandBuffers = &batch.transfer_commands,
+		};
+		VK( vkQueueSubmit(rtg.transfer_queue, 1, &submit_info, batch.done) );
+	} else {
+		{ // copies + releases on the transfer queue:
+			VkSubmitInfo submit_info{
+				.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+				.commandBufferCount = 1,
+				.pCommandBuffers = &batch.transfer_commands,
+				.signalSemaphoreCount = 1,
+				.pSignalSemaphores = &batch.released,
+			};
+			VK( vkQueueSubmit(rtg.transfer_queue, 1, &submit_info, VK_NULL_HANDLE) );
+		}
+
+		{ // matching acquires on the graphics queue, once the releases are done:
+			VK( vkResetCommandBuffer(batch.acquire_commands, 0) );
+			VkCommandBufferBeginInfo begin_info{
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+				.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+			};
+			VK( vkBeginCommandBuffer(batch.acquire_commands, &begin_info) );
+			if (!batch.buffer_acquires.empty() || !batch.image_acquires.empty()) {
+				vkCmdPipelineBarrier(
+					batch.acquire_commands,
+					VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, // srcStageMask (the semaphore wait covers the transfer side)
+					VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, // dstStageMask
+					0, // no dependencyFlags
+					0, nullptr, // no memory barriers
+					uint32_t(batch.buffer_acquires.size()), batch.buffer_acquires.data(),
+					uint32_t(batch.image_acquires.size()), batch.image_acquires.data()
+				);
+			}
+			VK( vkEndCommandBuffer(batch.acquire_commands) );
+			batch.buffer_acquires.clear();
+			batch.image_acquires.clear();
+
+			VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+			VkSubmitInfo submit_info{
+				.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+				.waitSemaphoreCount = 1,
+				.pWaitSemaphores = &batch.released,
+				.pWaitDstStageMask = &wait_stage,
+				.commandBufferCount = 1,
+				.pCommandBuffers = &batch.acquire_commands,
+			};
+			VK( vkQueueSubmit(rtg.graphics_queue, 1, &submit_info, batch.done) );
+		}
+	}
 
-	VK( vkQueueSubmit(rtg.graphics_queue, 1, &submit_info, VK_NULL_HANDLE) );
+	current_upload_batch = (current_upload_batch + 1) % UploadBatches;
 
-	// wait for command buffer to finish executing:
-	VK( vkQueueWaitIdle(rtg.graphics_queue) );
+	return UploadToken{ .serial = batch.serial };
+}
+
+bool Helpers::upload_finished(UploadToken token) {
+	// retire (in order) whatever the GPU has already finished:
+	while (last_finished_upload < token.serial) {
+		uint64_t next = last_finished_upload + 1;
+		UploadBatch *batch = std::find_if(std::begin(upload_batches), std::end(upload_batches), [&](UploadBatch const &b){ return b.serial == next; });
+		assert(batch != std::end(upload_batches));
+		VkResult status = vkGetFenceStatus(rtg.device, batch->done);
+		if (status == VK_NOT_READY) return false;
+		VK( status );
+		retire_uploads(next);
+	}
+	return true;
+}
+
+void Helpers::wait_for_upload(UploadToken token) {
+	retire_uploads(token.serial);
+}
 
-	// destroy the source buffer:
-	destroy_buffer(std::move(transfer_src)); // what does move() mean //vv transfer ownership to the destroy function
+void Helpers::retire_uploads(uint64_t serial) {
+	assert(serial <= last_submitted_upload);
+	// batches finish in submission order, so retire them in that order too (the staging tail only moves forward):
+	while (last_finished_upload < serial) {
+		uint64_t next = last_finished_upload + 1;
+		UploadBatch *batch = std::find_if(std::begin(upload_batches), std::end(upload_batches), [&](UploadBatch const &b){ return b.serial == next; });
+		assert(batch != std::end(upload_batches));
+
+		VK( vkWaitForFences(rtg.device, 1, &batch->done, VK_TRUE, UINT64_MAX) );
+		VK( vkResetFences(rtg.device, 1, &batch->done) );
+
+		for (auto &transfer_src : batch->oversized_staging) {
+			destroy_buffer(std::move(transfer_src));
+		}
+		batch->oversized_staging.clear();
+
+		staging_tail = std::max(staging_tail, batch->staging_end);
+		batch->serial = 0;
+		last_finished_upload = next;
+	}
 }
 
 //----------------------------
@@ -440,23 +811,53 @@ Helpers::~Helpers() {
 }
 
 void Helpers::create() {
-	VkCommandPoolCreateInfo create_info{
-		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-		.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, // allows individual command buffers to be reset and reused
-		.queueFamilyIndex = rtg.graphics_queue_family.value(),
-	};
-	VK( vkCreateCommandPool(rtg.device, &create_info, nullptr, &transfer_command_pool) );
+	{ //command pools for upload batches:
+		VkCommandPoolCreateInfo create_info{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+			.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, // allows individual command buffers to be reset and reused
+			.queueFamilyIndex = rtg.transfer_queue_family.value(),
+		};
+		VK( vkCreateCommandPool(rtg.device, &create_info, nullptr, &upload_command_pool) );
 
-	VkCommandBufferAllocateInfo alloc_info{
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-		.commandPool = transfer_command_pool,
-		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY, // it can be submitted directly to a queue
-		.commandBufferCount = 1,
-	};
-	VK( vkAllocateCommandBuffers(rtg.device, &alloc_info, &transfer_command_buffer) );
+		if (separate_transfer_queue()) { //ownership acquires are recorded for the graphics queue:
+			create_info.queueFamilyIndex = rtg.graphics_queue_family.value();
+			VK( vkCreateCommandPool(rtg.device, &create_info, nullptr, &acquire_command_pool) );
+		}
+	}
+
+	for (UploadBatch &batch : upload_batches) { //per-batch command buffers and sync objects:
+		VkCommandBufferAllocateInfo alloc_info{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = upload_command_pool,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY, // it can be submitted directly to a queue
+			.commandBufferCount = 1,
+		};
+		VK( vkAllocateCommandBuffers(rtg.device, &alloc_info, &batch.transfer_commands) );
+
+		VkFenceCreateInfo fence_info{
+			.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+		};
+		VK( vkCreateFence(rtg.device, &fence_info, nullptr, &batch.done) );
+
+		if (separate_transfer_queue()) {
+			alloc_info.commandPool = acquire_command_pool;
+			VK( vkAllocateCommandBuffers(rtg.device, &alloc_info, &batch.acquire_commands) );
+
+			VkSemaphoreCreateInfo semaphore_info{
+				.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+			};
+			VK( vkCreateSemaphore(rtg.device, &semaphore_info, nullptr, &batch.released) );
+		}
+	}
 
 	vkGetPhysicalDeviceMemoryProperties(rtg.physical_device, &memory_properties);
 
+	{ //the sub-allocator needs to know whether buffers and optimal-tiling images can share slabs:
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(rtg.physical_device, &properties);
+		buffer_image_granularity = properties.limits.bufferImageGranularity;
+	}
+
 	if (rtg.configuration.debug) {
 		std::cout << "Memory types:\n";
 		for (uint32_t i = 0; i < memory_properties.memoryTypeCount; ++i) {
@@ -470,16 +871,63 @@ void Helpers::create() {
 		}
 		std::cout.flush(); //?? what is flush?
 	}
+
+	//staging ring for uploads (needs memory_properties, above):
+	staging_ring = create_buffer(
+		32 << 20,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		Mapped
+	);
+	staging_head = staging_tail = 0;
+
+	if (rtg.configuration.debug) {
+		std::cout << "Uploads use queue family " << rtg.transfer_queue_family.value()
+		          << (separate_transfer_queue() ? " (dedicated transfer queue)" : " (graphics queue)") << std::endl;
+	}
 }
 
 void Helpers::destroy() {
-	// technically not needed since freeing the pool will free all contained buffers:
-	if (transfer_command_buffer != VK_NULL_HANDLE) {
-		vkFreeCommandBuffers(rtg.device, transfer_command_pool, 1, &transfer_command_buffer);
-		transfer_command_buffer = VK_NULL_HANDLE;
+	//finish (and reclaim) any in-flight uploads; anything recorded but never flushed is just dropped:
+	if (last_finished_upload < last_submitted_upload) retire_uploads(last_submitted_upload);
+	for (UploadBatch &batch : upload_batches) {
+		for (auto &transfer_src : batch.oversized_staging) {
+			destroy_buffer(std::move(transfer_src));
+		}
+		batch.oversized_staging.clear();
+		batch.buffer_acquires.clear();
+		batch.image_acquires.clear();
+		batch.recording = false;
+
+		if (batch.done != VK_NULL_HANDLE) {
+			vkDestroyFence(rtg.device, batch.done, nullptr);
+			batch.done = VK_NULL_HANDLE;
+		}
+		if (batch.released != VK_NULL_HANDLE) {
+			vkDestroySemaphore(rtg.device, batch.released, nullptr);
+			batch.released = VK_NULL_HANDLE;
+		}
+		// (command buffers are freed along with their pools, below)
+		batch.transfer_commands = VK_NULL_HANDLE;
+		batch.acquire_commands = VK_NULL_HANDLE;
 	}
-	if (transfer_command_pool != VK_NULL_HANDLE) {
-		vkDestroyCommandPool(rtg.device, transfer_command_pool, nullptr);
-		transfer_command_pool = VK_NULL_HANDLE;
+
+	if (staging_ring.handle != VK_NULL_HANDLE) {
+		destroy_buffer(std::move(staging_ring));
+	}
+
+	if (upload_command_pool != VK_NULL_HANDLE) {
+		vkDestroyCommandPool(rtg.device, upload_command_pool, nullptr);
+		upload_command_pool = VK_NULL_HANDLE;
+	}
+	if (acquire_command_pool != VK_NULL_HANDLE) {
+		vkDestroyCommandPool(rtg.device, acquire_command_pool, nullptr);
+		acquire_command_pool = VK_NULL_HANDLE;
+	}
+
+	//release all slabs (everything allocated from them should have been freed by now):
+	for (auto &slab : slabs) {
+		destroy_slab(*slab);
 	}
+	slabs.clear();
 }
@@ -2,6 +2,9 @@
 
 #include <vulkan/vulkan_core.h>
 
+#include <map>
+#include <memory>
+#include <utility>
 #include <vector>
 
 struct RTG;
@@ -31,17 +34,38 @@ struct Helpers {
 		Mapped = 1,
 	};
 
+	// what will be bound to an allocation; linear resources (buffers) and optimal-tiling images are kept in
+	// separate slabs when the device has a bufferImageGranularity > 1, so neighbors can never alias a granularity page:
+	enum ResourceKind {
+		LinearResource = 0,
+		OptimalImage = 1,
+	};
+
 	// allocate a block of requested size and alignment from a memory with the given type index:
 	// Low-level (takes raw values). Use this When you already know the exact size, alignment, and memory type
-	Allocation allocate(VkDeviceSize size, VkDeviceSize alignment, uint32_t memory_type_index, MapFlag map = Unmapped);
+	// (blocks are carved out of larger per-memory-type slabs; see MemorySlab below)
+	Allocation allocate(VkDeviceSize size, VkDeviceSize alignment, uint32_t memory_type_index, MapFlag map = Unmapped, ResourceKind kind = LinearResource);
 
 	// allocate a block that works for a given VkMemoryREquirements and VkMemoryPropertyFlags:
 	// Convenience wrapper (takes Vulkan structs). Use this when you have a VkMemoryRequirements from Vulkan (common case)      
-	Allocation allocate(VkMemoryRequirements const &requirements, VkMemoryPropertyFlags properties, MapFlag map);
+	Allocation allocate(VkMemoryRequirements const &requirements, VkMemoryPropertyFlags properties, MapFlag map, ResourceKind kind = LinearResource);
 
-	// free an allocated block:
+	// free an allocated block (returns it to its slab):
 	void free(Allocation &&allocation);
 
+	// what the allocator is holding right now:
+	struct MemoryStats {
+		uint32_t blocks = 0; // VkDeviceMemory allocations (slabs) held
+		uint32_t allocations = 0; // live Allocations handed out from them
+		VkDeviceSize reserved_bytes = 0; // total size of all slabs
+		VkDeviceSize live_bytes = 0; // bytes in live Allocations
+		VkDeviceSize free_bytes = 0; // reserved_bytes - live_bytes (including alignment padding)
+		VkDeviceSize largest_free_range = 0;
+		// 0 = all free space is one range, approaching 1 = free space is scattered in small pieces:
+		float fragmentation() const { return free_bytes ? 1.0f - float(largest_free_range) / float(free_bytes) : 0.0f; }
+	};
+	MemoryStats memory_stats() const;
+
 	//specializations that also create a buffer or image (respectively):
 	struct AllocatedBuffer {
 		VkBuffer handle = VK_NULL_HANDLE;
@@ -57,23 +81,74 @@ struct Helpers {
 		VkImage handle = VK_NULL_HANDLE;
 		VkExtent2D extent{.width = 0, .height = 0};
 		VkFormat format = VK_FORMAT_UNDEFINED;
+		uint32_t mip_levels = 1;
+		uint32_t array_layers = 1;
 		Allocation allocation;
 
 		//NOTE: could define default constructor, move constructor, move assignment, destructor for a bit more paranoia
 	};
-	AllocatedImage create_image(VkExtent2D const &extent, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, MapFlag map = Unmapped);
+	AllocatedImage create_image(VkExtent2D const &extent, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, MapFlag map = Unmapped, uint32_t mip_levels = 1, uint32_t array_layers = 1);
 	void destroy_image(AllocatedImage &&allocated_image);
 	
 
 	//-----------------------
 	//CPU -> GPU data transfer:
 
+	// Batched uploads: each call copies its data into a staging ring buffer right away and records the GPU-side copy
+	// into the current upload batch; nothing is submitted until flush_uploads() (or until the ring fills up, which flushes on its own).
+	// Uploads run on rtg.transfer_queue; if that is a separate family, ownership is released to the graphics queue family when the batch is done.
+	// The target must stay alive until the upload has finished.
+	struct UploadToken {
+		uint64_t serial = 0; // batch serial number; 0 = nothing to wait for
+	};
+	void upload_to_buffer(void const *data, size_t size, AllocatedBuffer &target);
+	// gathers several (data, size) pieces back-to-back into target:
+	void upload_to_buffer(std::vector< std::pair< void const *, size_t > > const &pieces, AllocatedBuffer &target);
+	void upload_to_image(void const *data, size_t size, AllocatedImage &target); //NOTE: image layout after upload is VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+	// (data holds every mip level of the target back-to-back, largest first; each level holds all of its array layers)
+	UploadToken flush_uploads(); // submit everything recorded so far; the token is done when all of it has landed
+	bool upload_finished(UploadToken token); // doesn't block
+	void wait_for_upload(UploadToken token);
+
 	// NOTE: synchronizes *hard* against the GPU; inefficient to use for streaming data!
+	// (these upload, flush, and wait)
 	void transfer_to_buffer(void const *data, size_t size, AllocatedBuffer &target);
+	// gathers several (data, size) pieces back-to-back into one staging buffer and uploads them with a single copy:
+	void transfer_to_buffer(std::vector< std::pair< void const *, size_t > > const &pieces, AllocatedBuffer &target);
 	void transfer_to_image(void const *data, size_t size, AllocatedImage &image); //NOTE: image layout after call is VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
 
-	VkCommandPool transfer_command_pool = VK_NULL_HANDLE;
-	VkCommandBuffer transfer_command_buffer = VK_NULL_HANDLE;
+	// upload internals:
+	struct UploadBatch {
+		VkCommandBuffer transfer_commands = VK_NULL_HANDLE; // copies (+ ownership releases); runs on rtg.transfer_queue
+		VkCommandBuffer acquire_commands = VK_NULL_HANDLE; // ownership acquires; runs on rtg.graphics_queue (only used if the families differ)
+		VkSemaphore released = VK_NULL_HANDLE; // transfer_commands -> acquire_commands (only used if the families differ)
+		VkFence done = VK_NULL_HANDLE; // signalled once the whole batch has finished
+		bool recording = false; // transfer_commands has been begun
+		uint64_t serial = 0; // nonzero while submitted and not yet retired
+		uint64_t staging_end = 0; // staging_head after this batch's data; the ring can reuse everything before this once the batch retires
+		std::vector< AllocatedBuffer > oversized_staging; // uploads too big for the ring get their own staging buffer, freed on retire
+		std::vector< VkBufferMemoryBarrier > buffer_acquires; // recorded into acquire_commands on flush
+		std::vector< VkImageMemoryBarrier > image_acquires;
+	};
+	static constexpr uint32_t UploadBatches = 4; // batches can be in flight at once; recycled round-robin
+	UploadBatch upload_batches[UploadBatches];
+	uint32_t current_upload_batch = 0; // the one being recorded
+	uint64_t last_submitted_upload = 0; // serial of most recently submitted batch
+	uint64_t last_finished_upload = 0; // serial of most recently retired batch
+
+	VkCommandPool upload_command_pool = VK_NULL_HANDLE; // for rtg.transfer_queue_family
+	VkCommandPool acquire_command_pool = VK_NULL_HANDLE; // for rtg.graphics_queue_family (only if the families differ)
+
+	AllocatedBuffer staging_ring; // host-visible, persistently mapped
+	uint64_t staging_head = 0; // total bytes ever handed out from the ring (position = head % size)
+	uint64_t staging_tail = 0; // total bytes the GPU is done with
+
+	bool separate_transfer_queue() const; // transfer and graphics queue families differ (so ownership must be transferred)
+	UploadBatch &begin_upload(); // current batch, begun if needed
+	// staging space for an upload in the current batch (may flush and wait for older batches to make room):
+	void stage(size_t size, VkBuffer *buffer, VkDeviceSize *offset, void **mapped);
+	void retire_uploads(uint64_t serial); // wait for (in order) every batch up to and including serial, and reclaim their staging space
+
 	//-----------------------
 	//Misc utilities:
 
@@ -94,6 +169,25 @@ struct Helpers {
 
 	//-----------------------
 	//internals:
+
+	// A single VkDeviceMemory that Allocations are sub-allocated from:
+	struct MemorySlab {
+		VkDeviceMemory handle = VK_NULL_HANDLE;
+		VkDeviceSize size = 0;
+		void *mapped = nullptr; // whole slab, mapped once at creation if the memory type is host-visible
+		uint32_t memory_type_index = 0;
+		ResourceKind kind = LinearResource;
+		bool dedicated = false; // made for one large allocation; released as soon as that is freed
+		std::map< VkDeviceSize, VkDeviceSize > free_ranges; // offset -> size; adjacent ranges are always merged
+		VkDeviceSize live_bytes = 0;
+		uint32_t live_allocations = 0;
+	};
+	std::vector< std::unique_ptr< MemorySlab > > slabs;
+	VkDeviceSize buffer_image_granularity = 1; // from the physical device limits, set in create()
+	VkDeviceSize slab_size(uint32_t memory_type_index) const; // size of new (non-dedicated) slabs for a memory type
+	MemorySlab &create_slab(VkDeviceSize size, uint32_t memory_type_index, ResourceKind kind, bool dedicated);
+	void destroy_slab(MemorySlab &slab);
+
 	Helpers(RTG const &);
 	Helpers(Helpers const &) = delete; //you shouldn't be copying Helpers
 	~Helpers();
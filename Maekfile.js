@@ -36,6 +36,11 @@ const main_objs = [
 	maek.CPP('main.cpp'),
 	maek.CPP("sejp.cpp"),
 	maek.CPP("S72.cpp"),
+	maek.CPP("S72-Cache.cpp"),
+	maek.CPP("ThreadPool.cpp"),
+	maek.CPP("BVH.cpp"),
+	maek.CPP("Benchmark.cpp"),
+	maek.CPP("MeshSimplifier.cpp"),
 ];
 
 //maek.GLSLC(...) builds a glsl source file:
@@ -62,6 +67,19 @@ const objects_shaders = [
 ];
 main_objs.push( maek.CPP('Tutorial-ObjectsPipeline.cpp', undefined, { depends:[...objects_shaders] } ) );
 
+//culling compute shader and pipeline (for --culling gpu, and --culling hiz with occlusion tests compiled in):
+const cull_shaders = [
+	maek.GLSLC('cull.comp'),
+	maek.GLSLC('cull.comp', 'spv/cull-occlusion.comp', { GLSLCFlags:['-DOCCLUSION'] }),
+];
+main_objs.push( maek.CPP('Tutorial-CullPipeline.cpp', undefined, { depends:[...cull_shaders] } ) );
+
+//depth pyramid compute shader and pipeline (for --culling hiz):
+const depth_pyramid_shaders = [
+	maek.GLSLC('depth_pyramid.comp'),
+];
+main_objs.push( maek.CPP('Tutorial-DepthPyramidPipeline.cpp', undefined, { depends:[...depth_pyramid_shaders] } ) );
+
 // const prebuilt_objs = [ ];
 
 // //use the prebuilt refsol.o unless refsol.cpp exists:
@@ -96,12 +114,14 @@ function custom_flags_and_rules() {
 
 		maek.options.CPPFlags = [
 			'-O2',
+			'-pthread',
 			`-I${VULKAN_SDK}/include`,
 			`-I${GLFW_DIR}/include`
 		];
 
 		maek.options.LINKLibs = [
 			'-O2',
+			'-pthread',
 			`-L${VULKAN_SDK}/lib`,
 			`-lvulkan`,
 			`-L${GLFW_DIR}/lib`,
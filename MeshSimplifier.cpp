@@ -0,0 +1,215 @@
+#include "MeshSimplifier.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+void MeshSimplifier::Quadric::add_plane(double a, double b, double c, double d) {
+	q[0] += a * a; q[1] += a * b; q[2] += a * c; q[3] += a * d;
+	q[4] += b * b; q[5] += b * c; q[6] += b * d;
+	q[7] += c * c; q[8] += c * d;
+	q[9] += d * d;
+}
+
+void MeshSimplifier::Quadric::add(Quadric const &other) {
+	for (uint32_t i = 0; i < 10; ++i) {
+		q[i] += other.q[i];
+	}
+}
+
+double MeshSimplifier::Quadric::evaluate(float const *p) const {
+	double x = p[0], y = p[1], z = p[2];
+	return q[0] * x * x + 2.0 * q[1] * x * y + 2.0 * q[2] * x * z + 2.0 * q[3] * x
+	     + q[4] * y * y + 2.0 * q[5] * y * z + 2.0 * q[6] * y
+	     + q[7] * z * z + 2.0 * q[8] * z
+	     + q[9];
+}
+
+// (b - a) x (c - a):
+static std::array< float, 3 > triangle_normal(float const *a, float const *b, float const *c) {
+	float u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+	float v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+	return { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+}
+
+void MeshSimplifier::init(std::vector< float > positions_, std::vector< uint32_t > indices_) {
+	positions = std::move(positions_);
+	uint32_t vertex_count = uint32_t(positions.size() / 3);
+	error = 0.0f;
+
+	// keep only real triangles:
+	indices.clear();
+	indices.reserve(indices_.size());
+	for (size_t t = 0; t + 2 < indices_.size(); t += 3) {
+		uint32_t a = indices_[t], b = indices_[t + 1], c = indices_[t + 2];
+		if (a == b || b == c || a == c) continue;
+		indices.insert(indices.end(), { a, b, c });
+	}
+
+	locked.assign(vertex_count, 0);
+
+	// vertices at the same position are copies split by some other attribute (normal, texcoord); merging one away would tear the seam open:
+	std::vector< uint32_t > canonical(vertex_count); // first vertex with the same position
+	{
+		struct PositionHash {
+			size_t operator()(std::array< uint32_t, 3 > const &p) const {
+				return (size_t(p[0]) * 73856093u) ^ (size_t(p[1]) * 19349663u) ^ (size_t(p[2]) * 83492791u);
+			}
+		};
+		std::unordered_map< std::array< uint32_t, 3 >, uint32_t, PositionHash > first;
+		first.reserve(vertex_count);
+		for (uint32_t v = 0; v < vertex_count; ++v) {
+			std::array< uint32_t, 3 > bits;
+			std::memcpy(bits.data(), &positions[3 * v], sizeof(bits));
+			auto [it, inserted] = first.emplace(bits, v);
+			canonical[v] = it->second;
+			if (!inserted) {
+				locked[it->second] = 1;
+				locked[v] = 1;
+			}
+		}
+	}
+
+	// edges (between positions) with only one triangle are open borders (and with more than two, non-manifold); those stay put too:
+	{
+		auto edge_key = [&](uint32_t a, uint32_t b) {
+			a = canonical[a];
+			b = canonical[b];
+			return (uint64_t(std::min(a, b)) << 32) | uint64_t(std::max(a, b));
+		};
+		std::unordered_map< uint64_t, uint32_t > uses;
+		uses.reserve(indices.size());
+		for (size_t t = 0; t < indices.size(); t += 3) {
+			for (uint32_t k = 0; k < 3; ++k) {
+				uses[edge_key(indices[t + k], indices[t + (k + 1) % 3])] += 1;
+			}
+		}
+		for (size_t t = 0; t < indices.size(); t += 3) {
+			for (uint32_t k = 0; k < 3; ++k) {
+				uint32_t a = indices[t + k], b = indices[t + (k + 1) % 3];
+				if (uses[edge_key(a, b)] != 2) {
+					locked[a] = 1;
+					locked[b] = 1;
+				}
+			}
+		}
+	}
+
+	// every vertex starts out knowing the planes of the triangles around it (unweighted, so the error stays a distance):
+	quadrics.assign(vertex_count, Quadric());
+	for (size_t t = 0; t < indices.size(); t += 3) {
+		float const *p0 = &positions[3 * indices[t + 0]];
+		float const *p1 = &positions[3 * indices[t + 1]];
+		float const *p2 = &positions[3 * indices[t + 2]];
+		std::array< float, 3 > n = triangle_normal(p0, p1, p2);
+		double length = std::sqrt(double(n[0]) * n[0] + double(n[1]) * n[1] + double(n[2]) * n[2]);
+		if (length == 0.0) continue;
+		double a = n[0] / length, b = n[1] / length, c = n[2] / length;
+		double d = -(a * p0[0] + b * p0[1] + c * p0[2]);
+		for (uint32_t k = 0; k < 3; ++k) {
+			quadrics[indices[t + k]].add_plane(a, b, c, d);
+		}
+	}
+}
+
+void MeshSimplifier::simplify(uint32_t target_triangles) {
+	uint32_t vertex_count = uint32_t(positions.size() / 3);
+	std::vector< uint32_t > first_triangle(vertex_count + 1);
+	std::vector< uint32_t > vertex_triangles;
+	std::vector< uint32_t > remap(vertex_count);
+	std::vector< uint8_t > touched(vertex_count);
+
+	struct Collapse {
+		double cost;
+		uint32_t from, to; // 'from' is merged into 'to'
+	};
+	std::vector< Collapse > collapses;
+
+	// Each pass sorts every possible collapse by cost, then takes the cheapest ones that don't overlap
+	// (nothing around an already-collapsed vertex is touched again until the next pass, when costs are fresh):
+	while (indices.size() / 3 > target_triangles) {
+		uint32_t triangles = uint32_t(indices.size() / 3);
+
+		// triangles around each vertex:
+		std::fill(first_triangle.begin(), first_triangle.end(), 0);
+		for (uint32_t i : indices) first_triangle[i + 1] += 1;
+		for (uint32_t v = 0; v < vertex_count; ++v) first_triangle[v + 1] += first_triangle[v];
+		vertex_triangles.resize(indices.size());
+		{
+			std::vector< uint32_t > head(first_triangle.begin(), first_triangle.end() - 1);
+			for (uint32_t t = 0; t < triangles; ++t) {
+				for (uint32_t k = 0; k < 3; ++k) {
+					vertex_triangles[head[indices[3 * t + k]]++] = t;
+				}
+			}
+		}
+
+		collapses.clear();
+		for (uint32_t t = 0; t < triangles; ++t) {
+			for (uint32_t k = 0; k < 3; ++k) {
+				uint32_t a = indices[3 * t + k], b = indices[3 * t + (k + 1) % 3];
+				for (auto [from, to] : { std::pair{ a, b }, std::pair{ b, a } }) {
+					if (locked[from]) continue;
+					Quadric q = quadrics[from];
+					q.add(quadrics[to]);
+					collapses.emplace_back(Collapse{ .cost = std::max(0.0, q.evaluate(&positions[3 * to])), .from = from, .to = to });
+				}
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](Collapse const &a, Collapse const &b) {
+			if (a.cost != b.cost) return a.cost < b.cost;
+			if (a.from != b.from) return a.from < b.from;
+			return a.to < b.to;
+		});
+
+		for (uint32_t v = 0; v < vertex_count; ++v) remap[v] = v;
+		std::fill(touched.begin(), touched.end(), 0);
+		uint32_t removed = 0;
+		for (Collapse const &c : collapses) {
+			if (triangles - removed <= target_triangles) break;
+			if (touched[c.from] || touched[c.to]) continue;
+
+			// moving 'from' onto 'to' removes the triangles they share, and must not turn any other triangle around 'from' over:
+			uint32_t gone = 0;
+			bool flips = false;
+			for (uint32_t j = first_triangle[c.from]; j < first_triangle[c.from + 1] && !flips; ++j) {
+				uint32_t const *tri = &indices[3 * vertex_triangles[j]];
+				if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to) {
+					gone += 1;
+					continue;
+				}
+				float const *before[3], *after[3];
+				for (uint32_t k = 0; k < 3; ++k) {
+					before[k] = &positions[3 * tri[k]];
+					after[k] = (tri[k] == c.from ? &positions[3 * c.to] : before[k]);
+				}
+				std::array< float, 3 > n0 = triangle_normal(before[0], before[1], before[2]);
+				std::array< float, 3 > n1 = triangle_normal(after[0], after[1], after[2]);
+				flips = (n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2] <= 0.0f);
+			}
+			if (flips || gone == 0) continue;
+
+			remap[c.from] = c.to;
+			quadrics[c.to].add(quadrics[c.from]);
+			error = std::max(error, float(std::sqrt(c.cost)));
+			removed += gone;
+			for (uint32_t j = first_triangle[c.from]; j < first_triangle[c.from + 1]; ++j) {
+				uint32_t const *tri = &indices[3 * vertex_triangles[j]];
+				touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+			}
+		}
+		if (removed == 0) break; // nothing left that can collapse
+
+		// apply, dropping the triangles that collapsed to lines:
+		size_t out = 0;
+		for (size_t t = 0; t < indices.size(); t += 3) {
+			uint32_t a = remap[indices[t]], b = remap[indices[t + 1]], c = remap[indices[t + 2]];
+			if (a == b || b == c || a == c) continue;
+			indices[out++] = a;
+			indices[out++] = b;
+			indices[out++] = c;
+		}
+		indices.resize(out);
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+// Quadric-error edge collapse (Garland & Heckbert '97), used to build level-of-detail chains for meshes at load time.
+// Every collapse merges a vertex into one of its neighbors (no vertex is moved or created), so each level of detail
+// is just a new index list over the original vertices.
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+struct MeshSimplifier {
+	// start from a triangle list; positions holds xyz for every vertex the indices refer to:
+	void init(std::vector< float > positions, std::vector< uint32_t > indices);
+
+	// collapse edges until no more than target_triangles remain, or until nothing is left that can collapse
+	// without tearing an attribute seam or open border, or flipping a triangle over:
+	void simplify(uint32_t target_triangles);
+
+	std::vector< uint32_t > indices; // current triangle list
+	float error = 0.0f; // bound on how far (in position units) the current surface is from the original one
+
+private:
+	// sum of squared distances to a set of planes, as the symmetric 4x4 matrix [A b; b^T c]:
+	struct Quadric {
+		std::array< double, 10 > q{}; // aa ab ac ad bb bc bd cc cd dd
+		void add_plane(double a, double b, double c, double d);
+		void add(Quadric const &other);
+		double evaluate(float const *p) const;
+	};
+
+	std::vector< float > positions;
+	std::vector< Quadric > quadrics; // per vertex: the planes of its original triangles (and of every vertex merged into it)
+	std::vector< uint8_t > locked; // per vertex: on an attribute seam or an open border, so it can't be merged away
+};
@@ -2,16 +2,20 @@
 
 #include <vulkan/vulkan_core.h>
 
+#include <cstddef>
 #include <cstdint>
 
 struct PosNorTexTanVertex {
     struct { float x,y,z; } Position;
     struct { float x,y,z; } Normal;
-    struct { float s, t; } TexCoord; // s  horizontal (like u), t = vertical (like v). OpenGL convention for texture coordinates.
     struct { float x,y,z, w; } Tangent; // optional, only if mesh has TANGENT attribute
+    struct { float s, t; } TexCoord; // s  horizontal (like u), t = vertical (like v). OpenGL convention for texture coordinates.
 
     // a pipeline vertex input state that works with a buffer holding a PosNorTexTanVertex[] array:
     static const VkPipelineVertexInputStateCreateInfo array_input_state;
 };
 
-static_assert(sizeof(PosNorTexTanVertex) == 3*4 + 3*4 + 2*4 + 4*4, "PosNorTexTanVertex is packed.");
\ No newline at end of file
+static_assert(sizeof(PosNorTexTanVertex) == 3*4 + 3*4 + 4*4 + 2*4, "PosNorTexTanVertex is packed.");
+
+// member order matches the s72 "pnTt" interleaved layout (POSITION@0, NORMAL@12, TANGENT@24, TEXCOORD@40), so such data can be used without repacking:
+static_assert(offsetof(PosNorTexTanVertex, Normal) == 12 && offsetof(PosNorTexTanVertex, Tangent) == 24 && offsetof(PosNorTexTanVertex, TexCoord) == 40, "PosNorTexTanVertex matches pnTt layout.");
\ No newline at end of file
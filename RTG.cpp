@@ -12,6 +12,7 @@
 #include <vulkan/utility/vk_format_utils.h> //for getting format sizes
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <cstring>
@@ -66,9 +67,80 @@ void RTG::Configuration::parse(int argc, char **argv) {
 			if (argi + 1 >= argc) throw std::runtime_error("--culling requires a parameter (a culling mode).");
 			argi += 1;
 			culling_mode = argv[argi];
-			if (culling_mode != "none" && culling_mode != "frustum") {
-				throw std::runtime_error("--culling must be 'none' or 'frustum'.");
+			if (culling_mode != "none" && culling_mode != "frustum" && culling_mode != "bvh" && culling_mode != "gpu" && culling_mode != "hiz") {
+				throw std::runtime_error("--culling must be 'none', 'frustum', 'bvh', 'gpu', or 'hiz'.");
 			}
+		} else if (arg == "--weld") {
+			weld_meshes = true;
+		} else if (arg == "--no-weld") {
+			weld_meshes = false;
+		} else if (arg == "--lod-levels") {
+			if (argi + 1 >= argc) throw std::runtime_error("--lod-levels requires a parameter (a level count).");
+			argi += 1;
+			std::string val = argv[argi];
+			if (val.empty() || val.find_first_not_of("0123456789") != std::string::npos || std::stoul(val) < 1 || std::stoul(val) > 4) {
+				throw std::runtime_error("--lod-levels should be between 1 and 4, got '" + val + "'.");
+			}
+			lod_levels = uint32_t(std::stoul(val));
+		} else if (arg == "--lod-bias") {
+			if (argi + 1 >= argc) throw std::runtime_error("--lod-bias requires a parameter (a number).");
+			argi += 1;
+			std::string val = argv[argi];
+			size_t used = 0;
+			try {
+				lod_bias = std::stof(val, &used);
+			} catch (std::exception &) {
+				used = 0;
+			}
+			if (used == 0 || used != val.size()) {
+				throw std::runtime_error("--lod-bias should be a number, got '" + val + "'.");
+			}
+		} else if (arg == "--load-threads") {
+			if (argi + 1 >= argc) throw std::runtime_error("--load-threads requires a parameter (a thread count).");
+			argi += 1;
+			std::string val = argv[argi];
+			if (val.empty() || val.find_first_not_of("0123456789") != std::string::npos) {
+				throw std::runtime_error("--load-threads should match [0-9]+, got '" + val + "'.");
+			}
+			load_threads = uint32_t(std::stoul(val));
+		} else if (arg == "--scene-cache") {
+			scene_cache = true;
+		} else if (arg == "--rebuild-cache") {
+			scene_cache = true;
+			rebuild_cache = true;
+		} else if (arg == "--record-threads") {
+			if (argi + 1 >= argc) throw std::runtime_error("--record-threads requires a parameter (a thread count).");
+			argi += 1;
+			std::string val = argv[argi];
+			if (val.empty() || val.find_first_not_of("0123456789") != std::string::npos) {
+				throw std::runtime_error("--record-threads should match [0-9]+, got '" + val + "'.");
+			}
+			record_threads = uint32_t(std::stoul(val));
+		} else if (arg == "--animation-threads") {
+			if (argi + 1 >= argc) throw std::runtime_error("--animation-threads requires a parameter (a thread count).");
+			argi += 1;
+			std::string val = argv[argi];
+			if (val.empty() || val.find_first_not_of("0123456789") != std::string::npos) {
+				throw std::runtime_error("--animation-threads should match [0-9]+, got '" + val + "'.");
+			}
+			animation_threads = uint32_t(std::stoul(val));
+		} else if (arg == "--gpu-profile") {
+			gpu_profile = true;
+		} else if (arg == "--gpu-profile-csv") {
+			if (argi + 1 >= argc) throw std::runtime_error("--gpu-profile-csv requires a parameter (a file name).");
+			argi += 1;
+			gpu_profile = true;
+			gpu_profile_csv = argv[argi];
+		} else if (arg == "--benchmark") {
+			if (argi + 1 >= argc) throw std::runtime_error("--benchmark requires a parameter (an events file).");
+			argi += 1;
+			benchmark = argv[argi];
+			headless = true;
+			gpu_profile = true; // (for GPU frame times)
+		} else if (arg == "--benchmark-json") {
+			if (argi + 1 >= argc) throw std::runtime_error("--benchmark-json requires a parameter (a file name).");
+			argi += 1;
+			benchmark_json = argv[argi];
 		} else {
 			throw std::runtime_error("Unrecognized argument '" + arg + "'.");
 		}
@@ -80,6 +152,19 @@ void RTG::Configuration::usage(std::function< void(const char *, const char *) >
 	callback("--physical-device <name>", "Run on the named physical device (guesses, otherwise).");
 	callback("--drawing-size <w> <h>", "Set the size of the surface to draw to.");
 	callback("--headless", "Don't create a window; read events from stdin.");
+	callback("--culling <mode>", "Cull nothing ('none'), each instance on the CPU ('frustum'), with a CPU bounding volume hierarchy ('bvh'), in a compute shader that writes indirect draws ('gpu'), or that way plus occlusion tests against last frame's depth ('hiz').");
+	callback("--weld, --no-weld", "Turn on/off merging identical vertices of non-indexed meshes into an index buffer (default: off).");
+	callback("--lod-levels <N>", "Build up to N levels of detail (1-4) for meshes with 256 or more triangles, welding them if needed (which copies pnTt meshes instead of mapping them); 1 turns this off (default: 1).");
+	callback("--lod-bias <B>", "Draw coarser (B > 0) or finer (B < 0) levels of detail: a level is used once its error covers at most 2^B pixels (default: 0).");
+	callback("--load-threads <N>", "Load the scene with N threads (default: 0, meaning one per hardware thread).");
+	callback("--scene-cache", "Start from <scene>c (e.g., scene.s72c), a compiled copy of the loaded and processed scene, when it's up to date with the scene, data files, and textures; write it otherwise.");
+	callback("--rebuild-cache", "Like --scene-cache, but always rebuild and rewrite the compiled copy.");
+	callback("--record-threads <N>", "Record each frame's draws with N threads, in secondary command buffers (default: 1, meaning inline on the main thread; 0 means one per hardware thread).");
+	callback("--animation-threads <N>", "Evaluate drivers and update transforms with N threads (default: 1, meaning inline; 0 means one per hardware thread).");
+	callback("--gpu-profile", "Measure GPU time per phase of the frame (culling, background, lines, objects, depth pyramid) and count shader invocations; report about once a second.");
+	callback("--gpu-profile-csv <file>", "Like --gpu-profile, and also write every frame's numbers to <file> as CSV.");
+	callback("--benchmark <events-file>", "Run headless with events (AVAILABLE dt [save.ppm] lines) from <events-file>, timing every frame; implies --headless and --gpu-profile.");
+	callback("--benchmark-json <file>", "Where --benchmark writes min/median/p95/p99/max frame times and peak memory (default: benchmark.json).");
 }
 
 static VKAPI_ATTR VkBool32 VKAPI_CALL debug_callback(
@@ -102,6 +187,29 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debug_callback(
 	return VK_FALSE;
 }
 
+//the objects pipeline binds every texture at once through one runtime-sized, partially-bound, variable-count, update-after-bind
+//array of samplers that it indexes per-instance (Vulkan 1.2 descriptor indexing), so a device without these can't be used:
+static bool supports_descriptor_indexing(VkPhysicalDevice physical_device) {
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physical_device, &properties);
+	if (properties.apiVersion < VK_API_VERSION_1_2) return false;
+
+	VkPhysicalDeviceVulkan12Features supported12{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+	};
+	VkPhysicalDeviceFeatures2 supported{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+		.pNext = &supported12,
+	};
+	vkGetPhysicalDeviceFeatures2(physical_device, &supported);
+
+	return supported12.runtimeDescriptorArray
+	    && supported12.shaderSampledImageArrayNonUniformIndexing
+	    && supported12.descriptorBindingPartiallyBound
+	    && supported12.descriptorBindingVariableDescriptorCount
+	    && supported12.descriptorBindingSampledImageUpdateAfterBind;
+}
+
 RTG::RTG(Configuration const &configuration_) : helpers(*this) {
 
 	//copy input configuration:
@@ -253,11 +361,15 @@ RTG::RTG(Configuration const &configuration_) : helpers(*this) {
 					if (configuration.physical_device_name == properties.deviceName) {
 						if (physical_device) {
 							std::cerr << "WARNING: have two physical devices with the name '" << properties.deviceName << "'; using the first to be enumerated." << std::endl;
+						} else if (!supports_descriptor_indexing(pd)) {
+							throw std::runtime_error("Physical device '" + std::string(properties.deviceName) + "' doesn't support the descriptor indexing features (runtimeDescriptorArray, partially-bound, variable-count, update-after-bind sampled images, non-uniform indexing) needed to bind every texture at once.");
 						} else {
 							physical_device = pd;
 						}
 					}
 				} else { // or (b) look for a device with a high "score" for a simple scoring function:
+					if (!supports_descriptor_indexing(pd)) continue; //(required; see above)
+
 					uint32_t score = 1;
 					//  just looks for any discrete GPU. You might -- at some point -- want to refine this to look for specific features of interest.
 					if (properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
@@ -283,7 +395,7 @@ RTG::RTG(Configuration const &configuration_) : helpers(*this) {
 			if (!configuration.physical_device_name.empty()) {
 				throw std::runtime_error("No physical device with name '" + configuration.physical_device_name + "'.");
 			} else {
-				throw std::runtime_error("No suitable GPU found.");
+				throw std::runtime_error("No suitable GPU found (need Vulkan 1.2 descriptor indexing: runtimeDescriptorArray, partially-bound, variable-count, update-after-bind sampled images, non-uniform indexing).");
 			}
 		}
 
@@ -397,6 +509,11 @@ RTG::RTG(Configuration const &configuration_) : helpers(*this) {
 				if (queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
 					if (!graphics_queue_family) graphics_queue_family = i; // std::optional< uint32_t > type allows us to check them as bools (testing if they contain a value) and set them to indices.
 				}
+
+				//if it does *only* transfers (usually a dedicated DMA engine), use it for uploads:
+				if ((queue_family.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queue_family.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+					if (!transfer_queue_family) transfer_queue_family = i;
+				}
 				
 				if (!configuration.headless) { // the call to check for presentation support is part of the WSI extension
 					//if it has present support, set the present queue family:
@@ -417,6 +534,11 @@ RTG::RTG(Configuration const &configuration_) : helpers(*this) {
 				throw std::runtime_error("No queue with graphics support.");
 			}
 
+			//graphics queues can always do transfers, so fall back to that:
+			if (!transfer_queue_family) {
+				transfer_queue_family = graphics_queue_family;
+			}
+
 			if (!present_queue_family) {
 				throw std::runtime_error("No queue with present support.");
 			}
@@ -432,11 +554,69 @@ RTG::RTG(Configuration const &configuration_) : helpers(*this) {
 			device_extensions.emplace_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 		}
 
+		//select optional device features:
+		VkPhysicalDeviceVulkan12Features features12{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+		};
+		VkPhysicalDeviceFeatures2 features{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+			.pNext = &features12,
+		};
+		{ //check which optional features the device has:
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(physical_device, &properties);
+
+			VkPhysicalDeviceVulkan12Features supported12{
+				.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+			};
+			VkPhysicalDeviceFeatures2 supported{
+				.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+				.pNext = &supported12,
+			};
+			if (properties.apiVersion >= VK_API_VERSION_1_2) {
+				vkGetPhysicalDeviceFeatures2(physical_device, &supported);
+			}
+
+			//GPU-driven drawing (--culling gpu/hiz) wants vkCmdDraw*IndirectCount with more than one draw per call:
+			if (supported.features.multiDrawIndirect && supported12.drawIndirectCount) {
+				features.features.multiDrawIndirect = VK_TRUE;
+				features12.drawIndirectCount = VK_TRUE;
+				draw_indirect_count = true;
+			}
+
+			//bindless textures want one big, sparsely-filled array of samplers that can be indexed per-instance:
+			// (required -- the physical device was only picked if it has these)
+			assert(supports_descriptor_indexing(physical_device));
+			features12.runtimeDescriptorArray = VK_TRUE;
+			features12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+			features12.descriptorBindingPartiallyBound = VK_TRUE;
+			features12.descriptorBindingVariableDescriptorCount = VK_TRUE;
+			features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+
+			//--gpu-profile counts vertex/fragment invocations with pipeline statistics queries (and needs inherited queries to keep one active across secondary command buffers):
+			if (supported.features.pipelineStatisticsQuery) {
+				features.features.pipelineStatisticsQuery = VK_TRUE;
+				pipeline_statistics_query = true;
+			}
+			if (supported.features.inheritedQueries) {
+				features.features.inheritedQueries = VK_TRUE;
+				inherited_queries = true;
+			}
+
+			//scene textures viewed at grazing angles stay sharp with anisotropic filtering (the sampler asks for as many samples as the device allows, up to 16):
+			if (supported.features.samplerAnisotropy) {
+				features.features.samplerAnisotropy = VK_TRUE;
+				sampler_anisotropy = true;
+				max_sampler_anisotropy = std::min(16.0f, properties.limits.maxSamplerAnisotropy);
+			}
+		}
+
 		{ //create the logical device - the root of all our application-specific Vulkan resources
 			std::vector< VkDeviceQueueCreateInfo > queue_create_infos;
 			std::set< uint32_t > unique_queue_families{
 				graphics_queue_family.value(),
-				present_queue_family.value()
+				present_queue_family.value(),
+				transfer_queue_family.value()
 			};
 
 			float queue_priorities[1] = { 1.0f };
@@ -451,6 +631,7 @@ RTG::RTG(Configuration const &configuration_) : helpers(*this) {
 
 			VkDeviceCreateInfo create_info{
 				.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+				.pNext = &features, //required descriptor indexing features + any optional features (see above)
 				.queueCreateInfoCount = uint32_t(queue_create_infos.size()),
 				.pQueueCreateInfos = queue_create_infos.data(),
 
@@ -469,6 +650,7 @@ RTG::RTG(Configuration const &configuration_) : helpers(*this) {
 
 			vkGetDeviceQueue(device, graphics_queue_family.value(), 0, &graphics_queue);
 			vkGetDeviceQueue(device, present_queue_family.value(), 0, &present_queue);
+			vkGetDeviceQueue(device, transfer_queue_family.value(), 0, &transfer_queue);
 		}
 	}
 
@@ -1043,8 +1225,26 @@ void RTG::run(Application &application) {
 
 	uint32_t headless_next_image = 0;
 
+	// headless events come from stdin, or from the --benchmark events file:
+	bool benchmarking = (configuration.benchmark != "");
+	std::ifstream benchmark_events;
+	if (benchmarking) {
+		benchmark_events.open(configuration.benchmark);
+		if (!benchmark_events) throw std::runtime_error("Failed to open benchmark events file '" + configuration.benchmark + "'.");
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physical_device, &properties);
+		benchmark.scene = configuration.scene_file;
+		benchmark.events = configuration.benchmark;
+		benchmark.device = properties.deviceName;
+	}
+	std::istream &events = (benchmarking ? static_cast< std::istream & >(benchmark_events) : std::cin);
+
 	// setup time handling:
 	std::chrono::high_resolution_clock::time_point before = std::chrono::high_resolution_clock::now();
+	auto ms_between = [](std::chrono::high_resolution_clock::time_point a, std::chrono::high_resolution_clock::time_point b) {
+		return std::chrono::duration< double, std::milli >(b - a).count();
+	};
 
 	while (configuration.headless || !glfwWindowShouldClose(window)) { // run until GLFW lets us know the window should be closed via the glfwWindowShouldClose call.
 		float headless_dt = 0.0f;
@@ -1054,7 +1254,7 @@ void RTG::run(Application &application) {
 		if (configuration.headless) {
 			//read events from stdin
 			std::string line;
-			while (std::getline(std::cin, line)) { // what is getline and std::cin //??
+			while (std::getline(events, line)) { // what is getline and std::cin //??
 				// parse event from line
 				try {
 					std::istringstream iss(line); // what are istringstream//??
@@ -1090,7 +1290,7 @@ void RTG::run(Application &application) {
 				}
 			}
 			//if we've run out of events, stop running the main loop:
-			if (!std::cin) break;
+			if (!events) break;
 		} else {
 			glfwPollEvents();
 		}
@@ -1101,6 +1301,9 @@ void RTG::run(Application &application) {
 		}
 		event_queue.clear();
 
+		// --benchmark stopwatch (event parsing doesn't count as part of the frame):
+		std::chrono::high_resolution_clock::time_point frame_start = std::chrono::high_resolution_clock::now();
+
 		{ // elapsed time handling
 			std::chrono::high_resolution_clock::time_point after = std::chrono::high_resolution_clock::now();
 
@@ -1115,6 +1318,7 @@ void RTG::run(Application &application) {
 
 			application.update(dt); // the Tutorial::update(float dt)
 		}
+		std::chrono::high_resolution_clock::time_point update_done = std::chrono::high_resolution_clock::now();
 
 		// render handling (with on_swapchain as needed):
 		uint32_t workspace_index;
@@ -1188,6 +1392,8 @@ void RTG::run(Application &application) {
 			}
 		}
 
+		std::chrono::high_resolution_clock::time_point wait_done = std::chrono::high_resolution_clock::now();
+
 		//call render function: //?? is this the correct place for it
 		// assembles a RenderParams parameter structure and hands it to the application:
 		application.render(*this, RenderParams{
@@ -1198,6 +1404,8 @@ void RTG::run(Application &application) {
 			.workspace_available = workspaces[workspace_index].workspace_available,
 		});
 
+		std::chrono::high_resolution_clock::time_point render_done = std::chrono::high_resolution_clock::now();
+
 		// queue the rendering work for presentation:
 		 if (configuration.headless) {
 			//in headless mode, submit the copy command we recorded previously:
@@ -1239,6 +1447,16 @@ void RTG::run(Application &application) {
 			}
 		}
 
+		if (benchmarking) { // record how long each part of the frame took:
+			std::chrono::high_resolution_clock::time_point submit_done = std::chrono::high_resolution_clock::now();
+			benchmark.update_ms.emplace_back(ms_between(frame_start, update_done));
+			benchmark.wait_ms.emplace_back(ms_between(update_done, wait_done)); // (includes writing out any .ppm saved by an earlier frame)
+			benchmark.render_ms.emplace_back(ms_between(wait_done, render_done));
+			benchmark.submit_ms.emplace_back(ms_between(render_done, submit_done));
+			benchmark.frame_ms.emplace_back(ms_between(frame_start, submit_done));
+			benchmark.peak_device_bytes = std::max< uint64_t >(benchmark.peak_device_bytes, helpers.memory_stats().reserved_bytes);
+		}
+
 		//TODO: present image (resize swapchain if needed)
 	}
 
@@ -1259,6 +1477,13 @@ void RTG::run(Application &application) {
 		}
 	}
 	
+	if (benchmarking) { // write out results:
+		std::ofstream out(configuration.benchmark_json);
+		if (!out) throw std::runtime_error("Failed to open '" + configuration.benchmark_json + "' for writing benchmark results.");
+		benchmark.write_json(out);
+		std::cout << "Wrote benchmark results for " << benchmark.frame_ms.size() << " frames to '" << configuration.benchmark_json << "'." << std::endl;
+	}
+
 	// tear down event handling
 	if (!configuration.headless) {
 		glfwSetCursorPosCallback(window, nullptr);
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Benchmark.hpp"
 #include "Helpers.hpp"
 #include "InputEvent.hpp"
 
@@ -90,7 +91,45 @@ struct RTG {
 		std::string camera_mode = "user"; // scene/user/debug
 
 		// A2-cull: culling mode
-		std::string culling_mode = "none"; // none/frustum/potentially more for A1-fast
+		std::string culling_mode = "none"; // none/frustum/bvh/gpu/hiz
+
+		// A1-fast: generate index buffers for non-indexed meshes by merging identical vertices
+		// `--weld` and `--no-weld` command-line flags; off by default so pnTt meshes can be uploaded straight from the mapped data file
+		bool weld_meshes = false;
+
+		// levels of detail built for big triangle-list meshes at load time (1 = just the full mesh; at most S72::Mesh::MaxLODLevels),
+		// and how coarse render() is willing to go: each level's error may cover up to 2^lod_bias pixels on screen
+		// `--lod-levels N` and `--lod-bias B` command-line flags; off by default because levels of detail are index lists,
+		// so non-indexed meshes that get them are welded (and pnTt ones are then copied instead of uploaded from the mapped data file)
+		uint32_t lod_levels = 1;
+		float lod_bias = 0.0f;
+
+		// threads used to load the scene (data files, meshes, textures); 0 = one per hardware thread
+		// `--load-threads N` command-line flag
+		uint32_t load_threads = 0;
+
+		// keep a compiled copy of the processed scene next to it (<scene_file>c, e.g. scene.s72c) and start from that when it's up to date
+		// `--scene-cache` and `--rebuild-cache` (ignore any existing cache and write a fresh one) command-line flags
+		bool scene_cache = false;
+		bool rebuild_cache = false;
+
+		// threads used to record the render pass's draws (each into its own secondary command buffer); 1 = record inline, 0 = one per hardware thread
+		// `--record-threads N` command-line flag
+		uint32_t record_threads = 1;
+
+		// threads used to evaluate drivers and propagate transforms every frame; 1 = inline, 0 = one per hardware thread
+		// `--animation-threads N` command-line flag
+		uint32_t animation_threads = 1;
+
+		// GPU timestamps per phase of the frame + pipeline statistics, reported about once a second
+		// `--gpu-profile` command-line flag; `--gpu-profile-csv <file>` also writes every frame's numbers to <file>
+		bool gpu_profile = false;
+		std::string gpu_profile_csv = "";
+
+		// benchmark: run headless with events from <events-file> (instead of stdin), timing every frame; results go to benchmark_json
+		// `--benchmark <events-file>` and `--benchmark-json <file>` command-line flags
+		std::string benchmark = "";
+		std::string benchmark_json = "benchmark.json";
 	};
 
 	Configuration configuration; //configuration, as used (might have extra extensions, layers, or flags added)
@@ -100,6 +139,9 @@ struct RTG {
 	// see Helpers.hpp
 	Helpers helpers;
 
+	//--benchmark samples (filled in by run(); Tutorial adds GPU times):
+	Benchmark benchmark;
+
 	//------------------------------------------------
 	//Basic vulkan handles:
 
@@ -108,6 +150,16 @@ struct RTG {
 	VkPhysicalDevice physical_device = VK_NULL_HANDLE;
 	VkDevice device = VK_NULL_HANDLE;
 
+	//required device features: (devices without these aren't considered when picking physical_device)
+	// - runtime-sized, partially-bound, variable-count, update-after-bind sampler arrays with non-uniform indexing (Vulkan 1.2 descriptor indexing); the objects pipeline binds every texture at once
+
+	//optional device features, enabled if the physical device supports them:
+	bool draw_indirect_count = false; // multiDrawIndirect + drawIndirectCount (Vulkan 1.2); needed for --culling gpu and hiz
+	bool pipeline_statistics_query = false; // VK_QUERY_TYPE_PIPELINE_STATISTICS queries; used by --gpu-profile
+	bool inherited_queries = false; // queries can stay active while secondary command buffers execute (--gpu-profile with --record-threads)
+	bool sampler_anisotropy = false; // anisotropic texture filtering, up to max_sampler_anisotropy samples per lookup
+	float max_sampler_anisotropy = 1.0f;
+
 	//queue for graphics and transfer operations:
 	std::optional< uint32_t > graphics_queue_family; // std::optional< uint32_t > allows us to check them as bools (testing if they contain a value) and set them to indices.
 	VkQueue graphics_queue = VK_NULL_HANDLE;
@@ -116,6 +168,10 @@ struct RTG {
 	std::optional< uint32_t > present_queue_family;
 	VkQueue present_queue = VK_NULL_HANDLE;
 
+	//queue for (asynchronous) uploads; a transfer-only family if the device has one, otherwise the graphics queue:
+	std::optional< uint32_t > transfer_queue_family;
+	VkQueue transfer_queue = VK_NULL_HANDLE;
+
 	//-------------------------------------------------
 	//Handles for the window and surface:
 
@@ -0,0 +1,718 @@
+#include "S72.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+// .s72c layout: a Header, then sections of fixed-size records (each section 16-byte aligned).
+// Objects are stored in the same order as S72's arrays, so references are just the handles' indices; data is referred to by byte Range
+// from the start of the file, so the file can be mapped at any address and read in place -- in particular, the pooled vertices are uploaded straight out of the mapping.
+//
+// NOTE: bump CacheVersion whenever these records, PosNorTexTanVertex, or what the processing steps produce change.
+// NOTE: records are written in this machine's byte order and layout; a cache isn't meant to be copied between machines.
+
+namespace {
+
+constexpr char CacheMagic[8] = { 's', '7', '2', 'c', 'a', 'c', 'h', 'e' };
+constexpr uint32_t CacheVersion = 3;
+constexpr uint32_t None = -1U; // (handle fields: null handle)
+constexpr uint64_t Missing = -1ULL; // (Source::size: the file didn't exist)
+
+struct Range {
+	uint64_t offset = 0; // bytes from start of file
+	uint64_t size = 0; // bytes
+};
+
+struct Name {
+	uint32_t offset = 0; // into the strings section
+	uint32_t size = 0;
+};
+
+struct Header {
+	char magic[8];
+	uint32_t version;
+	uint32_t header_size; // sizeof(Header)
+
+	// processing options the cache was built with:
+	uint32_t weld;
+	uint32_t lod_levels;
+
+	Name scene_name;
+	uint32_t first_root, root_count; // in node_refs
+
+	Range sources;
+	Range strings;
+	Range node_refs; // uint32_t node indices (scene roots, node children)
+	Range nodes, meshes, lods, cameras, drivers, driver_floats, textures, materials, environments, lights;
+	Range vertices; // the pooled vertex buffer (vertices, then every mapped_vertices block)
+	Range indices;
+};
+
+// every file the scene was built from:
+struct Source {
+	Name path;
+	uint64_t size;
+	int64_t mtime; // std::filesystem::file_time_type ticks
+	uint64_t hash; // of the contents (only checked if the mtime doesn't match)
+};
+
+struct Node {
+	Name name;
+	float translation[3], rotation[4], scale[3];
+	uint32_t first_child, child_count; // in node_refs
+	uint32_t mesh, camera, environment, light;
+};
+
+struct Mesh {
+	Name name;
+	uint32_t topology, count, material;
+	uint32_t first_vertex, vertex_count, first_index, index_count;
+	uint32_t first_lod, lod_count;
+	float bbox_min[3], bbox_max[3];
+};
+
+struct LOD {
+	uint32_t first_index, index_count;
+	float error;
+};
+
+struct Camera {
+	Name name;
+	float aspect, vfov, near, far;
+};
+
+struct Driver {
+	Name name;
+	uint32_t node, channel, interpolation;
+	uint32_t time_count, value_count;
+	uint32_t first_float; // in driver_floats: times, then values
+};
+
+struct Texture {
+	Name src, path;
+	uint32_t type, format;
+	int32_t width, height, channels;
+	uint32_t mip_levels;
+	Range pixels; // every mip level, back-to-back
+};
+
+struct Material {
+	Name name;
+	uint32_t normal_map, displacement_map;
+	uint32_t brdf; // index into Material::brdf's variant
+	float albedo[3], roughness, metalness;
+	uint32_t albedo_map, roughness_map, metalness_map; // (None: use the constant)
+};
+
+struct Environment {
+	Name name;
+	uint32_t radiance;
+};
+
+struct Light {
+	Name name;
+	float tint[3];
+	uint32_t shadow;
+	uint32_t source; // index into Light::source's variant
+	float parameters[5]; // Sun: angle, strength; Sphere: radius, power, limit; Spot: radius, power, limit, fov, blend
+};
+
+// FNV-1a over the file's bytes:
+uint64_t hash_bytes(std::span< uint8_t const > bytes) {
+	uint64_t h = 14695981039346656037ull;
+	for (uint8_t b : bytes) {
+		h = (h ^ b) * 1099511628211ull;
+	}
+	return h;
+}
+
+struct FileState {
+	uint64_t size = Missing;
+	int64_t mtime = 0;
+};
+
+FileState file_state(std::string const &path) {
+	std::error_code ec;
+	FileState state;
+	uint64_t size = std::filesystem::file_size(path, ec);
+	if (ec) return state;
+	auto mtime = std::filesystem::last_write_time(path, ec);
+	if (ec) return state;
+	state.size = size;
+	state.mtime = int64_t(mtime.time_since_epoch().count());
+	return state;
+}
+
+uint64_t hash_file(std::string const &path) {
+	S72::DataFile file;
+	file.path = path;
+	file.load();
+	return hash_bytes(file.data);
+}
+
+// builds the file in memory:
+struct Writer {
+	std::vector< uint8_t > bytes;
+	std::string strings;
+
+	Name name(std::string const &str) {
+		Name ret{ .offset = uint32_t(strings.size()), .size = uint32_t(str.size()) };
+		strings += str;
+		return ret;
+	}
+
+	Range append(void const *data, size_t size) {
+		bytes.resize((bytes.size() + 15) & ~size_t(15), 0);
+		Range ret{ .offset = bytes.size(), .size = size };
+		bytes.insert(bytes.end(), static_cast< uint8_t const * >(data), static_cast< uint8_t const * >(data) + size);
+		return ret;
+	}
+
+	template< typename T >
+	Range append(std::vector< T > const &records) {
+		return append(records.data(), records.size() * sizeof(T));
+	}
+};
+
+// reads records in place from the mapped file, checking that everything stays inside it:
+struct Reader {
+	std::span< uint8_t const > file;
+	std::span< char const > strings;
+
+	std::span< uint8_t const > bytes(Range range) const {
+		if (range.offset > file.size() || range.size > file.size() - range.offset) {
+			throw std::runtime_error("section runs past the end of the file");
+		}
+		return file.subspan(size_t(range.offset), size_t(range.size));
+	}
+
+	template< typename T >
+	std::span< T const > records(Range range) const {
+		std::span< uint8_t const > data = bytes(range);
+		if (data.size() % sizeof(T) != 0 || range.offset % alignof(T) != 0) {
+			throw std::runtime_error("misaligned section");
+		}
+		return std::span< T const >(reinterpret_cast< T const * >(data.data()), data.size() / sizeof(T));
+	}
+
+	std::string string(Name name) const {
+		if (name.offset > strings.size() || name.size > strings.size() - name.offset) {
+			throw std::runtime_error("name runs past the end of the strings");
+		}
+		return std::string(strings.data() + name.offset, name.size);
+	}
+};
+
+// topologies S72::load can produce:
+bool known_topology(uint32_t topology) {
+	for (VkPrimitiveTopology known : {
+		VK_PRIMITIVE_TOPOLOGY_POINT_LIST, VK_PRIMITIVE_TOPOLOGY_LINE_LIST, VK_PRIMITIVE_TOPOLOGY_LINE_STRIP,
+		VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_FAN,
+		VK_PRIMITIVE_TOPOLOGY_LINE_LIST_WITH_ADJACENCY, VK_PRIMITIVE_TOPOLOGY_LINE_STRIP_WITH_ADJACENCY,
+		VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST_WITH_ADJACENCY, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP_WITH_ADJACENCY,
+		VK_PRIMITIVE_TOPOLOGY_PATCH_LIST,
+	}) {
+		if (topology == uint32_t(known)) return true;
+	}
+	return false;
+}
+
+// stored index -> handle, checking that it refers to one of the count objects (or is None):
+template< typename T >
+S72::Handle< T > handle(uint32_t index, size_t count) {
+	if (index != None && index >= count) throw std::runtime_error("reference out of range");
+	return S72::Handle< T >{ .index = index };
+}
+
+} // namespace
+
+void S72::save_cache(std::string const &cache_file, std::string const &scene_file, CacheOptions const &options) const {
+	auto before = std::chrono::high_resolution_clock::now();
+
+	Writer writer;
+	writer.bytes.resize(sizeof(Header));
+
+	Header header{};
+	std::memcpy(header.magic, CacheMagic, sizeof(header.magic));
+	header.version = CacheVersion;
+	header.header_size = sizeof(Header);
+	header.weld = options.weld ? 1 : 0;
+	header.lod_levels = options.lod_levels;
+	header.scene_name = writer.name(scene.name);
+
+	{ // sources:
+		std::vector< std::string > paths;
+		paths.emplace_back(scene_file);
+		for (DataFile const &data_file : data_files) paths.emplace_back(data_file.path);
+		for (Texture const &texture : textures) paths.emplace_back(texture.path);
+		std::sort(paths.begin() + 1, paths.end());
+		paths.erase(std::unique(paths.begin() + 1, paths.end()), paths.end());
+
+		std::vector< Source > sources;
+		for (std::string const &path : paths) {
+			FileState state = file_state(path);
+			sources.emplace_back(Source{
+				.path = writer.name(path),
+				.size = state.size,
+				.mtime = state.mtime,
+				.hash = (state.size == Missing ? 0 : hash_file(path)),
+			});
+		}
+		header.sources = writer.append(sources);
+	}
+
+	std::vector< uint32_t > node_refs;
+	header.first_root = uint32_t(node_refs.size());
+	header.root_count = uint32_t(scene.roots.size());
+	for (NodeHandle root : scene.roots) node_refs.emplace_back(root.index);
+
+	std::vector< ::Node > node_records;
+	for (Node const &node : nodes) {
+		node_records.emplace_back(::Node{
+			.name = writer.name(node.name),
+			.translation = { node.translation.x, node.translation.y, node.translation.z },
+			.rotation = { node.rotation.x, node.rotation.y, node.rotation.z, node.rotation.w },
+			.scale = { node.scale.x, node.scale.y, node.scale.z },
+			.first_child = uint32_t(node_refs.size()),
+			.child_count = uint32_t(node.children.size()),
+			.mesh = node.mesh.index,
+			.camera = node.camera.index,
+			.environment = node.environment.index,
+			.light = node.light.index,
+		});
+		for (NodeHandle child : node.children) node_refs.emplace_back(child.index);
+	}
+	header.nodes = writer.append(node_records);
+	header.node_refs = writer.append(node_refs);
+
+	std::vector< ::Mesh > mesh_records;
+	std::vector< ::LOD > lod_records;
+	for (Mesh const &mesh : meshes) {
+		mesh_records.emplace_back(::Mesh{
+			.name = writer.name(mesh.name),
+			.topology = uint32_t(mesh.topology),
+			.count = mesh.count,
+			.material = mesh.material.index,
+			.first_vertex = mesh.first_vertex,
+			.vertex_count = mesh.vertex_count,
+			.first_index = mesh.first_index,
+			.index_count = mesh.index_count,
+			.first_lod = uint32_t(lod_records.size()),
+			.lod_count = uint32_t(mesh.lods.size()),
+			.bbox_min = { mesh.bbox_min.x, mesh.bbox_min.y, mesh.bbox_min.z },
+			.bbox_max = { mesh.bbox_max.x, mesh.bbox_max.y, mesh.bbox_max.z },
+		});
+		for (Mesh::LOD const &lod : mesh.lods) {
+			lod_records.emplace_back(::LOD{ .first_index = lod.first_index, .index_count = lod.index_count, .error = lod.error });
+		}
+	}
+	header.meshes = writer.append(mesh_records);
+	header.lods = writer.append(lod_records);
+
+	std::vector< ::Camera > camera_records;
+	for (Camera const &camera : cameras) {
+		Camera::Perspective const &perspective = std::get< Camera::Perspective >(camera.projection);
+		camera_records.emplace_back(::Camera{
+			.name = writer.name(camera.name),
+			.aspect = perspective.aspect,
+			.vfov = perspective.vfov,
+			.near = perspective.near,
+			.far = perspective.far,
+		});
+	}
+	header.cameras = writer.append(camera_records);
+
+	std::vector< ::Driver > driver_records;
+	std::vector< float > driver_floats;
+	for (Driver const &driver : drivers) {
+		driver_records.emplace_back(::Driver{
+			.name = writer.name(driver.name),
+			.node = driver.node.index,
+			.channel = uint32_t(driver.channel),
+			.interpolation = uint32_t(driver.interpolation),
+			.time_count = uint32_t(driver.times.size()),
+			.value_count = uint32_t(driver.values.size()),
+			.first_float = uint32_t(driver_floats.size()),
+		});
+		driver_floats.insert(driver_floats.end(), driver.times.begin(), driver.times.end());
+		driver_floats.insert(driver_floats.end(), driver.values.begin(), driver.values.end());
+	}
+	header.drivers = writer.append(driver_records);
+	header.driver_floats = writer.append(driver_floats);
+
+	std::vector< ::Texture > texture_records;
+	for (Texture const &texture : textures) {
+		texture_records.emplace_back(::Texture{
+			.src = writer.name(texture.src),
+			.path = writer.name(texture.path),
+			.type = uint32_t(texture.type),
+			.format = uint32_t(texture.format),
+			.width = texture.width,
+			.height = texture.height,
+			.channels = texture.channels,
+			.mip_levels = texture.mip_levels,
+			.pixels = writer.append(texture.pixels),
+		});
+	}
+	header.textures = writer.append(texture_records);
+
+	std::vector< ::Material > material_records;
+	for (Material const &material : materials) {
+		::Material record{
+			.name = writer.name(material.name),
+			.normal_map = material.normal_map.index,
+			.displacement_map = material.displacement_map.index,
+			.brdf = uint32_t(material.brdf.index()),
+			.albedo = { 1.0f, 1.0f, 1.0f },
+			.roughness = 1.0f,
+			.metalness = 0.0f,
+			.albedo_map = None,
+			.roughness_map = None,
+			.metalness_map = None,
+		};
+		auto albedo = [&](std::variant< color, TextureHandle > const &value) {
+			if (TextureHandle const *map = std::get_if< TextureHandle >(&value)) {
+				record.albedo_map = map->index;
+			} else {
+				color const &c = std::get< color >(value);
+				record.albedo[0] = c.r; record.albedo[1] = c.g; record.albedo[2] = c.b;
+			}
+		};
+		auto scalar = [&](std::variant< float, TextureHandle > const &value, float *constant, uint32_t *map) {
+			if (TextureHandle const *texture = std::get_if< TextureHandle >(&value)) *map = texture->index;
+			else *constant = std::get< float >(value);
+		};
+		if (Material::PBR const *pbr = std::get_if< Material::PBR >(&material.brdf)) {
+			albedo(pbr->albedo);
+			scalar(pbr->roughness, &record.roughness, &record.roughness_map);
+			scalar(pbr->metalness, &record.metalness, &record.metalness_map);
+		} else if (Material::Lambertian const *lambertian = std::get_if< Material::Lambertian >(&material.brdf)) {
+			albedo(lambertian->albedo);
+		}
+		material_records.emplace_back(record);
+	}
+	header.materials = writer.append(material_records);
+
+	std::vector< ::Environment > environment_records;
+	for (Environment const &environment : environments) {
+		environment_records.emplace_back(::Environment{
+			.name = writer.name(environment.name),
+			.radiance = environment.radiance.index,
+		});
+	}
+	header.environments = writer.append(environment_records);
+
+	std::vector< ::Light > light_records;
+	for (Light const &light : lights) {
+		::Light record{
+			.name = writer.name(light.name),
+			.tint = { light.tint.r, light.tint.g, light.tint.b },
+			.shadow = light.shadow,
+			.source = uint32_t(light.source.index()),
+			.parameters = {},
+		};
+		if (Light::Sun const *sun = std::get_if< Light::Sun >(&light.source)) {
+			record.parameters[0] = sun->angle;
+			record.parameters[1] = sun->strength;
+		} else if (Light::Sphere const *sphere = std::get_if< Light::Sphere >(&light.source)) {
+			record.parameters[0] = sphere->radius;
+			record.parameters[1] = sphere->power;
+			record.parameters[2] = sphere->limit;
+		} else if (Light::Spot const *spot = std::get_if< Light::Spot >(&light.source)) {
+			record.parameters[0] = spot->radius;
+			record.parameters[1] = spot->power;
+			record.parameters[2] = spot->limit;
+			record.parameters[3] = spot->fov;
+			record.parameters[4] = spot->blend;
+		}
+		light_records.emplace_back(record);
+	}
+	header.lights = writer.append(light_records);
+
+	{ // pooled vertices, in the order they are uploaded:
+		header.vertices = writer.append(vertices);
+		for (std::span< uint8_t const > const &mapped : mapped_vertices) {
+			writer.bytes.insert(writer.bytes.end(), mapped.begin(), mapped.end());
+			header.vertices.size += mapped.size();
+		}
+	}
+	header.indices = writer.append(indices);
+
+	header.strings = writer.append(writer.strings.data(), writer.strings.size());
+	std::memcpy(writer.bytes.data(), &header, sizeof(header));
+
+	// write next to the destination and rename into place, so an interrupted write never leaves a broken cache behind:
+	std::string temp_file = cache_file + ".tmp";
+	{
+		std::ofstream out(temp_file, std::ios::binary);
+		if (!out.write(reinterpret_cast< char const * >(writer.bytes.data()), writer.bytes.size())) {
+			throw std::runtime_error("Failed to write scene cache \"" + temp_file + "\".");
+		}
+	}
+	std::error_code ec;
+	std::filesystem::rename(temp_file, cache_file, ec);
+	if (ec) {
+		std::filesystem::remove(temp_file, ec);
+		throw std::runtime_error("Failed to move scene cache into place at \"" + cache_file + "\".");
+	}
+
+	auto after = std::chrono::high_resolution_clock::now();
+	std::cout << "Wrote scene cache \"" << cache_file << "\" (" << writer.bytes.size() << " bytes) in "
+	          << std::chrono::duration< double, std::milli >(after - before).count() << "ms." << std::endl;
+}
+
+std::optional< S72 > S72::load_cache(std::string const &cache_file, CacheOptions const &options) {
+	auto before = std::chrono::high_resolution_clock::now();
+
+	if (file_state(cache_file).size == Missing) {
+		std::cout << "No scene cache at \"" << cache_file << "\" yet." << std::endl;
+		return std::nullopt;
+	}
+
+	try {
+		DataFile file;
+		file.path = cache_file;
+		file.load();
+
+		Reader reader{ .file = file.data };
+		if (file.data.size() < sizeof(Header)) throw std::runtime_error("too small to be a scene cache");
+		Header header;
+		std::memcpy(&header, file.data.data(), sizeof(header));
+		if (std::memcmp(header.magic, CacheMagic, sizeof(header.magic)) != 0) throw std::runtime_error("not a scene cache");
+		if (header.version != CacheVersion || header.header_size != sizeof(Header)) {
+			std::cout << "Scene cache \"" << cache_file << "\" is from another version; rebuilding." << std::endl;
+			return std::nullopt;
+		}
+		if (header.weld != (options.weld ? 1u : 0u) || header.lod_levels != options.lod_levels) {
+			std::cout << "Scene cache \"" << cache_file << "\" was built with other mesh options; rebuilding." << std::endl;
+			return std::nullopt;
+		}
+		std::span< uint8_t const > strings = reader.bytes(header.strings);
+		reader.strings = std::span< char const >(reinterpret_cast< char const * >(strings.data()), strings.size());
+
+		// check sources; sizes and times are cheap, hashes only come into it when a time changed without the contents changing (e.g., after a checkout):
+		for (Source const &source : reader.records< Source >(header.sources)) {
+			std::string path = reader.string(source.path);
+			FileState state = file_state(path);
+			bool same = (state.size == source.size);
+			if (same && state.size != Missing && state.mtime != source.mtime) {
+				same = (hash_file(path) == source.hash);
+			}
+			if (!same) {
+				std::cout << "Scene cache \"" << cache_file << "\" is out of date (\"" << path << "\" changed); rebuilding." << std::endl;
+				return std::nullopt;
+			}
+		}
+
+		S72 s72;
+		s72.cache_storage = file.storage;
+		s72.scene.name = reader.string(header.scene_name);
+
+		std::span< ::Node const > node_records = reader.records< ::Node >(header.nodes);
+		std::span< ::Mesh const > mesh_records = reader.records< ::Mesh >(header.meshes);
+		std::span< ::Camera const > camera_records = reader.records< ::Camera >(header.cameras);
+		std::span< ::Texture const > texture_records = reader.records< ::Texture >(header.textures);
+		std::span< ::Material const > material_records = reader.records< ::Material >(header.materials);
+		std::span< ::Environment const > environment_records = reader.records< ::Environment >(header.environments);
+		std::span< ::Light const > light_records = reader.records< ::Light >(header.lights);
+		std::span< uint32_t const > node_refs = reader.records< uint32_t >(header.node_refs);
+		std::span< ::LOD const > lod_records = reader.records< ::LOD >(header.lods);
+		std::span< float const > driver_floats = reader.records< float >(header.driver_floats);
+		std::span< uint8_t const > vertex_bytes = reader.bytes(header.vertices);
+		std::span< uint32_t const > index_records = reader.records< uint32_t >(header.indices);
+
+		// the sections are in bounds, but the records in them are only trusted once they're checked against what they refer to --
+		// a corrupt cache must not point the renderer past the end of the pooled buffers:
+		if (vertex_bytes.size() % sizeof(PosNorTexTanVertex) != 0) throw std::runtime_error("vertex pool isn't a whole number of vertices");
+		size_t pooled_vertices = vertex_bytes.size() / sizeof(PosNorTexTanVertex);
+		auto check_index_range = [&](uint32_t first_index, uint32_t index_count, uint32_t vertex_count) {
+			if (first_index > index_records.size() || index_count > index_records.size() - first_index) throw std::runtime_error("index range out of range");
+			for (uint32_t index : index_records.subspan(first_index, index_count)) {
+				if (index >= vertex_count) throw std::runtime_error("index past the end of its mesh's vertices");
+			}
+		};
+
+		// objects are stored in array order, so the records' indices are the handles:
+		s72.nodes.resize(node_records.size());
+		s72.meshes.resize(mesh_records.size());
+		s72.cameras.resize(camera_records.size());
+		s72.textures.resize(texture_records.size());
+		s72.materials.resize(material_records.size());
+		s72.environments.resize(environment_records.size());
+		s72.lights.resize(light_records.size());
+
+		auto node_list = [&](uint32_t first, uint32_t count) {
+			if (first > node_refs.size() || count > node_refs.size() - first) throw std::runtime_error("node list out of range");
+			std::vector< NodeHandle > list;
+			list.reserve(count);
+			for (uint32_t r = first; r < first + count; ++r) {
+				list.emplace_back(handle< Node >(node_refs[r], node_records.size()));
+				if (!list.back()) throw std::runtime_error("null node reference");
+			}
+			return list;
+		};
+
+		s72.scene.roots = node_list(header.first_root, header.root_count);
+
+		for (size_t i = 0; i < node_records.size(); ++i) {
+			::Node const &record = node_records[i];
+			Node &node = s72.nodes[i];
+			node.name = reader.string(record.name);
+			node.translation = vec3{ .x = record.translation[0], .y = record.translation[1], .z = record.translation[2] };
+			node.rotation = quat{ .x = record.rotation[0], .y = record.rotation[1], .z = record.rotation[2], .w = record.rotation[3] };
+			node.scale = vec3{ .x = record.scale[0], .y = record.scale[1], .z = record.scale[2] };
+			node.children = node_list(record.first_child, record.child_count);
+			node.mesh = handle< Mesh >(record.mesh, mesh_records.size());
+			node.camera = handle< Camera >(record.camera, camera_records.size());
+			node.environment = handle< Environment >(record.environment, environment_records.size());
+			node.light = handle< Light >(record.light, light_records.size());
+		}
+
+		//(meshes keep no attributes or index streams: after processing, nothing reads them, and the data files aren't opened at all)
+		for (size_t i = 0; i < mesh_records.size(); ++i) {
+			::Mesh const &record = mesh_records[i];
+			Mesh &mesh = s72.meshes[i];
+			mesh.name = reader.string(record.name);
+			if (!known_topology(record.topology)) throw std::runtime_error("unknown topology");
+			if (record.first_vertex > pooled_vertices || record.vertex_count > pooled_vertices - record.first_vertex) throw std::runtime_error("vertex range out of range");
+			check_index_range(record.first_index, record.index_count, record.vertex_count);
+			mesh.topology = VkPrimitiveTopology(record.topology);
+			mesh.count = record.count;
+			mesh.material = handle< Material >(record.material, material_records.size());
+			mesh.first_vertex = record.first_vertex;
+			mesh.vertex_count = record.vertex_count;
+			mesh.first_index = record.first_index;
+			mesh.index_count = record.index_count;
+			if (record.first_lod > lod_records.size() || record.lod_count > lod_records.size() - record.first_lod) throw std::runtime_error("lod list out of range");
+			for (uint32_t l = record.first_lod; l < record.first_lod + record.lod_count; ++l) {
+				check_index_range(lod_records[l].first_index, lod_records[l].index_count, record.vertex_count);
+				mesh.lods.emplace_back(Mesh::LOD{ .first_index = lod_records[l].first_index, .index_count = lod_records[l].index_count, .error = lod_records[l].error });
+			}
+			mesh.bbox_min = vec3{ .x = record.bbox_min[0], .y = record.bbox_min[1], .z = record.bbox_min[2] };
+			mesh.bbox_max = vec3{ .x = record.bbox_max[0], .y = record.bbox_max[1], .z = record.bbox_max[2] };
+		}
+
+		for (size_t i = 0; i < camera_records.size(); ++i) {
+			::Camera const &record = camera_records[i];
+			Camera &camera = s72.cameras[i];
+			camera.name = reader.string(record.name);
+			camera.projection = Camera::Perspective{ .aspect = record.aspect, .vfov = record.vfov, .near = record.near, .far = record.far };
+		}
+
+		for (::Driver const &record : reader.records< ::Driver >(header.drivers)) {
+			if (record.channel > uint32_t(Driver::Channel::rotation)) throw std::runtime_error("unknown driver channel");
+			if (record.interpolation > uint32_t(Driver::Interpolation::SLERP)) throw std::runtime_error("unknown driver interpolation");
+			size_t components = (Driver::Channel(record.channel) == Driver::Channel::rotation ? 4 : 3);
+			if (size_t(record.value_count) != size_t(record.time_count) * components) throw std::runtime_error("driver has the wrong number of values for its channel");
+			size_t end = size_t(record.first_float) + record.time_count + record.value_count;
+			if (end > driver_floats.size()) throw std::runtime_error("driver keys out of range");
+			float const *times = driver_floats.data() + record.first_float;
+			float const *values = times + record.time_count;
+			NodeHandle node = handle< Node >(record.node, node_records.size());
+			if (!node) throw std::runtime_error("driver without a node");
+			s72.drivers.emplace_back(Driver{
+				.name = reader.string(record.name),
+				.node = node,
+				.channel = Driver::Channel(record.channel),
+				.times = std::vector< float >(times, times + record.time_count),
+				.values = std::vector< float >(values, values + record.value_count),
+				.interpolation = Driver::Interpolation(record.interpolation),
+			});
+		}
+
+		for (size_t i = 0; i < texture_records.size(); ++i) {
+			::Texture const &record = texture_records[i];
+			Texture &texture = s72.textures[i];
+			if (record.type > uint32_t(Texture::Type::cube)) throw std::runtime_error("unknown texture type");
+			if (record.format > uint32_t(Texture::Format::rgbe)) throw std::runtime_error("unknown texture format");
+			if (record.width <= 0 || record.height <= 0 || record.mip_levels == 0 || record.mip_levels > 32) throw std::runtime_error("bad texture size");
+			{ // pixels must hold exactly the mip chain Tutorial will upload (RGBA8, each level half the size of the one above, rounding down but never below 1):
+				size_t expected = 0;
+				for (uint32_t level = 0; level < record.mip_levels; ++level) {
+					expected += size_t(std::max(1u, uint32_t(record.width) >> level)) * std::max(1u, uint32_t(record.height) >> level) * 4;
+				}
+				if (record.pixels.size != expected) throw std::runtime_error("texture pixels don't match its size");
+			}
+			texture.src = reader.string(record.src);
+			texture.path = reader.string(record.path);
+			texture.type = Texture::Type(record.type);
+			texture.format = Texture::Format(record.format);
+			texture.width = record.width;
+			texture.height = record.height;
+			texture.channels = record.channels;
+			texture.mip_levels = record.mip_levels;
+			std::span< uint8_t const > pixels = reader.bytes(record.pixels);
+			texture.pixels.assign(pixels.begin(), pixels.end());
+		}
+
+		for (size_t i = 0; i < material_records.size(); ++i) {
+			::Material const &record = material_records[i];
+			Material &material = s72.materials[i];
+			material.name = reader.string(record.name);
+			material.normal_map = handle< Texture >(record.normal_map, texture_records.size());
+			material.displacement_map = handle< Texture >(record.displacement_map, texture_records.size());
+			auto albedo = [&]() -> std::variant< color, TextureHandle > {
+				if (record.albedo_map != None) return handle< Texture >(record.albedo_map, texture_records.size());
+				return color{ .r = record.albedo[0], .g = record.albedo[1], .b = record.albedo[2] };
+			};
+			auto scalar = [&](float constant, uint32_t map) -> std::variant< float, TextureHandle > {
+				if (map != None) return handle< Texture >(map, texture_records.size());
+				return constant;
+			};
+			if (record.brdf == 0) {
+				material.brdf = Material::PBR{
+					.albedo = albedo(),
+					.roughness = scalar(record.roughness, record.roughness_map),
+					.metalness = scalar(record.metalness, record.metalness_map),
+				};
+			} else if (record.brdf == 1) {
+				material.brdf = Material::Lambertian{ .albedo = albedo() };
+			} else if (record.brdf == 2) {
+				material.brdf = Material::Mirror{};
+			} else if (record.brdf == 3) {
+				material.brdf = Material::Environment{};
+			} else {
+				throw std::runtime_error("unknown brdf");
+			}
+		}
+
+		for (size_t i = 0; i < environment_records.size(); ++i) {
+			s72.environments[i].name = reader.string(environment_records[i].name);
+			s72.environments[i].radiance = handle< Texture >(environment_records[i].radiance, texture_records.size());
+		}
+
+		for (size_t i = 0; i < light_records.size(); ++i) {
+			::Light const &record = light_records[i];
+			Light &light = s72.lights[i];
+			light.name = reader.string(record.name);
+			light.tint = color{ .r = record.tint[0], .g = record.tint[1], .b = record.tint[2] };
+			light.shadow = record.shadow;
+			float const *p = record.parameters;
+			if (record.source == 0) {
+				light.source = Light::Sun{ .angle = p[0], .strength = p[1] };
+			} else if (record.source == 1) {
+				light.source = Light::Sphere{ .radius = p[0], .power = p[1], .limit = p[2] };
+			} else if (record.source == 2) {
+				light.source = Light::Spot{ .radius = p[0], .power = p[1], .limit = p[2], .fov = p[3], .blend = p[4] };
+			} else {
+				throw std::runtime_error("unknown light source");
+			}
+		}
+
+		// vertices are used in place (uploaded straight out of the mapping); indices are small enough to just copy:
+		if (!vertex_bytes.empty()) s72.mapped_vertices.emplace_back(vertex_bytes);
+		s72.indices.assign(index_records.begin(), index_records.end());
+
+		auto after = std::chrono::high_resolution_clock::now();
+		std::cout << "Loaded scene cache \"" << cache_file << "\" (" << s72.nodes.size() << " nodes, " << s72.meshes.size() << " meshes, "
+		          << s72.textures.size() << " textures) in " << std::chrono::duration< double, std::milli >(after - before).count() << "ms." << std::endl;
+		return s72;
+	} catch (std::exception &e) {
+		std::cerr << "WARNING: Scene cache \"" << cache_file << "\" couldn't be read (" << e.what() << "); rebuilding." << std::endl;
+		return std::nullopt;
+	}
+}
@@ -4,9 +4,27 @@
 #include <fstream>
 #include <limits>
 #include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <array>
+#include <map>
+#include <unordered_map>
+#include "MeshSimplifier.hpp"
 #include "PosNorTexTanVertex.hpp"
+#include "ThreadPool.hpp"
 #include "stb_image.h"
 
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 //functions that do the inverse of those in vk_enum_string_helper.h :
 
 //used for mesh topologies:
@@ -127,8 +145,22 @@ VkFormat format_to_VkFormat(std::string const &format) {
 
 //helpers used in loading:
 
+//name -> handle for one kind of object; only needed while S72::load reads the file.
+//References can come before definitions, so the first lookup of a name adds an empty object for it (filled in once its definition is read):
+template< typename T >
+struct NameIndex {
+	std::vector< T > &objects;
+	std::unordered_map< std::string, uint32_t > handles;
+
+	S72::Handle< T > operator[](std::string const &name) {
+		auto [it, inserted] = handles.emplace(name, uint32_t(objects.size()));
+		if (inserted) objects.emplace_back();
+		return S72::Handle< T >{ .index = it->second };
+	}
+};
+
 //warn if any members of an object haven't been handled (+ deleted):
-void warn_on_unhandled(std::map< std::string, sejp::value > &object, std::string const &what) {
+void warn_on_unhandled(sejp::object &object, std::string const &what) {
 	if (object.empty()) return;
 	std::cerr << "WARNING: " << what << " contained unhandled properties: ";
 	bool first = true;
@@ -148,7 +180,7 @@ void warn_on_unhandled(std::map< std::string, sejp::value > &object, std::string
     // throws if the property is missing
     // deletes property from the object and returns the value if all is well
 // The underscore distinguishes the raw pointer parameter from the nicer reference object created later in this fn
-std::string extract_string(std::map< std::string, sejp::value > *object_, std::string const &key, std::string const &what) {
+std::string extract_string(sejp::object *object_, std::string const &key, std::string const &what) {
     assert(object_);
     auto &object = *object_;
 
@@ -165,7 +197,7 @@ std::string extract_string(std::map< std::string, sejp::value > *object_, std::s
 //pull out a number property of a sejp object as an uint32_t.
 // throws if the property is missing or can't fit in a uint32_t
 // deletes property from the object and returns the value if all is well
-uint32_t extract_uint32_t(std::map< std::string, sejp::value > *object_, std::string const &key, std::string const &what) {
+uint32_t extract_uint32_t(sejp::object *object_, std::string const &key, std::string const &what) {
 	assert(object_);
 	auto &object = *object_;
 
@@ -185,7 +217,7 @@ uint32_t extract_uint32_t(std::map< std::string, sejp::value > *object_, std::st
 //pull out a number property of a sejp object as a float.
 // throws if the property is missing
 // deletes property from the object and returns the value if all is well
-float extract_float(std::map< std::string, sejp::value > *object_, std::string const &key, std::string const &what) {
+float extract_float(sejp::object *object_, std::string const &key, std::string const &what) {
 	assert(object_);
 	auto &object = *object_;
 
@@ -202,7 +234,7 @@ float extract_float(std::map< std::string, sejp::value > *object_, std::string c
 //pull out an array property of a sejp object as a vector of float.
 // throws if the property is missing or contains non-number data
 // deletes property from the object and returns the value if all is well
-std::vector< float > extract_float_vector(std::map< std::string, sejp::value > *object_, std::string const &key, std::string const &what) {
+std::vector< float > extract_float_vector(sejp::object *object_, std::string const &key, std::string const &what) {
 	assert(object_);
 	auto &object = *object_;
 
@@ -222,14 +254,14 @@ std::vector< float > extract_float_vector(std::map< std::string, sejp::value > *
 
 //parse a texture map property of a sejp object into an S72's texture storage
 // throws if the property is missing or doesn't parse as a texture
-// deletes property from the object and returns a reference to the S72's textures container on success
-S72::Texture &extract_map(std::map< std::string, sejp::value > *object_, std::string const &key, S72 *s72_, std::string const &what) {
+// deletes property from the object and returns a handle to the (new or existing) texture in textures on success
+S72::TextureHandle extract_map(sejp::object *object_, std::string const &key, NameIndex< S72::Texture > *textures_, std::string const &what) {
 	assert(object_);
 	auto &object = *object_;
-	assert(s72_);
-	auto &s72 = *s72_;
+	assert(textures_);
+	auto &textures = *textures_;
 
-	std::map< std::string, sejp::value > obj;
+	sejp::object obj;
 	try {
 		obj = object.at(key).as_object().value();
 	} catch (std::exception &) {
@@ -274,45 +306,174 @@ S72::Texture &extract_map(std::map< std::string, sejp::value > *object_, std::st
 
 	std::string texture_key = src + ", format " + std::to_string(int(type)) + ", type " + std::to_string(int(format));
 
-    /*
-	std::pair<iterator, bool>                                                                                
-	//        ↑          ↑                                                                                   
-	//        │          └── true if inserted, false if key already existed                                  
-	//        └── iterator to the element (new or existing)                                                  
-	2. .first — get the iterator (first element of the pair)                                                 
-	3. ->second — iterator points to a pair<key, value>, so ->second gets the value (the Texture)
-
-	It does two things in one line:                                                                          
-	- Inserts the texture into s72.textures (so it's stored in the scene)                                    
-	- Returns a reference to it (so you can assign & to get a pointer)  
-	*/
-	return s72.textures.emplace(texture_key, S72::Texture{.src = src, .type = type, .format = format}).first->second;
+	bool added = !textures.handles.contains(texture_key);
+	S72::TextureHandle texture = textures[texture_key];
+	if (added) {
+		textures.objects[texture.index] = S72::Texture{.src = src, .type = type, .format = format};
+	}
+	return texture;
 }
 
-S72 S72::load(std::string const &scene_file) {
-    S72 s72; // the loaded scene, will be returned at end of function
+//map a data file's bytes read-only into memory, so they are shared with the page cache and only paged in when touched.
+// falls back to reading the whole file into a heap buffer if the file can't be mapped.
+// throws if the file can't be opened or read
+void S72::DataFile::load() {
+	S72::DataFile &data_file = *this;
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(data_file.path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file != INVALID_HANDLE_VALUE) {
+		LARGE_INTEGER size;
+		if (GetFileSizeEx(file, &size) && size.QuadPart == 0) {
+			CloseHandle(file);
+			data_file.data = {};
+			return;
+		}
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(file); //the mapping object keeps its own reference to the file
+		if (mapping != nullptr) {
+			void const *ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapping); //the view keeps its own reference to the mapping
+			if (ptr != nullptr) {
+				data_file.storage = std::shared_ptr< void const >(ptr, [](void const *p){ UnmapViewOfFile(p); });
+				data_file.data = std::span< uint8_t const >(static_cast< uint8_t const * >(ptr), size_t(size.QuadPart));
+				return;
+			}
+		}
+	}
+#else
+	int fd = open(data_file.path.c_str(), O_RDONLY);
+	if (fd >= 0) {
+		struct stat st;
+		if (fstat(fd, &st) == 0) {
+			size_t size = size_t(st.st_size);
+			if (size == 0) { //mmap refuses zero-length mappings
+				close(fd);
+				data_file.data = {};
+				return;
+			}
+			void *ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			close(fd); //the mapping keeps its own reference to the file
+			if (ptr != MAP_FAILED) {
+				data_file.storage = std::shared_ptr< void const >(ptr, [size](void const *p){ munmap(const_cast< void * >(p), size); });
+				data_file.data = std::span< uint8_t const >(static_cast< uint8_t const * >(ptr), size);
+				return;
+			}
+		} else {
+			close(fd);
+		}
+	}
+#endif
+
+	//fallback: read the whole file into memory
+	std::ifstream file(data_file.path, std::ios::binary | std::ios::ate); // open, cursor at end
+	if (!file) {
+		throw std::runtime_error("Failed to open data file \"" + data_file.path + "\".");
+	}
+
+	// Get file size (ate positions cursor at end)
+	std::streamsize size = file.tellg(); // size = cursor position
+	file.seekg(0, std::ios::beg); // seek back to beginning
+
+	auto bytes = std::make_shared< std::vector< uint8_t > >(size);
+	if (!file.read(reinterpret_cast<char*>(bytes->data()), size)) {
+		throw std::runtime_error("Failed to read data file \"" + data_file.path + "\".");
+	}
+	data_file.data = std::span< uint8_t const >(bytes->data(), bytes->size());
+	data_file.storage = std::move(bytes);
+}
+
+// runs job(i) for every i in [0, count): across the pool if there is one, otherwise in order on this thread.
+static void for_each_index(ThreadPool *pool, size_t count, std::function< void(size_t) > const &job) {
+    if (pool) {
+        pool->parallel_for(count, job);
+    } else {
+        for (size_t i = 0; i < count; ++i) job(i);
+    }
+}
 
-    sejp::value json = sejp::load(scene_file);
+// Reads an s72 file's top-level array one element at a time: each element is built into a (small) sejp::document
+// and handed to `element` before the next one is read, so the whole document never has to be in memory at once.
+// (the element's document is dropped as soon as `element` returns, freeing its data -- so don't hold on to values from it)
+struct S72ElementReader : sejp::handler {
+    std::function< void(size_t, sejp::value const &) > element; // (index in the top-level array, value)
 
-    // try to interpret JSON as array; returns an "std::optional<std::map<std::string, value>> empty" if not an array:
-    std::optional< std::vector< sejp::value > > array = json.as_array();
+    uint32_t depth = 0; // containers open, including the top-level array
+    size_t index = 0; // of the element being built
+    bool top_level_seen = false;
+    sejp::builder builder;
 
-    // fetch top-level array from the scene file:
-    if (!array) {
-        throw std::runtime_error("Top-level value of s72 file should be an array.");
+    // the top-level array itself isn't built, everything inside it is:
+    void begin_value() {
+        if (depth == 0) throw std::runtime_error("Top-level value of s72 file should be an array.");
+    }
+    void end_value() {
+        if (depth == 1 && builder.done()) {
+            element(index, builder.take());
+            index += 1;
+        }
     }
 
-    // check magic value:
-    if (!(array->size() >= 1 && array->at(0).as_string() && array->at(0).as_string().value() == "s72-v2")) {
-        throw std::runtime_error("First element of s72 array should be \"s72-v2\".");
+    void begin_object() override { begin_value(); builder.begin_object(); depth += 1; }
+    void key(std::string &&key) override { builder.key(std::move(key)); }
+    void end_object() override { builder.end_object(); depth -= 1; end_value(); }
+    void begin_array() override {
+        if (depth == 0 && !top_level_seen) {
+            top_level_seen = true;
+        } else {
+            begin_value();
+            builder.begin_array();
+        }
+        depth += 1;
     }
+    void end_array() override {
+        depth -= 1;
+        if (depth != 0) {
+            builder.end_array();
+            end_value();
+        }
+    }
+    void string(std::string &&string) override { begin_value(); builder.string(std::move(string)); end_value(); }
+    void number(double number) override { begin_value(); builder.number(number); end_value(); }
+    void boolean(bool value) override { begin_value(); builder.boolean(value); end_value(); }
+    void null() override { begin_value(); builder.null(); end_value(); }
+};
+
+S72 S72::load(std::string const &scene_file, ThreadPool *pool) {
+    S72 s72; // the loaded scene, will be returned at end of function
+
+    // names -> handles, for resolving references while the file is read:
+    NameIndex< Node > node_names{ .objects = s72.nodes };
+    NameIndex< Mesh > mesh_names{ .objects = s72.meshes };
+    NameIndex< DataFile > data_file_names{ .objects = s72.data_files };
+    NameIndex< Camera > camera_names{ .objects = s72.cameras };
+    NameIndex< Texture > texture_names{ .objects = s72.textures };
+    NameIndex< Material > material_names{ .objects = s72.materials };
+    NameIndex< Environment > environment_names{ .objects = s72.environments };
+    NameIndex< Light > light_names{ .objects = s72.lights };
+
+    // Node references (scene roots, children) are kept as names in these compact tables while the file is read,
+    // and turned into handles in a second pass, once every node is known.
+    // (resolving them right away could add nodes, and so move the node whose children are being read)
+    struct NodeRefs {
+        uint32_t node; // whose children these are (-1U: the scene's roots)
+        uint32_t first; // filled with the nodes named node_ref_names[first...]
+        uint32_t count;
+    };
+    std::vector< NodeRefs > node_refs;
+    std::vector< std::string > node_ref_names;
+    auto defer_node_refs = [&](uint32_t node, std::vector< std::string > &&refs) {
+        node_refs.emplace_back(NodeRefs{ .node = node, .first = uint32_t(node_ref_names.size()), .count = uint32_t(refs.size()) });
+        for (std::string &ref : refs) {
+            node_ref_names.emplace_back(std::move(ref));
+        }
+    };
 
-    // parse the remaining objects
-    for (size_t i = 1; i < array->size(); i++) {
+    // parse one object of the top-level array:
+    auto load_object = [&](size_t i, sejp::value const &value) {
         // make a copy of the object and erase numbers as they are parsed:
-        std::map< std::string, sejp::value > object;
+        sejp::object object;
         try {
-            object = array->at(i).as_object().value();
+            object = value.as_object().value();
         } catch (std::exception &) {
             throw std::runtime_error("Array element" + std::to_string(i) + " is not an object.");
         }
@@ -346,16 +507,14 @@ S72 S72::load(std::string const &scene_file) {
                 } catch (std::exception &) { // "&" instead of "&e", meaning we catch all exceptions but ignore the details, since we don't care why parsing failed, just that it did 
                     throw std::runtime_error("Scene \"" + name + "\"'s roots are not an array of strings.");
                 }
-                scene.roots.reserve(refs.size());
-                for (auto const &ref : refs) {
-                    scene.roots.emplace_back(&s72.nodes[ref]); //NOTE: creates new (empty) nodes if not yet parsed; will check for this later
-                }
+                defer_node_refs(-1U, std::move(refs)); // (resolved after the whole file has been read)
                 object.erase(f); // useful mainly for debugging unhandled properties; we will call warn_on_unhandled at end of loop iteration to check for any properties we forgot to parse
             }
 
         } else if (type == "NODE") {
             //get a reference to the object we are parsing into:
-            Node &node = s72.nodes[name]; //NOTE: creates new (empty) node if not yet parsed; will check for this later 
+            NodeHandle handle = node_names[name]; //NOTE: creates new (empty) node if not yet parsed
+            Node &node = s72[handle];
             
             //check that we haven't already parsed this node's information:
 			if (node.name != "") {
@@ -422,11 +581,8 @@ S72 S72::load(std::string const &scene_file) {
 					throw std::runtime_error("Node \"" + name + "\"'s children should be an array of strings.");
 				}
 
-				//create/fixup pointers to other nodes:
-                node.children.reserve(refs.size());
-                for (auto const &ref : refs) {
-				    node.children.emplace_back(&s72.nodes[ref]); //NOTE: creates new (empty) nodes if not yet parsed; will check for this later
-                }
+				//pointers to other nodes are filled in after the whole file has been read:
+                defer_node_refs(handle.index, std::move(refs));
 				object.erase(f);
 			}
 
@@ -437,7 +593,7 @@ S72 S72::load(std::string const &scene_file) {
 				} catch (std::exception &) {
 					throw std::runtime_error("Node \"" + name + "\"'s mesh should be a string.");
 				}
-                node.mesh = &s72.meshes[ref];
+                node.mesh = mesh_names[ref];
 				object.erase(f);
 			}
 
@@ -448,7 +604,7 @@ S72 S72::load(std::string const &scene_file) {
 				} catch (std::exception &) {
 					throw std::runtime_error("Node \"" + name + "\"'s camera should be a string.");
 				}
-                node.camera = &s72.cameras[ref];
+                node.camera = camera_names[ref];
 				object.erase(f);
 			}
 
@@ -459,7 +615,7 @@ S72 S72::load(std::string const &scene_file) {
 				} catch (std::exception &) {
 					throw std::runtime_error("Node \"" + name + "\"'s environment should be a string.");
 				}
-				node.environment = &s72.environments[ref];
+				node.environment = environment_names[ref];
 				object.erase(f);
 			}
 
@@ -470,13 +626,13 @@ S72 S72::load(std::string const &scene_file) {
 				} catch (std::exception &) {
 					throw std::runtime_error("Node \"" + name + "\"'s light should be a string.");
 				}
-				node.light = &s72.lights[ref];
+				node.light = light_names[ref];
 				object.erase(f);
 			}
 
         } else if (type == "MESH") {
             //reference to the thing we are parsing into:
-			Mesh &mesh = s72.meshes[name];
+			Mesh &mesh = s72[mesh_names[name]];
 
 			//check that we haven't already parsed this:
 			if (mesh.name != "") {
@@ -492,7 +648,7 @@ S72 S72::load(std::string const &scene_file) {
 			mesh.count = extract_uint32_t(&object, "count", "Mesh \"" + name + "\"'s count");
 
             if (auto f = object.find("indices"); f != object.end()) {
-				std::map< std::string, sejp::value > obj;
+				sejp::object obj;
 				try {
 					obj = f->second.as_object().value();
 				} catch (std::exception &) {
@@ -503,7 +659,7 @@ S72 S72::load(std::string const &scene_file) {
 				uint32_t offset = extract_uint32_t(&obj, "offset", "Mesh \"" + name + "\"'s indices.offset");
 				std::string format = extract_string(&obj, "format", "Mesh \"" + name + "\"'s indices.format");
 				mesh.indices.emplace(Mesh::Indices{
-					.src = s72.data_files[src],
+					.src = data_file_names[src],
 					.offset = offset,
 					.format = format_to_VkIndexType(format),
 				});
@@ -513,7 +669,7 @@ S72 S72::load(std::string const &scene_file) {
 				object.erase(f);
 			}
 
-            std::map< std::string, sejp::value > attributes;
+            sejp::object attributes;
 			try {
 				attributes = object.at("attributes").as_object().value();
 			} catch (std::exception &) {
@@ -522,7 +678,7 @@ S72 S72::load(std::string const &scene_file) {
 			object.erase(object.find("attributes"));
 
 			for (auto const &[key, value] : attributes) {
-				std::map< std::string, sejp::value > obj;
+				sejp::object obj;
 				try {
 					obj = value.as_object().value();
 				} catch (std::exception &) {
@@ -534,7 +690,7 @@ S72 S72::load(std::string const &scene_file) {
 				uint32_t stride = extract_uint32_t(&obj, "stride", "Mesh \"" + name + "\"'s attribute \"" + key + "\"' stride");
 				std::string format = extract_string(&obj, "format", "Mesh \"" + name + "\"'s attribute \"" + key + "\"'s format");
 				mesh.attributes.emplace(key, Mesh::Attribute{
-					.src = s72.data_files[src],
+					.src = data_file_names[src],
 					.offset = offset,
 					.stride = stride,
 					.format = format_to_VkFormat(format),
@@ -551,10 +707,10 @@ S72 S72::load(std::string const &scene_file) {
 					throw std::runtime_error("Mesh \"" + name + "\"'s material is not a string.");
 				}
 				object.erase(f);
-				mesh.material = &s72.materials[material];
+				mesh.material = material_names[material];
 			}
         } else if (type == "CAMERA") {
-            Camera &camera = s72.cameras[name];
+            Camera &camera = s72[camera_names[name]];
 
 			//check that we haven't already parsed this:
 			if (camera.name != "") {
@@ -574,7 +730,7 @@ S72 S72::load(std::string const &scene_file) {
 				}
 				have_projection = true;
 
-				std::map< std::string, sejp::value > obj;
+				sejp::object obj;
 				try {
 					obj = f->second.as_object().value();
 				} catch (std::exception &) {
@@ -661,14 +817,14 @@ S72 S72::load(std::string const &scene_file) {
 
 			s72.drivers.emplace_back(Driver{
 				.name = name,
-				.node = s72.nodes[node],
+				.node = node_names[node],
 				.channel = channel,
 				.times = std::move(times), // std::move() transfers ownership instead of copying, which is more efficient for large vectors; we won't be using the times/values vectors in the object after this, so it's safe to move them instead of copying
 				.values = std::move(values),
 				.interpolation = interpolation,
 			});
         }  else if (type == "MATERIAL") {
-            Material &material = s72.materials[name];
+            Material &material = s72[material_names[name]];
 
 			//check that we haven't already parsed this:
 			if (material.name != "") {
@@ -679,10 +835,10 @@ S72 S72::load(std::string const &scene_file) {
 			material.name = name;
 
 			if (object.contains("normalMap")) {
-				material.normal_map = &extract_map(&object, "normalMap", &s72, "Material \"" + name + "\"'s normalMap");
+				material.normal_map = extract_map(&object, "normalMap", &texture_names, "Material \"" + name + "\"'s normalMap");
 			}
 			if (object.contains("displacementMap")) {
-				material.displacement_map = &extract_map(&object, "displacementMap", &s72, "Material \"" + name + "\"'s displacementMap");
+				material.displacement_map = extract_map(&object, "displacementMap", &texture_names, "Material \"" + name + "\"'s displacementMap");
 			}
 
             bool have_brdf = false;
@@ -693,7 +849,7 @@ S72 S72::load(std::string const &scene_file) {
 				}
 				have_brdf = true;
 
-				std::map< std::string, sejp::value > obj;
+				sejp::object obj;
 				try {
 					obj = b->second.as_object().value();
 				} catch (std::exception &) {
@@ -718,7 +874,7 @@ S72 S72::load(std::string const &scene_file) {
 						}
 						obj.erase(f);
 					} else {
-						pbr.albedo = &extract_map(&obj, "albedo", &s72, "Material \"" + name + "\"'s pbr.albedo");
+						pbr.albedo = extract_map(&obj, "albedo", &texture_names, "Material \"" + name + "\"'s pbr.albedo");
 					}
 				}
 
@@ -727,7 +883,7 @@ S72 S72::load(std::string const &scene_file) {
 						pbr.roughness = float(number.value());
 						obj.erase(f);
 					} else {
-						pbr.roughness = &extract_map(&obj, "roughness", &s72, "Material \"" + name + "\"'s pbr.roughness");
+						pbr.roughness = extract_map(&obj, "roughness", &texture_names, "Material \"" + name + "\"'s pbr.roughness");
 					}
 				}
 
@@ -736,7 +892,7 @@ S72 S72::load(std::string const &scene_file) {
 						pbr.metalness = float(number.value());
 						obj.erase(f);
 					} else {
-						pbr.metalness = &extract_map(&obj, "metalness", &s72, "Material \"" + name + "\"'s pbr.metalness");
+						pbr.metalness = extract_map(&obj, "metalness", &texture_names, "Material \"" + name + "\"'s pbr.metalness");
 					}
 				}
 
@@ -753,7 +909,7 @@ S72 S72::load(std::string const &scene_file) {
 				}
 				have_brdf = true;
 
-				std::map< std::string, sejp::value > obj;
+				sejp::object obj;
 				try {
 					obj = b->second.as_object().value();
 				} catch (std::exception &) {
@@ -778,7 +934,7 @@ S72 S72::load(std::string const &scene_file) {
 						}
 						obj.erase(f);
 					} else { // png
-						lambertian.albedo = &extract_map(&obj, "albedo", &s72, "Material \"" + name + "\"'s lambertian.albedo");
+						lambertian.albedo = extract_map(&obj, "albedo", &texture_names, "Material \"" + name + "\"'s lambertian.albedo");
 					}
 				}
 
@@ -795,7 +951,7 @@ S72 S72::load(std::string const &scene_file) {
 				}
 				have_brdf = true;
 
-				std::map< std::string, sejp::value > obj;
+				sejp::object obj;
 				try {
 					obj = b->second.as_object().value();
 				} catch (std::exception &) {
@@ -819,7 +975,7 @@ S72 S72::load(std::string const &scene_file) {
 				}
 				have_brdf = true;
 
-				std::map< std::string, sejp::value > obj;
+				sejp::object obj;
 				try {
 					obj = b->second.as_object().value();
 				} catch (std::exception &) {
@@ -841,7 +997,7 @@ S72 S72::load(std::string const &scene_file) {
 				throw std::runtime_error("Material \"" + name + "\" does not have a brdf.");
 			}
         }  else if (type == "ENVIRONMENT") {
-            Environment &environment = s72.environments[name];
+            Environment &environment = s72[environment_names[name]];
 
 			//check that we haven't already parsed this:
 			if (environment.name != "") {
@@ -851,13 +1007,13 @@ S72 S72::load(std::string const &scene_file) {
 			//mark as parsed:
 			environment.name = name;
 
-			environment.radiance = &extract_map(&object, "radiance", &s72, "Environment \"" + name + "\"'s radiance");
+			environment.radiance = extract_map(&object, "radiance", &texture_names, "Environment \"" + name + "\"'s radiance");
 
-			if (environment.radiance->type != Texture::Type::cube) {
+			if (s72[environment.radiance].type != Texture::Type::cube) {
 				throw std::runtime_error("Environment \"" + name + "\"'s radiance is not a cube.");
 			}
         }  else if (type == "LIGHT") {
-            Light &light = s72.lights[name];
+            Light &light = s72[light_names[name]];
 
 			//check that we haven't already parsed this:
 			if (light.name != "") {
@@ -893,7 +1049,7 @@ S72 S72::load(std::string const &scene_file) {
 				}
 				have_source = true;
 
-				std::map< std::string, sejp::value > obj;
+				sejp::object obj;
 				try {
 					obj = f->second.as_object().value();
 				} catch (std::exception &) {
@@ -916,7 +1072,7 @@ S72 S72::load(std::string const &scene_file) {
 				}
 				have_source = true;
 
-				std::map< std::string, sejp::value > obj;
+				sejp::object obj;
 				try {
 					obj = f->second.as_object().value();
 				} catch (std::exception &) {
@@ -942,7 +1098,7 @@ S72 S72::load(std::string const &scene_file) {
 				}
 				have_source = true;
 
-				std::map< std::string, sejp::value > obj;
+				sejp::object obj;
 				try {
 					obj = f->second.as_object().value();
 				} catch (std::exception &) {
@@ -971,6 +1127,34 @@ S72 S72::load(std::string const &scene_file) {
         } else {
             throw std::runtime_error("Unknown object type"); // std::runtime_error is appropriate for this case — it's the standard exception for errors detectable only at runtime
         }
+    };
+
+    { // stream the file, checking the magic value and then loading each object as soon as it has been read:
+        S72ElementReader reader;
+        reader.element = [&](size_t i, sejp::value const &value) {
+            if (i == 0) {
+                if (!(value.as_string() && value.as_string().value() == "s72-v2")) {
+                    throw std::runtime_error("First element of s72 array should be \"s72-v2\".");
+                }
+            } else {
+                load_object(i, value);
+            }
+        };
+        sejp::read_file(scene_file, reader);
+        if (reader.index == 0) {
+            throw std::runtime_error("First element of s72 array should be \"s72-v2\".");
+        }
+    }
+
+    // second pass: node names -> handles
+    std::vector< NodeHandle > node_ref_handles;
+    node_ref_handles.reserve(node_ref_names.size());
+    for (std::string const &ref : node_ref_names) {
+        node_ref_handles.emplace_back(node_names[ref]); //NOTE: creates new (empty) nodes if never defined
+    }
+    for (NodeRefs const &refs : node_refs) {
+        std::vector< NodeHandle > &list = (refs.node == -1U ? s72.scene.roots : s72.nodes[refs.node].children);
+        list.assign(node_ref_handles.begin() + refs.first, node_ref_handles.begin() + refs.first + refs.count);
     }
 
     //-----------------------------------------------------------------------
@@ -984,39 +1168,26 @@ S72 S72::load(std::string const &scene_file) {
 		}
 	}
 
-	//data files are just empty objects, but in a map with keys = src:
-	for (auto &[key, value] : s72.data_files) {
-		value.src = key;
-		value.path = scene_folder + value.src;
+	//data files are just empty objects, named by src:
+	for (auto const &[src, index] : data_file_names.handles) {
+		s72.data_files[index].src = src;
+		s72.data_files[index].path = scene_folder + src;
 	}
 
 	//textures are already populated with src, type, format; just need to set path:
-	for (auto &[key, value] : s72.textures) {
-		value.path = scene_folder + value.src;
+	for (Texture &texture : s72.textures) {
+		texture.path = scene_folder + texture.src;
 	}
 
     //-----------------------------------------------------------------------
-    // load the DataFiles from disk in binary mode
-
-    for (auto &[key, data_file] : s72.data_files) {
-        // TODO: understand the read binary file into memory process
-        // Open file in binary mode, positioned at end (ate) to get size
-        std::ifstream file(data_file.path, std::ios::binary | std::ios::ate); // open, cursor at end 
-        if (!file) {
-            throw std::runtime_error("Failed to open data file \"" + data_file.path + "\".");
-        }
+    // map (or load) the DataFiles from disk in binary mode
 
-        // Get file size (ate positions cursor at end)
-        std::streamsize size = file.tellg(); // // size = cursor position 
-        file.seekg(0, std::ios::beg); // seek back to beginning
+    for_each_index(pool, s72.data_files.size(), [&](size_t i) {
+        s72.data_files[i].load();
+    });
 
-        // Allocate buffer and read entire file
-        data_file.data.resize(size);
-        if (!file.read(reinterpret_cast<char*>(data_file.data.data()), size)) {
-            throw std::runtime_error("Failed to read data file \"" + data_file.path + "\".");
-        }
-
-        std::cout << "Loaded data file: " << data_file.path << " (" << size << " bytes)" << std::endl;
+    for (DataFile const &data_file : s72.data_files) {
+        std::cout << "Loaded data file: " << data_file.path << " (" << data_file.data.size() << " bytes)" << std::endl;
     }
 
 	return s72; // the loaded scene
@@ -1027,71 +1198,473 @@ inline float read_float(uint8_t const *ptr) {
     return *reinterpret_cast<float const*>(ptr);
 }
 
-void S72::process_meshes() {
-    for (auto &[mesh_name, mesh] : meshes) {
-        // Record where this mesh starts in the pooled vertex buffer
-        mesh.first_vertex = static_cast<uint32_t>(vertices.size());
-
-        // Initialize bounding box with extreme values: set min to largest possible float, max to smallest possible float
-        mesh.bbox_min = vec3{.x = std::numeric_limits<float>::max(), .y = std::numeric_limits<float>::max(), .z = std::numeric_limits<float>::max()};
-        mesh.bbox_max = vec3{.x = -std::numeric_limits<float>::max(), .y = -std::numeric_limits<float>::max(), .z = -std::numeric_limits<float>::max()};
-
-        for (uint32_t i = 0; i < mesh.count; ++i) {
-            PosNorTexTanVertex vertex{};
-
-            for (auto const &[attr_name, attr] : mesh.attributes) {
-                uint8_t const *ptr = attr.src.data.data() + attr.offset + i * attr.stride;
-
-                if (attr_name == "POSITION") {
-                    vertex.Position = {read_float(ptr), read_float(ptr + 4), read_float(ptr + 8)};
-
-                    // Compute bounding box
-                    mesh.bbox_min.x = std::min(mesh.bbox_min.x, vertex.Position.x);
-                    mesh.bbox_min.y = std::min(mesh.bbox_min.y, vertex.Position.y);
-                    mesh.bbox_min.z = std::min(mesh.bbox_min.z, vertex.Position.z);
-                    mesh.bbox_max.x = std::max(mesh.bbox_max.x, vertex.Position.x);
-                    mesh.bbox_max.y = std::max(mesh.bbox_max.y, vertex.Position.y);
-                    mesh.bbox_max.z = std::max(mesh.bbox_max.z, vertex.Position.z);
-                } else if (attr_name == "NORMAL") {
-                    vertex.Normal = {read_float(ptr), read_float(ptr + 4), read_float(ptr + 8)};
-                } else if (attr_name == "TEXCOORD") {
-                    vertex.TexCoord = {read_float(ptr), 1.0f - read_float(ptr + 4)}; // need to flip V to make sure origin_check works correctly. TODO: check if this is correct? 
-                } else if (attr_name == "TANGENT") {
-                    vertex.Tangent = {read_float(ptr), read_float(ptr + 4), read_float(ptr + 8), read_float(ptr + 12)};
+// Helper to read an index of the given type from a byte pointer
+inline uint32_t read_index(uint8_t const *ptr, VkIndexType format) {
+    if (format == VK_INDEX_TYPE_UINT32) return *reinterpret_cast<uint32_t const*>(ptr);
+    if (format == VK_INDEX_TYPE_UINT16) return *reinterpret_cast<uint16_t const*>(ptr);
+    return *ptr; // VK_INDEX_TYPE_UINT8
+}
+
+inline uint32_t index_size(VkIndexType format) {
+    if (format == VK_INDEX_TYPE_UINT32) return 4;
+    if (format == VK_INDEX_TYPE_UINT16) return 2;
+    return 1; // VK_INDEX_TYPE_UINT8
+}
+
+// Hash/equality on the raw bytes of a vertex, used to weld identical vertices:
+struct VertexBytesHash {
+    size_t operator()(PosNorTexTanVertex const &v) const {
+        // FNV-1a over the vertex's bytes
+        uint8_t const *bytes = reinterpret_cast<uint8_t const*>(&v);
+        uint64_t h = 14695981039346656037ull;
+        for (size_t i = 0; i < sizeof(v); ++i) {
+            h = (h ^ bytes[i]) * 1099511628211ull;
+        }
+        return size_t(h);
+    }
+};
+struct VertexBytesEqual {
+    bool operator()(PosNorTexTanVertex const &a, PosNorTexTanVertex const &b) const {
+        return std::memcmp(&a, &b, sizeof(a)) == 0;
+    }
+};
+
+// If all of a mesh's attributes come interleaved from one data file in exactly the PosNorTexTanVertex layout ("pnTt", stride 48),
+// returns a pointer to its first vertex so the bytes can be used without repacking; otherwise returns nullptr.
+static uint8_t const *pnTt_data(S72 const &s72, S72::Mesh const &mesh, uint32_t vertex_count) {
+    if (mesh.attributes.size() != 4) return nullptr;
+    auto position = mesh.attributes.find("POSITION");
+    auto normal = mesh.attributes.find("NORMAL");
+    auto tangent = mesh.attributes.find("TANGENT");
+    auto texcoord = mesh.attributes.find("TEXCOORD");
+    if (position == mesh.attributes.end() || normal == mesh.attributes.end()
+     || tangent == mesh.attributes.end() || texcoord == mesh.attributes.end()) return nullptr;
+
+    S72::DataFile const &src = s72[position->second.src];
+    uint32_t base = position->second.offset;
+    auto matches = [&](S72::Mesh::Attribute const &attr, uint32_t offset, VkFormat format) {
+        return attr.src == position->second.src && attr.stride == sizeof(PosNorTexTanVertex) && attr.offset == base + offset && attr.format == format;
+    };
+    if (!matches(position->second, offsetof(PosNorTexTanVertex, Position), VK_FORMAT_R32G32B32_SFLOAT)) return nullptr;
+    if (!matches(normal->second, offsetof(PosNorTexTanVertex, Normal), VK_FORMAT_R32G32B32_SFLOAT)) return nullptr;
+    if (!matches(tangent->second, offsetof(PosNorTexTanVertex, Tangent), VK_FORMAT_R32G32B32A32_SFLOAT)) return nullptr;
+    if (!matches(texcoord->second, offsetof(PosNorTexTanVertex, TexCoord), VK_FORMAT_R32G32_SFLOAT)) return nullptr;
+
+    // must be float-aligned and entirely inside the file:
+    if (base % alignof(float) != 0) return nullptr;
+    if (uint64_t(base) + uint64_t(vertex_count) * sizeof(PosNorTexTanVertex) > src.data.size()) return nullptr;
+
+    return src.data.data() + base;
+}
+
+// Running bounding box over vertex positions; kept in locals (instead of updating mesh.bbox_* per vertex)
+// so the min/max reduction stays in registers and vectorizes:
+struct PositionBounds {
+    float lo[3] = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+    float hi[3] = {-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max()};
+
+    void add(float x, float y, float z) {
+        lo[0] = std::min(lo[0], x); lo[1] = std::min(lo[1], y); lo[2] = std::min(lo[2], z);
+        hi[0] = std::max(hi[0], x); hi[1] = std::max(hi[1], y); hi[2] = std::max(hi[2], z);
+    }
+};
+
+// Converts one attribute element to the destination member's floats (missing components are zero):
+using AttributeConverter = void (*)(uint8_t const *src, float *dst);
+
+template< uint32_t SrcComponents, uint32_t DstComponents >
+static void convert_floats(uint8_t const *src, float *dst) {
+    float tmp[SrcComponents];
+    std::memcpy(tmp, src, sizeof(tmp));
+    for (uint32_t c = 0; c < DstComponents; ++c) {
+        dst[c] = (c < SrcComponents ? tmp[c] : 0.0f);
+    }
+}
+
+// Number of components in a 32-bit float vertex format (0 for anything else):
+static uint32_t float_components(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_R32_SFLOAT: return 1;
+        case VK_FORMAT_R32G32_SFLOAT: return 2;
+        case VK_FORMAT_R32G32B32_SFLOAT: return 3;
+        case VK_FORMAT_R32G32B32A32_SFLOAT: return 4;
+        default: return 0;
+    }
+}
+
+template< uint32_t DstComponents >
+static AttributeConverter float_converter(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_R32_SFLOAT: return convert_floats< 1, DstComponents >;
+        case VK_FORMAT_R32G32_SFLOAT: return convert_floats< 2, DstComponents >;
+        case VK_FORMAT_R32G32B32_SFLOAT: return convert_floats< 3, DstComponents >;
+        case VK_FORMAT_R32G32B32A32_SFLOAT: return convert_floats< 4, DstComponents >;
+        default: return nullptr;
+    }
+}
+
+// One step of a mesh's attribute plan: where an attribute comes from, where it goes in PosNorTexTanVertex, and how to convert it.
+struct AttributeCopy {
+    uint8_t const *src; // first element in the data file
+    uint32_t stride;
+    uint32_t dst_offset; // offset of the destination member in PosNorTexTanVertex
+    AttributeConverter convert;
+};
+
+// Resolves a mesh's attributes once, so the per-vertex loop doesn't do any name lookups or format checks:
+static std::vector< AttributeCopy > compile_attribute_plan(S72 const &s72, S72::Mesh const &mesh, uint32_t vertex_count) {
+    std::vector< AttributeCopy > plan;
+    for (auto const &[attr_name, attr] : mesh.attributes) {
+        uint32_t dst_offset;
+        AttributeConverter convert;
+        if (attr_name == "POSITION") {
+            dst_offset = offsetof(PosNorTexTanVertex, Position);
+            convert = float_converter< 3 >(attr.format);
+        } else if (attr_name == "NORMAL") {
+            dst_offset = offsetof(PosNorTexTanVertex, Normal);
+            convert = float_converter< 3 >(attr.format);
+        } else if (attr_name == "TANGENT") {
+            dst_offset = offsetof(PosNorTexTanVertex, Tangent);
+            convert = float_converter< 4 >(attr.format);
+        } else if (attr_name == "TEXCOORD") {
+            dst_offset = offsetof(PosNorTexTanVertex, TexCoord);
+            convert = float_converter< 2 >(attr.format);
+        } else {
+            continue; // not used by PosNorTexTanVertex
+        }
+
+        if (!convert) {
+            throw std::runtime_error("Mesh \"" + mesh.name + "\"'s attribute \"" + attr_name + "\" has a format that can't be converted to floats.");
+        }
+        S72::DataFile const &src = s72[attr.src];
+        if (vertex_count > 0 && uint64_t(attr.offset) + uint64_t(vertex_count - 1) * attr.stride + float_components(attr.format) * sizeof(float) > src.data.size()) {
+            throw std::runtime_error("Mesh \"" + mesh.name + "\"'s attribute \"" + attr_name + "\" runs past the end of \"" + src.src + "\".");
+        }
+
+        plan.emplace_back(AttributeCopy{
+            .src = src.data.data() + attr.offset,
+            .stride = attr.stride,
+            .dst_offset = dst_offset,
+            .convert = convert,
+        });
+    }
+    return plan;
+}
+
+// meshes smaller than this draw fast enough as they are, so they don't get levels of detail:
+static constexpr uint32_t MinLODTriangles = 256;
+
+void S72::process_meshes(bool weld, ThreadPool *pool, uint32_t lod_levels) {
+    // Meshes are processed in three steps so the expensive parts can run in parallel while the output stays
+    // in the same (array) order no matter how many threads are used:
+    //  1. (parallel) resolve each mesh's layout and count its vertices
+    //  2. (serial) reserve each mesh's range of the pooled vertex and index arrays
+    //  3. (parallel) fill those ranges
+    // then welded meshes' leftover space is squeezed out, and (if asked for) levels of detail are appended to the indices.
+    lod_levels = std::clamp(lod_levels, 1u, Mesh::MaxLODLevels);
+    struct MeshWork {
+        Mesh *mesh;
+        uint32_t attribute_count = 0; // vertices read from the attribute streams
+        bool welding = false;
+        uint8_t const *pnTt = nullptr; // see pnTt_data
+        bool mapped = false; // uploaded straight from the data file (see mapped_vertices)
+        bool lod = false; // gets levels of detail
+        bool welded_for_lod = false; // pnTt mesh that would have been mapped if it weren't welded for its levels of detail
+        std::vector< AttributeCopy > plan; // only needed if !pnTt
+        std::vector< Mesh::LOD > lods; // levels after the first, with first_index relative to lod_indices
+        std::vector< uint32_t > lod_indices;
+    };
+    std::vector< MeshWork > work;
+    work.reserve(meshes.size());
+    for (Mesh &mesh : meshes) {
+        work.emplace_back(MeshWork{.mesh = &mesh});
+    }
+
+    for_each_index(pool, work.size(), [&](size_t w) {
+        MeshWork &job = work[w];
+        Mesh &mesh = *job.mesh;
+
+        // for indexed meshes, "count" is the number of indices, and the attribute streams hold (max index + 1) vertices:
+        job.attribute_count = mesh.count;
+        mesh.index_count = 0;
+        if (mesh.indices) {
+            Mesh::Indices const &idx = *mesh.indices;
+            DataFile const &src = (*this)[idx.src];
+            uint32_t size = index_size(idx.format);
+            if (uint64_t(idx.offset) + uint64_t(mesh.count) * size > src.data.size()) {
+                throw std::runtime_error("Mesh \"" + mesh.name + "\"'s indices run past the end of \"" + src.src + "\".");
+            }
+
+            uint32_t max_index = 0;
+            for (uint32_t i = 0; i < mesh.count; ++i) {
+                max_index = std::max(max_index, read_index(src.data.data() + idx.offset + i * size, idx.format));
+            }
+            mesh.index_count = mesh.count;
+            job.attribute_count = (mesh.count == 0 ? 0 : max_index + 1);
+        }
+
+        // levels of detail are index lists, so big non-indexed triangle lists get welded for them even if welding wasn't asked for:
+        job.lod = (lod_levels > 1 && mesh.topology == VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST && mesh.count / 3 >= MinLODTriangles);
+
+        // weld only meshes that don't come with their own indices:
+        job.welding = (weld || job.lod) && !mesh.indices;
+        if (job.welding) mesh.index_count = mesh.count;
+
+        job.pnTt = pnTt_data(*this, mesh, job.attribute_count);
+        job.mapped = (job.pnTt && !job.welding);
+        job.welded_for_lod = (job.pnTt && job.welding && !weld);
+        if (!job.pnTt) job.plan = compile_attribute_plan(*this, mesh, job.attribute_count);
+    });
+
+    // reserve ranges (welded meshes get their un-welded size for now):
+    uint32_t mapped_count = 0; // vertices referenced through mapped_vertices
+    size_t const first_repacked = vertices.size();
+    size_t vertex_count = first_repacked;
+    size_t index_count = indices.size();
+    for (MeshWork &job : work) {
+        Mesh &mesh = *job.mesh;
+        mesh.first_index = static_cast<uint32_t>(index_count);
+        index_count += mesh.index_count;
+        if (job.mapped) {
+            mesh.first_vertex = mapped_count; // relative to the mapped block for now
+            mesh.vertex_count = job.attribute_count;
+            mapped_count += job.attribute_count;
+            mapped_vertices.emplace_back(job.pnTt, size_t(job.attribute_count) * sizeof(PosNorTexTanVertex));
+        } else {
+            mesh.first_vertex = static_cast<uint32_t>(vertex_count);
+            vertex_count += job.attribute_count;
+        }
+    }
+    vertices.resize(vertex_count); // value-initialized, so attributes a mesh lacks are zero
+    indices.resize(index_count);
+
+    for_each_index(pool, work.size(), [&](size_t w) {
+        MeshWork const &job = work[w];
+        Mesh &mesh = *job.mesh;
+
+        if (mesh.indices) {
+            Mesh::Indices const &idx = *mesh.indices;
+            uint8_t const *data = (*this)[idx.src].data.data();
+            uint32_t size = index_size(idx.format);
+            for (uint32_t i = 0; i < mesh.count; ++i) {
+                indices[mesh.first_index + i] = read_index(data + idx.offset + i * size, idx.format);
+            }
+        }
+
+        PositionBounds bounds;
+        if (job.mapped) {
+            // already stored as PosNorTexTanVertex, so upload straight from the mapped file; only need the bounds:
+            for (uint32_t i = 0; i < job.attribute_count; ++i) {
+                uint8_t const *ptr = job.pnTt + i * sizeof(PosNorTexTanVertex);
+                bounds.add(read_float(ptr), read_float(ptr + 4), read_float(ptr + 8));
+            }
+        } else if (job.pnTt) {
+            // bulk copy of whole vertices; bounds computed in the same pass:
+            PosNorTexTanVertex *dst = vertices.data() + mesh.first_vertex;
+            for (uint32_t i = 0; i < job.attribute_count; ++i) {
+                std::memcpy(&dst[i], job.pnTt + i * sizeof(PosNorTexTanVertex), sizeof(PosNorTexTanVertex));
+                bounds.add(dst[i].Position.x, dst[i].Position.y, dst[i].Position.z);
+            }
+        } else {
+            // general layout: run the compiled per-attribute plan for each vertex
+            PosNorTexTanVertex *dst = vertices.data() + mesh.first_vertex;
+            for (uint32_t i = 0; i < job.attribute_count; ++i) {
+                uint8_t *vertex = reinterpret_cast<uint8_t *>(&dst[i]);
+                for (AttributeCopy const &copy : job.plan) {
+                    copy.convert(copy.src + size_t(i) * copy.stride, reinterpret_cast<float *>(vertex + copy.dst_offset));
                 }
+                bounds.add(dst[i].Position.x, dst[i].Position.y, dst[i].Position.z);
             }
+        }
 
-            vertices.push_back(vertex);
+        mesh.bbox_min = vec3{.x = bounds.lo[0], .y = bounds.lo[1], .z = bounds.lo[2]};
+        mesh.bbox_max = vec3{.x = bounds.hi[0], .y = bounds.hi[1], .z = bounds.hi[2]};
+
+        if (job.welding) {
+            // compact this mesh's vertices to the front of its range, reusing identical ones:
+            std::unordered_map< PosNorTexTanVertex, uint32_t, VertexBytesHash, VertexBytesEqual > welded; // vertex -> index relative to first_vertex
+            welded.reserve(job.attribute_count);
+            uint32_t kept = 0;
+            for (uint32_t i = 0; i < job.attribute_count; ++i) {
+                PosNorTexTanVertex vertex = vertices[mesh.first_vertex + i];
+                auto [it, inserted] = welded.emplace(vertex, kept);
+                if (inserted) vertices[mesh.first_vertex + kept++] = vertex;
+                indices[mesh.first_index + i] = it->second;
+            }
+            mesh.vertex_count = kept;
+        } else if (!job.mapped) {
+            mesh.vertex_count = job.attribute_count;
         }
+    });
+
+    // close the gaps welding left behind (indices are relative to first_vertex, so they don't change):
+    uint32_t packed = static_cast<uint32_t>(first_repacked);
+    for (MeshWork const &job : work) {
+        if (job.mapped) continue;
+        Mesh &mesh = *job.mesh;
+        if (mesh.first_vertex != packed) {
+            std::memmove(&vertices[packed], &vertices[mesh.first_vertex], size_t(mesh.vertex_count) * sizeof(PosNorTexTanVertex));
+            mesh.first_vertex = packed;
+        }
+        packed += mesh.vertex_count;
+    }
+    vertices.resize(packed);
+
+    // levels of detail, each simplified from the one before (meshes with levels of detail are never mapped, see job.welding):
+    for_each_index(pool, work.size(), [&](size_t w) {
+        MeshWork &job = work[w];
+        Mesh &mesh = *job.mesh;
+        mesh.lods.clear();
+        if (!job.lod) return;
+
+        std::vector< float > positions(size_t(mesh.vertex_count) * 3);
+        for (uint32_t i = 0; i < mesh.vertex_count; ++i) {
+            PosNorTexTanVertex const &v = vertices[mesh.first_vertex + i];
+            positions[3 * i + 0] = v.Position.x;
+            positions[3 * i + 1] = v.Position.y;
+            positions[3 * i + 2] = v.Position.z;
+        }
+
+        MeshSimplifier simplifier;
+        simplifier.init(std::move(positions), std::vector< uint32_t >(indices.begin() + mesh.first_index, indices.begin() + mesh.first_index + mesh.index_count));
+        uint32_t triangles = mesh.index_count / 3;
+        for (uint32_t level = 1; level < lod_levels; ++level) {
+            simplifier.simplify(triangles / 2);
+            uint32_t simplified = uint32_t(simplifier.indices.size() / 3);
+            if (simplified == 0 || simplified > triangles * 3 / 4) break; // (not enough left that can collapse to be worth another level)
+            job.lods.emplace_back(Mesh::LOD{
+                .first_index = uint32_t(job.lod_indices.size()),
+                .index_count = simplified * 3,
+                .error = simplifier.error,
+            });
+            job.lod_indices.insert(job.lod_indices.end(), simplifier.indices.begin(), simplifier.indices.end());
+            triangles = simplified;
+        }
+    });
+    for (MeshWork &job : work) {
+        if (job.lods.empty()) continue;
+        Mesh &mesh = *job.mesh;
+        mesh.lods.emplace_back(Mesh::LOD{ .first_index = mesh.first_index, .index_count = mesh.index_count, .error = 0.0f });
+        uint32_t base = static_cast<uint32_t>(indices.size());
+        for (Mesh::LOD lod : job.lods) {
+            lod.first_index += base;
+            mesh.lods.emplace_back(lod);
+        }
+        indices.insert(indices.end(), job.lod_indices.begin(), job.lod_indices.end());
+    }
+
+    // mapped vertices go after the repacked ones in the pooled vertex buffer:
+    for (MeshWork const &job : work) {
+        if (job.mapped) job.mesh->first_vertex += static_cast<uint32_t>(vertices.size());
+    }
 
-        std::cout << "Processed mesh: " << mesh_name
-                  << " (first=" << mesh.first_vertex << ", count=" << mesh.count
+    for (MeshWork const &job : work) {
+        Mesh const &mesh = *job.mesh;
+        std::cout << "Processed mesh: " << mesh.name;
+        if (job.mapped) std::cout << " (mapped";
+        else std::cout << " (first=" << mesh.first_vertex;
+        std::cout << ", count=" << mesh.count
+                  << ", vertices=" << mesh.vertex_count << ", indices=" << mesh.index_count
                   << ", bbox=[" << mesh.bbox_min.x << "," << mesh.bbox_min.y << "," << mesh.bbox_min.z
                   << "] to [" << mesh.bbox_max.x << "," << mesh.bbox_max.y << "," << mesh.bbox_max.z << "])" << std::endl;
+        if (job.welded_for_lod) {
+            std::cout << "  welded for levels of detail, so copied instead of uploaded from the mapped data file" << std::endl;
+        }
+        if (!mesh.lods.empty()) {
+            std::cout << "  levels of detail:";
+            for (Mesh::LOD const &lod : mesh.lods) {
+                std::cout << " " << lod.index_count / 3 << " triangles (error " << lod.error << ")";
+            }
+            std::cout << std::endl;
+        }
     }
 
-    std::cout << "Total pooled vertices: " << vertices.size() << std::endl;
+    std::cout << "Total pooled vertices: " << vertices.size() << " (+" << mapped_count << " mapped), indices: " << indices.size() << std::endl;
 }
 
-void S72::process_textures() {
-    for (auto &[key, texture] : textures) {
+//append the rest of the mip chain to a texture whose pixels hold just level 0:
+// each level is a 2x2 box filter of the one above (odd sizes clamp the footprint at the edge), down to 1x1.
+// srgb colors are averaged in linear space -- averaging the encoded values would darken every level.
+static void build_mip_chain(S72::Texture &texture) {
+    static std::array< float, 256 > const srgb_to_linear = [](){
+        std::array< float, 256 > table;
+        for (uint32_t i = 0; i < 256; ++i) {
+            float c = i / 255.0f;
+            table[i] = (c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f));
+        }
+        return table;
+    }();
+    auto linear_to_srgb = [](float l) -> uint8_t {
+        float c = (l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f);
+        return uint8_t(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+    };
+    bool srgb = (texture.format == S72::Texture::Format::srgb);
+
+    uint32_t width = uint32_t(texture.width), height = uint32_t(texture.height);
+    size_t src = 0; //offset of the level being filtered
+    texture.mip_levels = 1;
+    while (width > 1 || height > 1) {
+        uint32_t next_width = std::max(1u, width / 2), next_height = std::max(1u, height / 2);
+        size_t dst = texture.pixels.size();
+        texture.pixels.resize(dst + size_t(next_width) * next_height * 4);
+        uint8_t const *above = texture.pixels.data() + src;
+        uint8_t *level = texture.pixels.data() + dst;
+
+        for (uint32_t y = 0; y < next_height; ++y) {
+            uint32_t y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+            for (uint32_t x = 0; x < next_width; ++x) {
+                uint32_t x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+                uint8_t const *texels[4] = {
+                    above + (size_t(y0) * width + x0) * 4, above + (size_t(y0) * width + x1) * 4,
+                    above + (size_t(y1) * width + x0) * 4, above + (size_t(y1) * width + x1) * 4,
+                };
+                uint8_t *out = level + (size_t(y) * next_width + x) * 4;
+                for (uint32_t c = 0; c < 4; ++c) {
+                    if (srgb && c < 3) { //(alpha is always linear)
+                        float sum = 0.0f;
+                        for (uint8_t const *t : texels) sum += srgb_to_linear[t[c]];
+                        out[c] = linear_to_srgb(0.25f * sum);
+                    } else {
+                        uint32_t sum = 2; //(rounds to nearest)
+                        for (uint8_t const *t : texels) sum += t[c];
+                        out[c] = uint8_t(sum / 4);
+                    }
+                }
+            }
+        }
+
+        src = dst;
+        width = next_width;
+        height = next_height;
+        texture.mip_levels += 1;
+    }
+}
+
+void S72::process_textures(ThreadPool *pool) {
+    std::vector< Texture * > to_load;
+    for (Texture &texture : textures) {
         // Skip if already loaded
         if (!texture.pixels.empty()) continue;
+        to_load.emplace_back(&texture);
+    }
 
-        std::cout << "Loading texture: " << texture.path << std::endl;
+    // decode in parallel; messages are collected per texture and printed afterward so the log reads the same for any thread count:
+    std::vector< std::string > warnings(to_load.size());
+    for_each_index(pool, to_load.size(), [&](size_t t) {
+        Texture &texture = *to_load[t];
 
         // Load image using stb_image (always request RGBA = 4 channels)
         int width, height, channels;
-        unsigned char* data = stbi_load(texture.path.c_str(), &width, &height, &channels, 4);
+        unsigned char* data = stbi_load(texture.path.c_str(), &width, &height, &channels, 4); // (stb's failure reason is thread-local, so this is safe to call concurrently)
 
         if (!data) {
-            std::cerr << "WARNING: Failed to load texture \"" << texture.path << "\": " << stbi_failure_reason() << std::endl;
+            warnings[t] = "WARNING: Failed to load texture \"" + texture.path + "\": " + stbi_failure_reason();
             // Create a 1x1 magenta placeholder texture to make missing textures obvious
             texture.width = 1;
             texture.height = 1;
             texture.channels = 4;
             texture.pixels = {255, 0, 255, 255}; // magenta
-            continue;
+            return;
         }
 
         texture.width = width;
@@ -1106,8 +1679,40 @@ void S72::process_textures() {
         // Free stb_image allocated memory
         stbi_image_free(data);
 
-        std::cout << "  Loaded: " << width << "x" << height << " (" << channels << " original channels)" << std::endl;
+        // minified flat textures sample from smaller copies of themselves (cube faces are stacked in one image and rgbe can't be box-filtered byte-wise, so those keep just level 0):
+        if (texture.type == Texture::Type::flat && texture.format != Texture::Format::rgbe) {
+            build_mip_chain(texture);
+        }
+    });
+
+    for (size_t t = 0; t < to_load.size(); ++t) {
+        Texture const &texture = *to_load[t];
+        std::cout << "Loading texture: " << texture.path << std::endl;
+        if (!warnings[t].empty()) {
+            std::cerr << warnings[t] << std::endl;
+        } else {
+            std::cout << "  Loaded: " << texture.width << "x" << texture.height << " (" << texture.channels << " original channels, " << texture.mip_levels << " mip levels)" << std::endl;
+        }
     }
 
     std::cout << "Loaded " << textures.size() << " textures." << std::endl;
-}
\ No newline at end of file
+}
+size_t S72::Driver::seek(float time) {
+    assert(!times.empty());
+    size_t n = times.size();
+    size_t k = std::min(cursor, n - 1);
+
+    // playing forward: step a few keys ahead of the cursor (a frame rarely skips more than that):
+    for (uint32_t step = 0; step < 4 && times[k] <= time && k + 1 < n && times[k + 1] <= time; ++step) {
+        ++k;
+    }
+
+    // still not in [times[k], times[k+1]) means time jumped (backwards, or far ahead), so search the whole array:
+    if ((k != 0 && time < times[k]) || (k + 1 < n && times[k + 1] <= time)) {
+        size_t after = std::upper_bound(times.begin(), times.end(), time) - times.begin(); // first key later than time
+        k = (after == 0 ? 0 : after - 1);
+    }
+
+    cursor = k;
+    return k;
+}
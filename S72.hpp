@@ -8,6 +8,12 @@
 #include <string>
 #include <vector>
 #include <optional>
+#include <unordered_map>
+#include <memory>
+#include <span>
+#include <type_traits>
+
+struct ThreadPool;
 
 struct S72 {
     //NOTE: redefine these for your vector and quaternion types of choice:
@@ -16,13 +22,30 @@ struct S72 {
 	using quat = struct quat_internal{ float x, y, z, w; };
 	using color = struct color_internal{ float r, g, b; };
 
-    static S72 load(std::string const &file);
-    void process_meshes(); // extract vertices from binary data into pooled buffer
-    void process_textures(); // load texture images from disk using stb_image
+    // each of these can spread its work across a ThreadPool (nullptr = run on the calling thread); results don't depend on the thread count
+    static S72 load(std::string const &file, ThreadPool *pool = nullptr);
+    void process_meshes(bool weld = false, ThreadPool *pool = nullptr, uint32_t lod_levels = 1); // extract vertices (and indices) from binary data into pooled buffers; weld: generate indices for non-indexed meshes by merging identical vertices; lod_levels: build up to this many levels of detail (see Mesh::lods)
+    void process_textures(ThreadPool *pool = nullptr); // load texture images from disk using stb_image
     void process_drivers();
 
+    // Scene cache (.s72c): the fully processed scene (what load + process_meshes + process_textures produce) in one versioned binary file,
+    // which is mapped and used in place next time (see S72-Cache.cpp). The processing options are recorded along with every source file's
+    // size, modification time, and hash, and the cache is only used if all of them still match:
+    struct CacheOptions {
+        bool weld = false;
+        uint32_t lod_levels = 1;
+    };
+    void save_cache(std::string const &cache_file, std::string const &scene_file, CacheOptions const &options) const; // throws on failure
+    static std::optional< S72 > load_cache(std::string const &cache_file, CacheOptions const &options); // empty (after saying why) if the cache is missing, stale, or was built differently
+    std::shared_ptr< void const > cache_storage; // keeps the cache's mapping alive when loaded from one (mapped_vertices point into it)
+
     // Pooled vertex data (populated by process_meshes):
     std::vector<PosNorTexTanVertex> vertices;
+    // Pooled index data (populated by process_meshes); indices are relative to the mesh's first_vertex:
+    std::vector<uint32_t> indices;
+    // Meshes whose data file already holds PosNorTexTanVertex-layout vertices (interleaved pnTt, stride 48) aren't repacked into `vertices`;
+    // instead these are views of the mapped bytes, uploaded as-is and placed after `vertices` in the pooled vertex buffer:
+    std::vector< std::span< uint8_t const > > mapped_vertices;
 
     //forward declarations so we can write the scene's objects in the same order as in the spec:
 	struct Node;
@@ -35,6 +58,31 @@ struct S72 {
 	struct Environment;
 	struct Light;
 
+    //Each kind of object is stored in one contiguous array (below), in the order the s72 file first mentions it --
+    //so walking a kind touches memory in order and visits objects in the same order every run.
+    //Objects refer to each other with Handles: 32-bit indices into those arrays, typed so a mesh handle can't look up a node.
+    //(Names only matter while the file is being read; S72::load resolves them to handles and then forgets them.)
+    template< typename T >
+    struct Handle {
+        uint32_t index = -1U; // -1U: no object (like a null pointer)
+        explicit operator bool() const { return index != -1U; }
+        bool operator==(Handle const &) const = default;
+    };
+    using NodeHandle = Handle< Node >;
+    using MeshHandle = Handle< Mesh >;
+    using DataFileHandle = Handle< DataFile >;
+    using CameraHandle = Handle< Camera >;
+    using TextureHandle = Handle< Texture >;
+    using MaterialHandle = Handle< Material >;
+    using EnvironmentHandle = Handle< Environment >;
+    using LightHandle = Handle< Light >;
+
+    //s72[handle] is the object a (non-null) handle refers to:
+    template< typename T > T &operator[](Handle< T > handle) { return objects< T >()[handle.index]; }
+    template< typename T > T const &operator[](Handle< T > handle) const { return const_cast< S72 & >(*this).objects< T >()[handle.index]; }
+    //...and objects< T >() is the array that holds every T:
+    template< typename T > std::vector< T > &objects();
+
     //-------------------------------------------------
 	//s72 Scenes contain:
 
@@ -47,7 +95,7 @@ struct S72 {
     */
     struct Scene {
         std::string name;
-        std::vector< Node * > roots;
+        std::vector< NodeHandle > roots;
     };
     Scene scene;
 
@@ -70,15 +118,15 @@ struct S72 {
         vec3 translation = vec3{ .x = 0.0f, .y = 0.0f, .z = 0.0f};
         quat rotation = quat{ .x = 0.0f, .y = 0.0f, .z = 0.0f, .w = 1.0f};
         vec3 scale = vec3{ .x = 1.0f, .y = 1.0f, .z = 1.0f};
-        std::vector< Node * > children;
+        std::vector< NodeHandle > children;
 
         // optional, null of not specified:
-        Mesh *mesh = nullptr;
-        Camera *camera = nullptr;
-        Environment *environment = nullptr;
-        Light *light = nullptr;
+        MeshHandle mesh;
+        CameraHandle camera;
+        EnvironmentHandle environment;
+        LightHandle light;
     };
-    std::unordered_map< std::string, Node> nodes;
+    std::vector< Node > nodes;
 
     /* zero or more "MESH"s, all with unique names:
     {
@@ -101,29 +149,43 @@ struct S72 {
         VkPrimitiveTopology topology;
         uint32_t count;
         struct Indices {
-            DataFile &src;
+            DataFileHandle src;
             uint32_t offset;
             VkIndexType format;
         };
         std::optional< Indices > indices; // mesh index stream, optional
 
         struct Attribute {
-            DataFile &src;
+            DataFileHandle src;
             uint32_t offset;
             uint32_t stride;
             VkFormat format;
         };
         std::unordered_map< std::string, Attribute > attributes;
-        Material *material = nullptr; // optional, null if not specified
+        MaterialHandle material; // optional, null if not specified
 
         // Computed during process_meshes():
         uint32_t first_vertex = 0; // index into pooled vertices buffer
+        uint32_t vertex_count = 0; // number of vertices in the pooled vertices buffer (can be less than count after welding)
+        uint32_t first_index = 0; // index into pooled indices buffer
+        uint32_t index_count = 0; // number of indices to draw; 0 means the mesh is drawn non-indexed
+
+        // Levels of detail (computed during process_meshes() for big enough triangle lists; empty otherwise).
+        // lods[0] is the full mesh (first_index, index_count); each later level has about half the triangles of the one before.
+        // All levels index the same vertices, so only the index range changes:
+        struct LOD {
+            uint32_t first_index = 0; // index into pooled indices buffer
+            uint32_t index_count = 0;
+            float error = 0.0f; // how far (in local units) this level's surface may be from the full mesh
+        };
+        static constexpr uint32_t MaxLODLevels = 4;
+        std::vector< LOD > lods;
 
         // Bounding box in local space (computed during process_meshes):
         vec3 bbox_min = vec3{.x = 0.0f, .y = 0.0f, .z = 0.0f};
         vec3 bbox_max = vec3{.x = 0.0f, .y = 0.0f, .z = 0.0f};
     };
-    std::unordered_map< std::string, Mesh> meshes;
+    std::vector< Mesh > meshes;
 
     //data files referenced by meshes:
 	struct DataFile {
@@ -137,10 +199,13 @@ struct S72 {
 
         It would be reasonable to (e.g.) add extra data members to `DataFile` and `Texture` and load them at the end of `S72::load` just after the path computation code.
         */
-        std::vector< uint8_t > data; //raw bytes loaded from the file
+        std::span< uint8_t const > data; //raw bytes of the file (read-only)
+        std::shared_ptr< void const > storage; //keeps `data` alive: a read-only memory mapping of the file (shared with the page cache, paged in lazily), or a heap copy if mapping failed
+
+        void load(); //fill in data + storage from path (throws if the file can't be opened or read)
 	};
-    //we organize the data files by "src" so that multiple attributes with the same src resolve to the same DataFile:
-	std::unordered_map< std::string, DataFile > data_files;
+    //there is one data file per "src", so that multiple attributes with the same src resolve to the same DataFile:
+	std::vector< DataFile > data_files;
 
     /* zero or more "CAMERA"s, all with unique names:
     {
@@ -165,7 +230,7 @@ struct S72 {
 		//(s72 leaves open the possibility of other camera projections, but does not define any)
         std::variant< Perspective > projection;
     };
-    std::unordered_map< std::string, Camera > cameras;
+    std::vector< Camera > cameras;
 
     /* zero or more "DRIVER"s, all with unique names:
     {
@@ -181,7 +246,7 @@ struct S72 {
     struct Driver {
 		std::string name;
 
-		Node &node;
+		NodeHandle node;
 
 		enum class Channel {
 			translation,
@@ -197,6 +262,14 @@ struct S72 {
 			LINEAR,
 			SLERP,
 		} interpolation = Interpolation::LINEAR;
+
+		// playback cursor: the keyframe seek() found last time.
+		// Monotonic playback lands in the same interval (or a few keys later) every frame, so that is checked first:
+		size_t cursor = 0;
+
+		// the key k with times[k] <= time < times[k+1] (0 before the first key, times.size()-1 at or after the last);
+		// amortized O(1) from cursor during playback, O(log n) binary search after a seek; leaves cursor at k:
+		size_t seek(float time);
 	};
 	//NOTE: drivers are stored in a vector in the order they appear in the file.
 	//      This is because drivers are applied in file order: //vv
@@ -222,10 +295,11 @@ struct S72 {
 		int width = 0;
 		int height = 0;
 		int channels = 0; // number of channels in the original image
-		std::vector<uint8_t> pixels; // RGBA pixels (always 4 channels after loading)
+		uint32_t mip_levels = 1; // flat linear/srgb textures get a full chain down to 1x1 (built by process_textures); others just have level 0
+		std::vector<uint8_t> pixels; // RGBA pixels (always 4 channels after loading), every mip level back-to-back starting with the full-size one
 	};
-	//we organize textures by src + type + format, so that two materials using to the same image *in the same way* end up referring to the same texture object:
-    std::unordered_map< std::string, Texture > textures;
+	//there is one texture per src + type + format, so that two materials using to the same image *in the same way* end up referring to the same texture object:
+    std::vector< Texture > textures;
 
     /* zero or more "MATERIAL"s, all with unique names:
     {
@@ -261,18 +335,18 @@ struct S72 {
     struct Material {
 		std::string name;
 
-		Texture *normal_map = nullptr; //optional, set to null if not specified
-		Texture *displacement_map = nullptr; //optional, set to null if not specified
+		TextureHandle normal_map; //optional, null if not specified
+		TextureHandle displacement_map; //optional, null if not specified
 
 		//Materials are one of these types:
-		// NOTE: if any of these parameters are the Texture * branch of their variant, they are not null
+		// NOTE: if any of these parameters are the TextureHandle branch of their variant, they are not null
 		struct PBR {
-			std::variant< color, Texture * > albedo = color{.r = 1.0f, .g = 1.0f, .b = 1.0f};
-			std::variant< float, Texture * > roughness = 1.0f;
-			std::variant< float, Texture * > metalness = 0.0f;
+			std::variant< color, TextureHandle > albedo = color{.r = 1.0f, .g = 1.0f, .b = 1.0f};
+			std::variant< float, TextureHandle > roughness = 1.0f;
+			std::variant< float, TextureHandle > metalness = 0.0f;
 		};
 		struct Lambertian {
-			std::variant< color, Texture * > albedo = color{.r = 1.0f, .g = 1.0f, .b = 1.0f};
+			std::variant< color, TextureHandle > albedo = color{.r = 1.0f, .g = 1.0f, .b = 1.0f};
 		};
 
         // no parameters:
@@ -281,7 +355,7 @@ struct S72 {
 
 		std::variant< PBR, Lambertian, Mirror, Environment > brdf;
 	};
-    std::unordered_map< std::string, Material > materials;
+    std::vector< Material > materials;
 
     /* 
     {
@@ -292,9 +366,9 @@ struct S72 {
     */
     struct Environment{
         std::string name;
-        Texture *radiance;
+        TextureHandle radiance;
     };
-    std::unordered_map< std::string, Environment> environments;
+    std::vector< Environment > environments;
 
     /* zero or more "LIGHT"s, all with unique names:
     {
@@ -348,5 +422,18 @@ struct S72 {
 		};
 		std::variant< Sun, Sphere, Spot > source;
 	};
-    std::unordered_map< std::string, Light> lights;
-};
\ No newline at end of file
+    std::vector< Light > lights;
+};
+
+template< typename T >
+std::vector< T > &S72::objects() {
+    if constexpr (std::is_same_v< T, Node >) return nodes;
+    else if constexpr (std::is_same_v< T, Mesh >) return meshes;
+    else if constexpr (std::is_same_v< T, DataFile >) return data_files;
+    else if constexpr (std::is_same_v< T, Camera >) return cameras;
+    else if constexpr (std::is_same_v< T, Texture >) return textures;
+    else if constexpr (std::is_same_v< T, Material >) return materials;
+    else if constexpr (std::is_same_v< T, Environment >) return environments;
+    else if constexpr (std::is_same_v< T, Light >) return lights;
+    else static_assert(sizeof(T) == 0, "not a kind of S72 object");
+}
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint32_t threads) {
+	if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+	slices.reserve(threads);
+	for (uint32_t i = 0; i < threads; ++i) {
+		slices.emplace_back(std::make_unique< Slice >());
+	}
+
+	// the thread calling parallel_for does work too, so only need (threads - 1) workers:
+	workers.reserve(threads - 1);
+	for (uint32_t i = 1; i < threads; ++i) {
+		workers.emplace_back(&ThreadPool::worker_main, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		quit = true;
+	}
+	wake.notify_all();
+	for (auto &worker : workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::parallel_for(size_t count, std::function< void(size_t) > const &job_) {
+	if (count == 0) return;
+
+	// no one to share with; just run in order:
+	if (workers.empty() || count == 1) {
+		for (size_t i = 0; i < count; ++i) {
+			job_(i);
+		}
+		return;
+	}
+
+	{ // deal out contiguous slices and wake the workers:
+		std::unique_lock< std::mutex > lock(mutex);
+		for (uint32_t s = 0; s < slices.size(); ++s) {
+			std::unique_lock< std::mutex > slice_lock(slices[s]->mutex);
+			slices[s]->begin = count * s / slices.size();
+			slices[s]->end = count * (s + 1) / slices.size();
+		}
+		job = &job_;
+		error = nullptr;
+		busy = uint32_t(workers.size());
+		generation += 1;
+	}
+	wake.notify_all();
+
+	run(0);
+
+	std::exception_ptr thrown;
+	{ // wait for the workers to finish whatever they were in the middle of:
+		std::unique_lock< std::mutex > lock(mutex);
+		done.wait(lock, [this](){ return busy == 0; });
+		job = nullptr;
+		thrown = error;
+	}
+
+	if (thrown) std::rethrow_exception(thrown);
+}
+
+void ThreadPool::worker_main(uint32_t self) {
+	uint64_t seen = 0;
+	while (true) {
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			wake.wait(lock, [&](){ return quit || generation != seen; });
+			if (quit) return;
+			seen = generation;
+		}
+
+		run(self);
+
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			busy -= 1;
+			if (busy == 0) done.notify_one();
+		}
+	}
+}
+
+void ThreadPool::run(uint32_t self) {
+	size_t index;
+	while (take(self, &index)) {
+		try {
+			(*job)(index);
+		} catch (...) {
+			std::unique_lock< std::mutex > lock(mutex);
+			if (!error) error = std::current_exception();
+			lock.unlock();
+
+			// abandon the remaining work:
+			for (auto &slice : slices) {
+				std::unique_lock< std::mutex > slice_lock(slice->mutex);
+				slice->begin = slice->end;
+			}
+		}
+	}
+}
+
+bool ThreadPool::take(uint32_t self, size_t *index) {
+	{ // own slice first, from the front:
+		Slice &slice = *slices[self];
+		std::unique_lock< std::mutex > lock(slice.mutex);
+		if (slice.begin < slice.end) {
+			*index = slice.begin++;
+			return true;
+		}
+	}
+
+	// then steal from the back of the others, starting with the next thread over:
+	for (uint32_t offset = 1; offset < slices.size(); ++offset) {
+		Slice &slice = *slices[(self + offset) % slices.size()];
+		std::unique_lock< std::mutex > lock(slice.mutex);
+		if (slice.begin < slice.end) {
+			*index = --slice.end;
+			return true;
+		}
+	}
+
+	return false;
+}
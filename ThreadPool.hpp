@@ -0,0 +1,51 @@
+#pragma once
+
+// A small work-stealing thread pool, used to spread scene loading (data files, mesh repacking, texture decoding) and command buffer recording across cores.
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct ThreadPool {
+	// threads: total number of threads doing work, including the caller of parallel_for; 0 picks std::thread::hardware_concurrency()
+	explicit ThreadPool(uint32_t threads = 0);
+	ThreadPool(ThreadPool const &) = delete; //you shouldn't be copying this object
+	~ThreadPool();
+
+	uint32_t size() const { return uint32_t(workers.size()) + 1; } // worker threads plus the calling thread
+
+	// runs job(i) for every i in [0, count) and returns once all of them are done.
+	// Each thread starts on its own contiguous slice of indices and steals from the back of other slices once its own runs dry.
+	// Nothing is shared between jobs, so writing results into slot i of a pre-sized array gives the same output for any thread count.
+	// If any job throws, the remaining jobs are skipped and the first exception is rethrown here.
+	void parallel_for(size_t count, std::function< void(size_t) > const &job);
+
+private:
+	struct Slice {
+		std::mutex mutex;
+		size_t begin = 0; // owner takes from the front
+		size_t end = 0; // thieves take from the back
+	};
+	std::vector< std::unique_ptr< Slice > > slices; // one per thread; slices[0] belongs to the thread calling parallel_for
+
+	std::vector< std::thread > workers;
+
+	// state shared with the workers, guarded by mutex:
+	std::mutex mutex;
+	std::condition_variable wake; // signalled when a new job is posted (or on shutdown)
+	std::condition_variable done; // signalled when the last worker finishes a job
+	std::function< void(size_t) > const *job = nullptr;
+	uint64_t generation = 0; // incremented for every parallel_for, so workers can tell new jobs from old ones
+	uint32_t busy = 0; // workers still running the current job
+	bool quit = false;
+	std::exception_ptr error; // first exception thrown by a job
+
+	void worker_main(uint32_t self);
+	void run(uint32_t self); // work on the current job until every slice is empty
+	bool take(uint32_t self, size_t *index); // next index from own slice, or stolen from another
+};
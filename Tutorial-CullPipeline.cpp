@@ -0,0 +1,120 @@
+#include "Tutorial.hpp"
+
+#include "Helpers.hpp"
+#include "VK.hpp"
+
+static uint32_t comp_code[] =
+#include "spv/cull.comp.inl"
+;
+
+// same shader, compiled with OCCLUSION defined:
+static uint32_t occlusion_comp_code[] =
+#include "spv/cull-occlusion.comp.inl"
+;
+
+void Tutorial::CullPipeline::create(RTG &rtg, bool occlusion) {
+	VkShaderModule comp_module = (occlusion ? rtg.helpers.create_shader_module(occlusion_comp_code) : rtg.helpers.create_shader_module(comp_code));
+
+	{ // the set0_Cull layout holds the culling camera, the per-frame transforms, the (static) batches, and the culling outputs:
+		std::array< VkDescriptorSetLayoutBinding, 9 > bindings;
+		for (uint32_t b = 0; b < bindings.size(); ++b) {
+			bindings[b] = VkDescriptorSetLayoutBinding{
+				.binding = b,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, // 2: Batches, 3: InstanceBatches, 4: Culled, 5: Commands, 6: DrawCounts, 7: BatchVisible, 8: Stats
+				.descriptorCount = 1,
+				.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			};
+		}
+		// these two live in the workspace's frame_data, so (like the objects pipeline) they are dynamic:
+		bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC; // Cull
+		bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC; // Transforms
+
+		VkDescriptorSetLayoutCreateInfo create_info{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.bindingCount = uint32_t(bindings.size()),
+			.pBindings = bindings.data(),
+		};
+
+		VK( vkCreateDescriptorSetLayout(rtg.device, &create_info, nullptr, &set0_Cull) );
+	}
+
+	if (occlusion) { // the set1_DepthPyramid layout holds the (whole) depth pyramid:
+		VkDescriptorSetLayoutBinding binding{
+			.binding = 0,
+			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		};
+
+		VkDescriptorSetLayoutCreateInfo create_info{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.bindingCount = 1,
+			.pBindings = &binding,
+		};
+
+		VK( vkCreateDescriptorSetLayout(rtg.device, &create_info, nullptr, &set1_DepthPyramid) );
+	}
+
+	{ // create pipeline layout:
+		VkPushConstantRange range{
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.offset = 0,
+			.size = sizeof(Push),
+		};
+
+		std::array< VkDescriptorSetLayout, 2 > layouts{
+			set0_Cull,
+			set1_DepthPyramid,
+		};
+
+		VkPipelineLayoutCreateInfo create_info{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+			.setLayoutCount = (occlusion ? 2u : 1u),
+			.pSetLayouts = layouts.data(),
+			.pushConstantRangeCount = 1,
+			.pPushConstantRanges = &range,
+		};
+
+		VK( vkCreatePipelineLayout(rtg.device, &create_info, nullptr, &layout) );
+	}
+
+	{ // create pipeline (compute pipelines are just one shader stage + a layout):
+		VkComputePipelineCreateInfo create_info{
+			.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+			.stage = VkPipelineShaderStageCreateInfo{
+				.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+				.stage = VK_SHADER_STAGE_COMPUTE_BIT,
+				.module = comp_module,
+				.pName = "main",
+			},
+			.layout = layout,
+		};
+
+		VK( vkCreateComputePipelines(rtg.device, VK_NULL_HANDLE, 1, &create_info, nullptr, &handle) );
+	}
+
+	// module no longer needed now that pipeline is created:
+	vkDestroyShaderModule(rtg.device, comp_module, nullptr);
+}
+
+void Tutorial::CullPipeline::destroy(RTG &rtg) {
+	if (set0_Cull != VK_NULL_HANDLE) {
+		vkDestroyDescriptorSetLayout(rtg.device, set0_Cull, nullptr);
+		set0_Cull = VK_NULL_HANDLE;
+	}
+
+	if (set1_DepthPyramid != VK_NULL_HANDLE) {
+		vkDestroyDescriptorSetLayout(rtg.device, set1_DepthPyramid, nullptr);
+		set1_DepthPyramid = VK_NULL_HANDLE;
+	}
+
+	if (layout != VK_NULL_HANDLE) {
+		vkDestroyPipelineLayout(rtg.device, layout, nullptr);
+		layout = VK_NULL_HANDLE;
+	}
+
+	if (handle != VK_NULL_HANDLE) {
+		vkDestroyPipeline(rtg.device, handle, nullptr);
+		handle = VK_NULL_HANDLE;
+	}
+}
@@ -0,0 +1,84 @@
+#include "Tutorial.hpp"
+
+#include "Helpers.hpp"
+#include "VK.hpp"
+
+static uint32_t comp_code[] =
+#include "spv/depth_pyramid.comp.inl"
+;
+
+void Tutorial::DepthPyramidPipeline::create(RTG &rtg) {
+	VkShaderModule comp_module = rtg.helpers.create_shader_module(comp_code);
+
+	{ // the set0_Reduce layout holds the level being read and the level being written:
+		std::array< VkDescriptorSetLayoutBinding, 2 > bindings{
+			VkDescriptorSetLayoutBinding{ // SRC (the depth buffer, or the previous level)
+				.binding = 0,
+				.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				.descriptorCount = 1,
+				.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			},
+			VkDescriptorSetLayoutBinding{ // DST
+				.binding = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+				.descriptorCount = 1,
+				.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			},
+		};
+
+		VkDescriptorSetLayoutCreateInfo create_info{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.bindingCount = uint32_t(bindings.size()),
+			.pBindings = bindings.data(),
+		};
+
+		VK( vkCreateDescriptorSetLayout(rtg.device, &create_info, nullptr, &set0_Reduce) );
+	}
+
+	{ // create pipeline layout (no push constants; the shader gets the level sizes from its images):
+		VkPipelineLayoutCreateInfo create_info{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+			.setLayoutCount = 1,
+			.pSetLayouts = &set0_Reduce,
+			.pushConstantRangeCount = 0,
+			.pPushConstantRanges = nullptr,
+		};
+
+		VK( vkCreatePipelineLayout(rtg.device, &create_info, nullptr, &layout) );
+	}
+
+	{ // create pipeline:
+		VkComputePipelineCreateInfo create_info{
+			.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+			.stage = VkPipelineShaderStageCreateInfo{
+				.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+				.stage = VK_SHADER_STAGE_COMPUTE_BIT,
+				.module = comp_module,
+				.pName = "main",
+			},
+			.layout = layout,
+		};
+
+		VK( vkCreateComputePipelines(rtg.device, VK_NULL_HANDLE, 1, &create_info, nullptr, &handle) );
+	}
+
+	// module no longer needed now that pipeline is created:
+	vkDestroyShaderModule(rtg.device, comp_module, nullptr);
+}
+
+void Tutorial::DepthPyramidPipeline::destroy(RTG &rtg) {
+	if (set0_Reduce != VK_NULL_HANDLE) {
+		vkDestroyDescriptorSetLayout(rtg.device, set0_Reduce, nullptr);
+		set0_Reduce = VK_NULL_HANDLE;
+	}
+
+	if (layout != VK_NULL_HANDLE) {
+		vkDestroyPipelineLayout(rtg.device, layout, nullptr);
+		layout = VK_NULL_HANDLE;
+	}
+
+	if (handle != VK_NULL_HANDLE) {
+		vkDestroyPipeline(rtg.device, handle, nullptr);
+		handle = VK_NULL_HANDLE;
+	}
+}
@@ -16,14 +16,21 @@ void Tutorial::ObjectsPipeline::create(RTG &rtg, VkRenderPass render_pass, uint3
 	VkShaderModule vert_module = rtg.helpers.create_shader_module(vert_code);
 	VkShaderModule frag_module = rtg.helpers.create_shader_module(frag_code);
 
-	{ // the set0_World layout holds World as a uniform buffer used in the fragment shader:
-		std::array< VkDescriptorSetLayoutBinding, 1 > bindings{
+	{ // the set0_World layout holds World as a uniform buffer used in the fragment shader, and Camera as a uniform buffer used in the vertex shader:
+		// (both are dynamic, since they live at a different offset in the workspace's frame_data every frame)
+		std::array< VkDescriptorSetLayoutBinding, 2 > bindings{
 			VkDescriptorSetLayoutBinding{
 				.binding = 0,
-				.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+				.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
 				.descriptorCount = 1,
 				.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT // for fragment shader, not vertex shader
 			},
+			VkDescriptorSetLayoutBinding{
+				.binding = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+				.descriptorCount = 1,
+				.stageFlags = VK_SHADER_STAGE_VERTEX_BIT // CLIP_FROM_WORLD, once per frame instead of baked into every Transform
+			},
 		};
 
 		VkDescriptorSetLayoutCreateInfo create_info{
@@ -35,11 +42,11 @@ void Tutorial::ObjectsPipeline::create(RTG &rtg, VkRenderPass render_pass, uint3
 		VK( vkCreateDescriptorSetLayout(rtg.device, &create_info, nullptr, &set0_World) );
 	}
 
-	{ // the set1_Transforms layout holds an array of Transform sturctures in a storage buffer used in the vertex shader:
+	{ // the set1_Transforms layout holds an array of Transform sturctures in a (dynamic) storage buffer used in the vertex shader:
 		std::array< VkDescriptorSetLayoutBinding, 1 > bindings{
 			VkDescriptorSetLayoutBinding{
 				.binding = 0,
-				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
 				.descriptorCount = 1,
 				.stageFlags = VK_SHADER_STAGE_VERTEX_BIT // vertex stage (for vertex shader, not for fragment shader)
 			},
@@ -54,30 +61,44 @@ void Tutorial::ObjectsPipeline::create(RTG &rtg, VkRenderPass render_pass, uint3
 		VK( vkCreateDescriptorSetLayout(rtg.device, &create_info, nullptr, &set1_Transforms) );
 	}
 
-	{ // the set2_TEXTURE layout has a single descriptor for a sampler2D used in the fragment shader:
+	{ // the set2_TEXTURES layout has an array of sampler2Ds used in the fragment shader, indexed by each instance's Transform::TEXTURE:
 		std::array< VkDescriptorSetLayoutBinding, 1 > bindings{
 			VkDescriptorSetLayoutBinding{
 				.binding = 0,
 				.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, // because a GLSL sampler2D references both an image and the parameters for how to sample from that image.
-				.descriptorCount = 1,
+				.descriptorCount = MaxTextures, // upper bound; the actual count is picked when the set is allocated
 				.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT // fragment stage
 			},
 		};
 
+		// the array only needs as many entries as the scene has textures, and may be written while bound (so textures can be added later):
+		std::array< VkDescriptorBindingFlags, 1 > binding_flags{
+			VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT,
+		};
+		static_assert(binding_flags.size() == bindings.size(), "every binding needs flags");
+
+		VkDescriptorSetLayoutBindingFlagsCreateInfo flags_info{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+			.bindingCount = uint32_t(binding_flags.size()),
+			.pBindingFlags = binding_flags.data(),
+		};
+
 		VkDescriptorSetLayoutCreateInfo create_info{
 			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.pNext = &flags_info,
+			.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
 			.bindingCount = uint32_t(bindings.size()),
 			.pBindings = bindings.data(),
 		};
 
-		VK( vkCreateDescriptorSetLayout(rtg.device, &create_info, nullptr, &set2_TEXTURE) );
+		VK( vkCreateDescriptorSetLayout(rtg.device, &create_info, nullptr, &set2_TEXTURES) );
 	}
 
 	{ // create pipeline layout; why do we need blocks like this in C++ //??
 		std::array< VkDescriptorSetLayout, 3 > layouts{
 			set0_World,
 			set1_Transforms,
-			set2_TEXTURE,
+			set2_TEXTURES,
 		};
 		
 		VkPipelineLayoutCreateInfo create_info{ // what does this syntax mean again //??
@@ -214,9 +235,9 @@ void Tutorial::ObjectsPipeline::destroy(RTG &rtg) {
 		set1_Transforms = VK_NULL_HANDLE;
 	}
 
-	if (set2_TEXTURE != VK_NULL_HANDLE) {
-		vkDestroyDescriptorSetLayout(rtg.device, set2_TEXTURE, nullptr);
-		set2_TEXTURE = VK_NULL_HANDLE;
+	if (set2_TEXTURES != VK_NULL_HANDLE) {
+		vkDestroyDescriptorSetLayout(rtg.device, set2_TEXTURES, nullptr);
+		set2_TEXTURES = VK_NULL_HANDLE;
 	}
 
 	if (layout != VK_NULL_HANDLE) {
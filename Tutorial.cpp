@@ -39,6 +39,13 @@ Tutorial::Tutorial(RTG &rtg_, S72 &s72_) : rtg(rtg_), s72(s72_) {
 			culling_mode = CullingMode::None;
 		} else if (rtg.configuration.culling_mode == "frustum") {
 			culling_mode = CullingMode::Frustum;
+		} else if (rtg.configuration.culling_mode == "bvh") {
+			culling_mode = CullingMode::BVH;
+		} else if (rtg.configuration.culling_mode == "gpu" || rtg.configuration.culling_mode == "hiz") {
+			culling_mode = (rtg.configuration.culling_mode == "gpu" ? CullingMode::GPU : CullingMode::HiZ);
+			if (!rtg.draw_indirect_count) {
+				throw std::runtime_error("Culling mode '" + rtg.configuration.culling_mode + "' needs the multiDrawIndirect and drawIndirectCount device features, which this device doesn't have.");
+			}
 		} else {
 			throw std::runtime_error("Invalid culling mode '" + rtg.configuration.culling_mode + "'.");
 		}
@@ -50,6 +57,7 @@ Tutorial::Tutorial(RTG &rtg_, S72 &s72_) : rtg(rtg_), s72(s72_) {
 		{ VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32 }, // one-component, 32-bit signed floating-point format that has 32 bits in the depth component;  a two-component, 32-bit format that has 24 unsigned normalized bits in the depth component and, optionally, 8 bits that are unused.
 		VK_IMAGE_TILING_OPTIMAL,
 		VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT //  an image view can be used as a framebuffer depth/stencil attachment and as an input attachment.
+		| (culling_mode == CullingMode::HiZ ? VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT : 0) // (the depth pyramid is built by sampling the depth buffer)
 	);
 
 	{ // create render pass 
@@ -69,7 +77,8 @@ Tutorial::Tutorial(RTG &rtg_, S72 &s72_) : rtg(rtg_), s72(s72_) {
 				.format = depth_format,
 				.samples = VK_SAMPLE_COUNT_1_BIT,
 				.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-				.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE, // Clear to max depth at start
+				// Clear to max depth at start; only kept afterward if the depth pyramid gets built from it:
+				.storeOp = (culling_mode == CullingMode::HiZ ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE),
 				.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE, // Discard after rendering
 				.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
 				.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
@@ -120,7 +129,8 @@ Tutorial::Tutorial(RTG &rtg_, S72 &s72_) : rtg(rtg_), s72(s72_) {
 				.dstSubpass = 0,
 
 				// If the previous frame was doing depth testing, finish writing those depth values before we clear and start using the depth buffer.
-				.srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, // Happen *after* fragment shaders (for things like alpha testing)
+				// (and, with CullingMode::HiZ, finish building the depth pyramid from them)
+				.srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, // Happen *after* fragment shaders (for things like alpha testing)
 				.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT, // Happen *before* fragment shaders run (fast depth rejection)
 				.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
 				.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
@@ -149,28 +159,83 @@ Tutorial::Tutorial(RTG &rtg_, S72 &s72_) : rtg(rtg_), s72(s72_) {
 		VK( vkCreateCommandPool(rtg.device, &create_info, nullptr, &command_pool) );
 	}
 
+	if (rtg.configuration.record_threads != 1) { // record the render pass's draws on several threads (see Workspace::recorders):
+		record_pool = std::make_unique< ThreadPool >(rtg.configuration.record_threads);
+		if (record_pool->size() == 1) record_pool.reset(); // only one hardware thread, so just record inline
+	}
+	if (rtg.configuration.animation_threads != 1) { // animate on several threads (see evaluate_drivers and update_scene_nodes):
+		animation_pool = std::make_unique< ThreadPool >(rtg.configuration.animation_threads);
+		if (animation_pool->size() == 1) animation_pool.reset();
+	}
+
+	if (rtg.configuration.gpu_profile) { // check what can be measured (query pools are per-workspace, below):
+		uint32_t count = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(rtg.physical_device, &count, nullptr);
+		std::vector< VkQueueFamilyProperties > queue_families(count);
+		vkGetPhysicalDeviceQueueFamilyProperties(rtg.physical_device, &count, queue_families.data());
+		uint32_t valid_bits = queue_families[rtg.graphics_queue_family.value()].timestampValidBits;
+
+		if (valid_bits == 0) {
+			std::cerr << "WARNING: the graphics queue doesn't write timestamps; --gpu-profile is off." << std::endl;
+		} else {
+			gpu_profiling = true;
+			timestamp_mask = (valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1);
+
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(rtg.physical_device, &properties);
+			timestamp_period = properties.limits.timestampPeriod;
+
+			// a query active in the primary command buffer only counts work in secondaries if the device has inherited queries:
+			pipeline_statistics = rtg.pipeline_statistics_query && (!record_pool || rtg.inherited_queries);
+			if (!pipeline_statistics) {
+				std::cerr << "WARNING: can't use pipeline statistics queries " << (rtg.pipeline_statistics_query ? "with --record-threads on this device" : "on this device") << "; --gpu-profile will only report times." << std::endl;
+			}
+
+			if (rtg.configuration.gpu_profile_csv != "") {
+				gpu_profile_csv.open(rtg.configuration.gpu_profile_csv);
+				if (!gpu_profile_csv) throw std::runtime_error("Failed to open '" + rtg.configuration.gpu_profile_csv + "' for writing.");
+				gpu_profile_csv << "frame";
+				for (char const *name : GPUPhaseNames) {
+					gpu_profile_csv << "," << name << "_ms";
+				}
+				gpu_profile_csv << ",total_ms,vertex_invocations,clipping_primitives,fragment_invocations\n";
+			}
+		}
+	}
+
 	background_pipeline.create(rtg, render_pass, 0);
 	lines_pipeline.create(rtg, render_pass, 0);
 	objects_pipeline.create(rtg, render_pass, 0);
+	if (gpu_culling()) {
+		cull_pipeline.create(rtg, culling_mode == CullingMode::HiZ);
+	}
+	if (culling_mode == CullingMode::HiZ) {
+		depth_pyramid_pipeline.create(rtg);
+	}
 
 	{ // create descriptor tool:
 		uint32_t per_workspace = uint32_t(rtg.workspaces.size()); // for easier-to-read counting
+		uint32_t gpu_culling = (this->gpu_culling() ? 1 : 0); // Cull set (1 uniform, 1 + 7 storage) + culled Transforms set (1 storage)
 
-		std::array< VkDescriptorPoolSize, 2 > pool_sizes{
-			VkDescriptorPoolSize{ // uniform buffer descriptors
-				.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-				.descriptorCount = 2 * per_workspace, // 1 descriptor per set, 2 set per workspace (world, camera)
+		std::array< VkDescriptorPoolSize, 3 > pool_sizes{
+			VkDescriptorPoolSize{ // dynamic uniform buffer descriptors (offset into the frame buffer at bind time)
+				.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+				.descriptorCount = (3 + gpu_culling) * per_workspace, // per workspace: lines Camera, objects World (world + camera), + Cull uniforms when GPU culling
 			},
-			VkDescriptorPoolSize{ // uniform buffer descriptors
+			VkDescriptorPoolSize{ // dynamic storage buffer descriptors
+				.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+				.descriptorCount = (1 + 2 * gpu_culling) * per_workspace, // per workspace: objects Transforms, + Cull set's Transforms and culled Transforms when GPU culling
+			},
+			VkDescriptorPoolSize{ // culling inputs + outputs
 				.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-				.descriptorCount = 1 * per_workspace, // one descriptor per set, one set per workspace
+				.descriptorCount = 7 * gpu_culling * per_workspace + 1, // per workspace: Cull set bindings 2-8 when GPU culling (+1 because descriptorCount must be > 0)
 			},
 		};
 
 		VkDescriptorPoolCreateInfo create_info{
 			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
 			.flags = 0, // because CREATE_FREE_DESCRIPTOR_SET_BIT isn't included, can't free individual descriptors allocated from this pool
-			.maxSets = 3 * per_workspace, // 3 sets per workspace (2 uniform buffer for world and camera and 1 storage buffer for transforms)
+			.maxSets = (3 + 2 * gpu_culling) * per_workspace, // per workspace: Camera, World, Transforms sets, + Cull and culled Transforms sets when GPU culling
 			.poolSizeCount = uint32_t(pool_sizes.size()),
 			.pPoolSizes = pool_sizes.data(),
 		};
@@ -178,6 +243,27 @@ Tutorial::Tutorial(RTG &rtg_, S72 &s72_) : rtg(rtg_), s72(s72_) {
 		VK( vkCreateDescriptorPool(rtg.device, &create_info, nullptr, &descriptor_pool) );
 	}
 
+	{ // decide where per-frame data lives:
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(rtg.physical_device, &properties);
+		uniform_offset_alignment = properties.limits.minUniformBufferOffsetAlignment;
+		storage_offset_alignment = properties.limits.minStorageBufferOffsetAlignment;
+
+		// if some memory is both device-local and host-visible (resizable BAR, or the 256MiB BAR window, or an integrated GPU),
+		// the CPU can write per-frame data right where the GPU will read it from:
+		VkMemoryPropertyFlags direct = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		for (uint32_t i = 0; i < rtg.helpers.memory_properties.memoryTypeCount; ++i) {
+			if ((rtg.helpers.memory_properties.memoryTypes[i].propertyFlags & direct) == direct) {
+				frame_data_properties = direct;
+				break;
+			}
+		}
+
+		if (rtg.configuration.debug) {
+			std::cout << "Per-frame data goes in " << (frame_data_properties & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT ? "device-local" : "host") << " memory." << std::endl;
+		}
+	}
+
 	workspaces.resize(rtg.workspaces.size());
 	for (Workspace &workspace : workspaces) {
 		// refsol::Tutorial_constructor_workspace(rtg, command_pool, &workspace.command_buffer);
@@ -191,18 +277,43 @@ Tutorial::Tutorial(RTG &rtg_, S72 &s72_) : rtg(rtg_), s72(s72_) {
 			VK( vkAllocateCommandBuffers(rtg.device, &alloc_info, &workspace.command_buffer) );
 		}
 
-		workspace.Camera_src = rtg.helpers.create_buffer(
-			sizeof(LinesPipeline::Camera),
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT, // going to have GPU copy from this memory
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, // host-visible memory, coherent (no special sync needed)
-			Helpers::Mapped // get a pointer to memory
-		);
-		workspace.Camera = rtg.helpers.create_buffer(
-			sizeof(LinesPipeline::Camera),
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, // going to use as a uniform buffer, also going to have GPU copy into this memory
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, // GPU-local memory
-			Helpers::Unmapped // don't get a pointer to memory
-		);
+		if (gpu_profiling) { // create query pools:
+			VkQueryPoolCreateInfo create_info{
+				.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+				.queryType = VK_QUERY_TYPE_TIMESTAMP,
+				.queryCount = GPUPhaseCount + 1,
+			};
+			VK( vkCreateQueryPool(rtg.device, &create_info, nullptr, &workspace.timestamps) );
+		}
+		if (pipeline_statistics) {
+			VkQueryPoolCreateInfo create_info{
+				.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+				.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS,
+				.queryCount = 1,
+				.pipelineStatistics = GPUProfileStatistics,
+			};
+			VK( vkCreateQueryPool(rtg.device, &create_info, nullptr, &workspace.statistics) );
+		}
+
+		if (record_pool) { // a command pool and secondary command buffer for every chunk render() can record in parallel:
+			workspace.recorders.resize(record_pool->size());
+			for (Workspace::Recorder &recorder : workspace.recorders) {
+				VkCommandPoolCreateInfo create_info{
+					.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+					.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT, // re-recorded every frame; the whole pool is reset at once
+					.queueFamilyIndex = rtg.graphics_queue_family.value(),
+				};
+				VK( vkCreateCommandPool(rtg.device, &create_info, nullptr, &recorder.command_pool) );
+
+				VkCommandBufferAllocateInfo alloc_info{
+					.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+					.commandPool = recorder.command_pool,
+					.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY, // executed from workspace.command_buffer, inside the render pass
+					.commandBufferCount = 1,
+				};
+				VK( vkAllocateCommandBuffers(rtg.device, &alloc_info, &recorder.command_buffer) );
+			}
+		}
 
 		// descriptor set:
 		{ //allocate descriptor set for Camera descriptor
@@ -216,19 +327,6 @@ Tutorial::Tutorial(RTG &rtg_, S72 &s72_) : rtg(rtg_), s72(s72_) {
 			VK( vkAllocateDescriptorSets(rtg.device, &alloc_info, &workspace.Camera_descriptors) );
 		}
 
-		workspace.World_src = rtg.helpers.create_buffer(
-			sizeof(ObjectsPipeline::World),
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT, // going to have GPU copy from this memory
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, // host-visible memory (The CPU can see this memory), coherent (no special sync needed, CPU writes are automatically visible to GPU)
-			Helpers::Mapped // get a pointer to memory
-		);
-		workspace.World = rtg.helpers.create_buffer(
-			sizeof(ObjectsPipeline::World),
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, // going to use as a uniform buffer, also going to have GPU copy into this memory
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, // GPU-local memory
-			Helpers::Unmapped // don't get a pointer to memory
-		);
-
 		{ //allocate descriptor set for World descriptor
 			VkDescriptorSetAllocateInfo alloc_info{
 				.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
@@ -248,56 +346,42 @@ Tutorial::Tutorial(RTG &rtg_, S72 &s72_) : rtg(rtg_), s72(s72_) {
 				.pSetLayouts = &objects_pipeline.set1_Transforms,
 			};
 
-			VK( vkAllocateDescriptorSets(rtg.device, &alloc_info, &workspace.Transforms_descriptors) ); // NOTE: we will fill in this descriptor set in render when buffers are [re-]allocated
+			VK( vkAllocateDescriptorSets(rtg.device, &alloc_info, &workspace.Transforms_descriptors) );
 		}
 
-		// descriptor write:
-		{ //point descriptor to Camera buffer:
-			VkDescriptorBufferInfo Camera_info{
-				.buffer = workspace.Camera.handle,
-				.offset = 0,
-				.range = workspace.Camera.size,
+		if (gpu_culling()) { //allocate descriptor sets for GPU culling (written in build_cull_batches and write_frame_descriptors):
+			std::array< VkDescriptorSetLayout, 2 > layouts{
+				cull_pipeline.set0_Cull,
+				objects_pipeline.set1_Transforms,
 			};
-
-			VkDescriptorBufferInfo World_info{
-				.buffer = workspace.World.handle,
-				.offset = 0,
-				.range = workspace.World.size,
-			};
-
-			std::array< VkWriteDescriptorSet, 2 > writes{
-				VkWriteDescriptorSet{
-					.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-					.dstSet = workspace.Camera_descriptors, // Which descriptor set to update  
-					.dstBinding = 0, // Which binding slot (matches shader)
-					.dstArrayElement = 0,
-					.descriptorCount = 1,
-					.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-					.pBufferInfo = &Camera_info, // The actual buffer to bind 
-				},
-				VkWriteDescriptorSet{
-					.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-					.dstSet = workspace.World_descriptors,
-					.dstBinding = 0,
-					.dstArrayElement = 0,
-					.descriptorCount = 1,
-					.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-					.pBufferInfo = &World_info,
-				},
+			std::array< VkDescriptorSet, 2 > sets;
+			VkDescriptorSetAllocateInfo alloc_info{
+				.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+				.descriptorPool = descriptor_pool,
+				.descriptorSetCount = uint32_t(layouts.size()),
+				.pSetLayouts = layouts.data(),
 			};
 
-			vkUpdateDescriptorSets(
-				rtg.device, //device
-				uint32_t(writes.size()), //descriptorWriteCount
-				writes.data(), //pDescriptorWrites
-				0, //descriptorCopyCount
-				nullptr //pDescriptorCopies
-			);
+			VK( vkAllocateDescriptorSets(rtg.device, &alloc_info, sets.data()) );
+			workspace.Cull_descriptors = sets[0];
+			workspace.culled_Transforms_descriptors = sets[1];
 		}
+
+		// enough for Camera + World and a few hundred Transforms up front; grows in render() if a frame needs more
+		// (descriptor writes happen in here):
+		reserve_frame_data(workspace, 64 * 1024);
 	}
 
 	{ //create a vertex buffer for the S72 (previously create object vertices pool buffer)
-		size_t bytes = s72.vertices.size() * sizeof(s72.vertices[0]);
+		// repacked vertices first, then any pnTt meshes straight from their mapped data files (see S72::mapped_vertices):
+		std::vector< std::pair< void const *, size_t > > pieces;
+		pieces.emplace_back(s72.vertices.data(), s72.vertices.size() * sizeof(s72.vertices[0]));
+		for (auto const &mapped : s72.mapped_vertices) {
+			pieces.emplace_back(mapped.data(), mapped.size());
+		}
+
+		size_t bytes = 0;
+		for (auto const &piece : pieces) bytes += piece.second;
 
 		object_vertices = rtg.helpers.create_buffer(
 			bytes,
@@ -308,7 +392,21 @@ Tutorial::Tutorial(RTG &rtg_, S72 &s72_) : rtg(rtg_), s72(s72_) {
 
 		// copy data to buffer
 		// notice: this uploads the data during initialization instead of during the per-frame rendering loop (our rendering function Tutorial::render())// foreshadow!
-		rtg.helpers.transfer_to_buffer(s72.vertices.data(), bytes, object_vertices);
+		// (queued into the current upload batch; submitted together with the textures below)
+		rtg.helpers.upload_to_buffer(pieces, object_vertices);
+	}
+
+	if (!s72.indices.empty()) { //create an index buffer for the S72's indexed (or welded) meshes
+		size_t bytes = s72.indices.size() * sizeof(s72.indices[0]);
+
+		object_indices = rtg.helpers.create_buffer(
+			bytes,
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, // going to use as index buffer, also going to have GPU copy into this memory
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, // GPU-local memory
+			Helpers::Unmapped // don't get a pointer to memory
+		);
+
+		rtg.helpers.upload_to_buffer(s72.indices.data(), bytes, object_indices);
 	}
 
 	{ // make textures for objects from S72 scene textures
@@ -325,11 +423,13 @@ Tutorial::Tutorial(RTG &rtg_, S72 &s72_) : rtg(rtg_), s72(s72_) {
 				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 				Helpers::Unmapped));
 
-			rtg.helpers.transfer_to_image(data.data(), sizeof(data[0]) * data.size(), textures.back());
+			rtg.helpers.upload_to_image(data.data(), sizeof(data[0]) * data.size(), textures.back());
 		}
 
 		// Now load textures from S72
-		for (auto &[key, s72_texture] : s72.textures) {
+		s72_texture_indices.assign(s72.textures.size(), 0); // (textures that don't load stay default white)
+		for (uint32_t t = 0; t < uint32_t(s72.textures.size()); ++t) {
+			S72::Texture const &s72_texture = s72.textures[t];
 			// Skip textures that failed to load (empty pixels)
 			if (s72_texture.pixels.empty()) {
 				std::cerr << "WARNING: Skipping texture with empty pixels: " << s72_texture.src << std::endl;
@@ -338,7 +438,7 @@ Tutorial::Tutorial(RTG &rtg_, S72 &s72_) : rtg(rtg_), s72(s72_) {
 
 			// Record the texture index for this S72 texture
 			uint32_t texture_index = static_cast<uint32_t>(textures.size());
-			texture_index_map[&s72_texture] = texture_index;
+			s72_texture_indices[t] = texture_index;
 
 			// Choose format based on the texture's format specification
 			VkFormat format;
@@ -359,9 +459,10 @@ Tutorial::Tutorial(RTG &rtg_, S72 &s72_) : rtg(rtg_), s72(s72_) {
 				VK_IMAGE_TILING_OPTIMAL,
 				VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
 				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-				Helpers::Unmapped));
+				Helpers::Unmapped,
+				s72_texture.mip_levels)); // (process_textures already built the smaller levels; they're in pixels after the full-size one)
 
-			rtg.helpers.transfer_to_image(s72_texture.pixels.data(), s72_texture.pixels.size(), textures.back());
+			rtg.helpers.upload_to_image(s72_texture.pixels.data(), s72_texture.pixels.size(), textures.back());
 
 			std::cout << "Created GPU texture for: " << s72_texture.src << " at index " << texture_index << std::endl;
 		}
@@ -370,15 +471,13 @@ Tutorial::Tutorial(RTG &rtg_, S72 &s72_) : rtg(rtg_), s72(s72_) {
 	}
 
 	{ // create texture indices for materials and textures for color albedos
-		for (auto &[name, mat] : s72.materials) {
+		material_albedo_indices.clear();
+		for (S72::Material const &mat : s72.materials) {
 			uint32_t tex_index = 0; // default white
 
 			if (auto* pbr = std::get_if<S72::Material::PBR>(&mat.brdf)) {
-				if (auto* tex = std::get_if<S72::Texture*>(&pbr->albedo)) {
-					auto it = texture_index_map.find(*tex);
-					if (it != texture_index_map.end()) {
-						tex_index = it->second;
-					}
+				if (auto* tex = std::get_if<S72::TextureHandle>(&pbr->albedo)) {
+					tex_index = s72_texture_indices[tex->index];
 				} else if (auto* col = std::get_if<S72::color>(&pbr->albedo)) {
 					// Create 1x1 texture from color
 					uint8_t r = static_cast<uint8_t>(std::clamp(col->r, 0.0f, 1.0f) * 255.0f);
@@ -395,14 +494,11 @@ Tutorial::Tutorial(RTG &rtg_, S72 &s72_) : rtg(rtg_), s72(s72_) {
 						VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
 						VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 						Helpers::Unmapped));
-					rtg.helpers.transfer_to_image(data.data(), sizeof(data[0]) * data.size(), textures.back());
+					rtg.helpers.upload_to_image(data.data(), sizeof(data[0]) * data.size(), textures.back());
 				}
 			} else if (auto* lambertian = std::get_if<S72::Material::Lambertian>(&mat.brdf)) {
-				if (auto* tex = std::get_if<S72::Texture*>(&lambertian->albedo)) {
-					auto it = texture_index_map.find(*tex);
-					if (it != texture_index_map.end()) {
-						tex_index = it->second;
-					}
+				if (auto* tex = std::get_if<S72::TextureHandle>(&lambertian->albedo)) {
+					tex_index = s72_texture_indices[tex->index];
 				} else if (auto* col = std::get_if<S72::color>(&lambertian->albedo)) {
 					// Create 1x1 texture from color
 					uint8_t r = static_cast<uint8_t>(std::clamp(col->r, 0.0f, 1.0f) * 255.0f);
@@ -419,16 +515,19 @@ Tutorial::Tutorial(RTG &rtg_, S72 &s72_) : rtg(rtg_), s72(s72_) {
 						VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
 						VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 						Helpers::Unmapped));
-					rtg.helpers.transfer_to_image(data.data(), sizeof(data[0]) * data.size(), textures.back());
+					rtg.helpers.upload_to_image(data.data(), sizeof(data[0]) * data.size(), textures.back());
 				}
 			}
 			// Mirror and Environment materials use default white (tex_index = 0)
 
-			material_albedo_map[&mat] = tex_index;
+			material_albedo_indices.emplace_back(tex_index);
 		}
-		std::cout << "Mapped " << material_albedo_map.size() << " materials to texture indices." << std::endl;
+		std::cout << "Mapped " << material_albedo_indices.size() << " materials to texture indices." << std::endl;
 	}
 
+	// submit all the scene uploads; the GPU copies them while we set up views, descriptors, and the scene graph below:
+	Helpers::UploadToken scene_uploaded = rtg.helpers.flush_uploads();
+
 	{ // make image views for each texture image
 		for (Helpers::AllocatedImage const &image : textures) {
 			// An image view describes how to access an image — Vulkan requires you to create a view before you can use an image in a shader or pipeline.
@@ -441,7 +540,7 @@ Tutorial::Tutorial(RTG &rtg_, S72 &s72_) : rtg(rtg_), s72(s72_) {
 				// .components sets swizzling and is fine when zero-initialied; Left zero-initialized, which means no channel swizzling — R maps to R, G to G, etc. (identity mapping). 
 				.subresourceRange{ // Specifies which part of the image to view:
 					.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, // this is a color image (not depth/stencil).
-					.baseMipLevel = 0, .levelCount = 1, // only the base mip level (no mipmaps).
+					.baseMipLevel = 0, .levelCount = image.mip_levels, // every mip level the image has (just the base level for most).
 					.baseArrayLayer = 0, .layerCount = 1, // single layer (not an array texture). 
 				},
 			};
@@ -466,39 +565,73 @@ Tutorial::Tutorial(RTG &rtg_, S72 &s72_) : rtg(rtg_), s72(s72_) {
 			.flags = 0,
 			.magFilter = VK_FILTER_LINEAR, // Use linear filtering for magnification (smoother)
 			.minFilter = VK_FILTER_LINEAR, // Use linear filtering for minification (smoother)
-			.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST, // When selecting between mipmap levels, snap to the nearest level rather than blending between two.
+			.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR, // Blend between the two nearest mipmap levels (trilinear filtering), so there's no visible seam where the level changes.
 			.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
 			.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
 			.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT, // When texture coordinates go outside [0, 1], the texture repeats (tiles). Other options include clamping or mirroring.
 			.mipLodBias = 0.0f, // No bias applied when selecting mipmap levels.
-			.anisotropyEnable = VK_FALSE, // Anisotropic filtering is disabled. This means maxAnisotropy is ignored.
-			.maxAnisotropy = VK_FALSE, // doesn't matter if anisotropy isn't enabled
+			.anisotropyEnable = (rtg.sampler_anisotropy ? VK_TRUE : VK_FALSE), // Anisotropic filtering (if the device supports it) takes extra samples along the direction a texture is stretched in, so surfaces at grazing angles stay sharp.
+			.maxAnisotropy = rtg.max_sampler_anisotropy, // as many samples as the device allows (RTG caps this at 16); ignored if anisotropy isn't enabled
 			.compareEnable = VK_FALSE, // Depth comparison is disabled (used for shadow mapping). So compareOp is ignored.
 			.compareOp = VK_COMPARE_OP_ALWAYS, // doesn't matter if compare isn't enabled
 			.minLod = 0.0f,
-			.maxLod = 0.0f, // Clamps the mipmap level to exactly 0, meaning only the base mip level is ever used.
+			.maxLod = VK_LOD_CLAMP_NONE, // No upper clamp -- use as many mip levels as each image has.
 			.borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK,
 			.unnormalizedCoordinates = VK_FALSE, // Texture coordinates are in the standard [0, 1] range rather than pixel coordinates.
 		};
 
 		// creates the sampler object and stores the handle in texture_sampler:
 		VK( vkCreateSampler(rtg.device, &create_info, nullptr, &texture_sampler) );
+
+		if (rtg.sampler_anisotropy) {
+			std::cout << "Texture sampler: trilinear, " << rtg.max_sampler_anisotropy << "x anisotropic." << std::endl;
+		} else {
+			std::cout << "Texture sampler: trilinear (device doesn't support anisotropic filtering)." << std::endl;
+		}
+	}
+
+	if (culling_mode == CullingMode::HiZ) { // make a sampler for the depth pyramid (only read with texelFetch, so filtering doesn't matter):
+		VkSamplerCreateInfo create_info {
+			.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+			.flags = 0,
+			.magFilter = VK_FILTER_NEAREST,
+			.minFilter = VK_FILTER_NEAREST,
+			.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+			.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+			.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+			.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+			.mipLodBias = 0.0f,
+			.anisotropyEnable = VK_FALSE,
+			.maxAnisotropy = 0.0f,
+			.compareEnable = VK_FALSE,
+			.compareOp = VK_COMPARE_OP_ALWAYS,
+			.minLod = 0.0f,
+			.maxLod = VK_LOD_CLAMP_NONE, // every level of the pyramid
+			.borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK,
+			.unnormalizedCoordinates = VK_FALSE,
+		};
+
+		VK( vkCreateSampler(rtg.device, &create_info, nullptr, &depth_pyramid_sampler) );
 	}
 		
+	if (textures.size() > ObjectsPipeline::MaxTextures) {
+		throw std::runtime_error("Scene has " + std::to_string(textures.size()) + " textures; the objects pipeline can only bind " + std::to_string(ObjectsPipeline::MaxTextures) + ".");
+	}
+
 	{ // create the texture descriptor pool
 		uint32_t per_texture = uint32_t(textures.size()); // for easier-to-read counting
 
 		std::array< VkDescriptorPoolSize, 1 > pool_sizes{ // tells Vulkan how much memory to reserve in the pool, categorized by type
 			VkDescriptorPoolSize{ // total number of individual descriptors available, categorized by type 
-				.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, // matches with the descriptor type in descriptor set layout (set2_TEXTURE) 
-				.descriptorCount = 1 * per_texture, // one descriptor per set, one set per workspace
+				.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, // matches with the descriptor type in descriptor set layout (set2_TEXTURES) 
+				.descriptorCount = std::max(1u, per_texture), // one descriptor per texture, all in one set (descriptorCount must be > 0)
 			},
 		};
 
 		VkDescriptorPoolCreateInfo create_info{
 			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-			.flags = 0, // because CREATE_FREE_DESCRIPTOR_SET_BIT isn't included, can't free individual descriptors allocated from this pool
-			.maxSets = 1 * per_texture, // one set per texture; total number of descriptor sets you can allocate from this pool
+			.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT, // required for sets with update-after-bind layouts
+			.maxSets = 1, // the one TEXTURES set
 			.poolSizeCount = uint32_t(pool_sizes.size()),
 			.pPoolSizes = pool_sizes.data(), // total number of individual descriptors available, categorized by type   
 		};
@@ -506,48 +639,66 @@ Tutorial::Tutorial(RTG &rtg_, S72 &s72_) : rtg(rtg_), s72(s72_) {
 		VK( vkCreateDescriptorPool(rtg.device, &create_info, nullptr, &texture_descriptor_pool) );
 	}
 
-	{ // allocate and write the texture descriptor sets
+	{ // allocate and write the TEXTURES descriptor set (with just as many array elements as there are textures):
+		uint32_t texture_count = uint32_t(textures.size());
+		VkDescriptorSetVariableDescriptorCountAllocateInfo count_info{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO,
+			.descriptorSetCount = 1,
+			.pDescriptorCounts = &texture_count,
+		};
 		VkDescriptorSetAllocateInfo alloc_info {
 			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+			.pNext = &count_info,
 			.descriptorPool = texture_descriptor_pool,
 			.descriptorSetCount = 1,
-			.pSetLayouts = &objects_pipeline.set2_TEXTURE,
+			.pSetLayouts = &objects_pipeline.set2_TEXTURES,
 		};
-		texture_descriptors.assign(textures.size(), VK_NULL_HANDLE);
-
-		for (VkDescriptorSet &descriptor_set : texture_descriptors) {
-			VK( vkAllocateDescriptorSets(rtg.device, &alloc_info, &descriptor_set) );
-		}
+		VK( vkAllocateDescriptorSets(rtg.device, &alloc_info, &TEXTURES_descriptors) );
 
-		// write descriptors for textures:
+		// write descriptors for textures (one write covering the whole array):
 		std::vector< VkDescriptorImageInfo > infos(textures.size());
-		std::vector< VkWriteDescriptorSet > writes(textures.size());
-
-		for (Helpers::AllocatedImage const &image : textures) {
-			size_t i = &image - &textures[0];
-
+		for (uint32_t i = 0; i < texture_count; ++i) {
 			infos[i] = VkDescriptorImageInfo{
 				.sampler = texture_sampler, // how to sample (filtering, wrapping, etc.)    
 				.imageView = texture_views[i], // which texture image to sample from
 				.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, // expected layout during shader access 
 			};
-			writes[i] = VkWriteDescriptorSet{
+		}
+
+		if (texture_count != 0) {
+			VkWriteDescriptorSet write{
 				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-				.dstSet = texture_descriptors[i], // which descriptor set to update      
+				.dstSet = TEXTURES_descriptors, // which descriptor set to update      
 				.dstBinding = 0, // binding index within that set (matches layout)
-				.dstArrayElement = 0, // starting array index (for arrayed bindings) 
-				.descriptorCount = 1, // updating 1 descriptor  
-				.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, // matches with the descriptor type in descriptor set layout (set2_TEXTURE) 
-				.pImageInfo = &infos[i],
+				.dstArrayElement = 0, // starting array index; TEXTURES[i] is textures[i]
+				.descriptorCount = texture_count,
+				.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, // matches with the descriptor type in descriptor set layout (set2_TEXTURES) 
+				.pImageInfo = infos.data(),
 			};
+
+			vkUpdateDescriptorSets(
+				rtg.device,
+				1, &write, // descriptorWrites count, data
+				0, nullptr // descriptorCopies count, data - what are these //vv specifies that we are updating the descriptor sets by writing new data into it instead of copying one set to another 
+			);
 		}
+	}
 
-		vkUpdateDescriptorSets(
-			rtg.device,
-			uint32_t(writes.size()), // descriptorWrites count
-			writes.data(), // descriptorWrites; can I use &writes here //vv No. &writes references to the vector, writes.data() references to the first elem
-			0, nullptr // descriptorCopies count, data - what are these //vv specifies that we are updating the descriptor sets by writing new data into it instead of copying one set to another 
-		);
+	// flatten the scene graph once (needs material_albedo_indices from above); update() only recomposes what drivers move
+	build_scene_nodes();
+
+	if (gpu_culling()) {
+		build_cull_batches();
+		scene_uploaded = rtg.helpers.flush_uploads(); // batches retire in order, so this covers the earlier uploads too
+	}
+
+	// everything must have landed before the first frame uses it:
+	rtg.helpers.wait_for_upload(scene_uploaded);
+
+	if (rtg.configuration.debug) { // how the static scene resources landed in device memory:
+		Helpers::MemoryStats stats = rtg.helpers.memory_stats();
+		std::cout << "Device memory: " << stats.allocations << " allocations in " << stats.blocks << " blocks; "
+		          << stats.live_bytes << " of " << stats.reserved_bytes << " bytes live, fragmentation " << stats.fragmentation() << std::endl;
 	}
 }
 
@@ -563,7 +714,7 @@ Tutorial::~Tutorial() {
 		texture_descriptor_pool = nullptr;
 
 		// this also frees the descriptor sets allocated from the pool:
-		texture_descriptors.clear();
+		TEXTURES_descriptors = VK_NULL_HANDLE;
 	}
 
 	if (texture_sampler) {
@@ -582,8 +733,21 @@ Tutorial::~Tutorial() {
 	}
 	textures.clear();
 
+	if (object_indices.handle != VK_NULL_HANDLE) {
+		rtg.helpers.destroy_buffer(std::move(object_indices));
+	}
+
 	rtg.helpers.destroy_buffer(std::move(object_vertices)); // why don't we need to check whether it != NULL before destroying it, like the other checks //vv the type is AllocatedBuffer, is a struct that wraps the handle; the destroy_buffer function can take care of checking whether the handle is null
 
+	if (depth_pyramid.handle != VK_NULL_HANDLE) {
+		destroy_depth_pyramid();
+	}
+
+	if (depth_pyramid_sampler) {
+		vkDestroySampler(rtg.device, depth_pyramid_sampler, nullptr);
+		depth_pyramid_sampler = VK_NULL_HANDLE;
+	}
+
 	if (swapchain_depth_image.handle != VK_NULL_HANDLE) {
 		destroy_framebuffers();
 	}
@@ -595,39 +759,41 @@ Tutorial::~Tutorial() {
 			workspace.command_buffer = VK_NULL_HANDLE;
 		}
 
-		if (workspace.lines_vertices_src.handle != VK_NULL_HANDLE) {
-			rtg.helpers.destroy_buffer(std::move(workspace.lines_vertices_src));
-		}
-		if (workspace.lines_vertices.handle != VK_NULL_HANDLE) {
-			rtg.helpers.destroy_buffer(std::move(workspace.lines_vertices));
+		for (Workspace::Recorder &recorder : workspace.recorders) {
+			if (recorder.command_pool != VK_NULL_HANDLE) {
+				vkDestroyCommandPool(rtg.device, recorder.command_pool, nullptr); // (also frees recorder.command_buffer)
+				recorder.command_pool = VK_NULL_HANDLE;
+				recorder.command_buffer = VK_NULL_HANDLE;
+			}
 		}
+		workspace.recorders.clear();
 
-		if (workspace.Camera_src.handle != VK_NULL_HANDLE)  {
-			rtg.helpers.destroy_buffer(std::move(workspace.Camera_src));
-		}
-		if (workspace.Camera.handle != VK_NULL_HANDLE) {
-			rtg.helpers.destroy_buffer(std::move(workspace.Camera));
+		for (VkQueryPool *pool : { &workspace.timestamps, &workspace.statistics }) {
+			if (*pool != VK_NULL_HANDLE) {
+				vkDestroyQueryPool(rtg.device, *pool, nullptr);
+				*pool = VK_NULL_HANDLE;
+			}
 		}
-		// Camera_descriptors freed when pool is destroyed
 
-		if (workspace.World_src.handle != VK_NULL_HANDLE)  {
-			rtg.helpers.destroy_buffer(std::move(workspace.World_src));
-		}
-		if (workspace.World.handle != VK_NULL_HANDLE) {
-			rtg.helpers.destroy_buffer(std::move(workspace.World));
+		if (workspace.frame_data.handle != VK_NULL_HANDLE) {
+			rtg.helpers.destroy_buffer(std::move(workspace.frame_data));
 		}
-		// World_descriptors freed when pool is destroyed
 
-		if (workspace.Transforms.handle != VK_NULL_HANDLE)  {
-			rtg.helpers.destroy_buffer(std::move(workspace.Transforms));
-		}
-		if (workspace.Transforms_src.handle != VK_NULL_HANDLE) {
-			rtg.helpers.destroy_buffer(std::move(workspace.Transforms_src));
+		for (Helpers::AllocatedBuffer *buffer : { &workspace.culled_transforms, &workspace.draw_commands, &workspace.draw_counts, &workspace.batch_visible, &workspace.cull_stats }) {
+			if (buffer->handle != VK_NULL_HANDLE) {
+				rtg.helpers.destroy_buffer(std::move(*buffer));
+			}
 		}
-		// Transforms_descriptors freed when pool is destroyed
 	}
 	workspaces.clear();
 
+	if (cull_batches.handle != VK_NULL_HANDLE) {
+		rtg.helpers.destroy_buffer(std::move(cull_batches));
+	}
+	if (cull_instance_batches.handle != VK_NULL_HANDLE) {
+		rtg.helpers.destroy_buffer(std::move(cull_instance_batches));
+	}
+
 	if (descriptor_pool) {
 		vkDestroyDescriptorPool(rtg.device, descriptor_pool, nullptr);
 		descriptor_pool = nullptr;
@@ -637,6 +803,8 @@ Tutorial::~Tutorial() {
 	background_pipeline.destroy(rtg);
 	lines_pipeline.destroy(rtg);
 	objects_pipeline.destroy(rtg);
+	cull_pipeline.destroy(rtg);
+	depth_pyramid_pipeline.destroy(rtg);
 
 	// refsol::Tutorial_destructor(rtg, &render_pass, &command_pool);
 	// destroy command pool:
@@ -655,7 +823,10 @@ Tutorial::~Tutorial() {
 void Tutorial::on_swapchain(RTG &rtg_, RTG::SwapchainEvent const &swapchain) {
 	//[re]create framebuffers:
 	// refsol::Tutorial_on_swapchain(rtg, swapchain, depth_format, render_pass, &swapchain_depth_image, &swapchain_depth_image_view, &swapchain_framebuffers);
-	// clean up existing framebuffers (and depth image):
+	// clean up existing framebuffers (and depth image, and the depth pyramid made from it):
+	if (depth_pyramid.handle != VK_NULL_HANDLE) {
+		destroy_depth_pyramid();
+	}
 	if (swapchain_depth_image.handle != VK_NULL_HANDLE) {
 		destroy_framebuffers();
 	}
@@ -665,7 +836,7 @@ void Tutorial::on_swapchain(RTG &rtg_, RTG::SwapchainEvent const &swapchain) {
 		swapchain.extent,
 		depth_format,
 		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | (culling_mode == CullingMode::HiZ ? VK_IMAGE_USAGE_SAMPLED_BIT : 0), // (sampled to build the depth pyramid)
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 		Helpers::Unmapped
 	);
@@ -709,6 +880,10 @@ void Tutorial::on_swapchain(RTG &rtg_, RTG::SwapchainEvent const &swapchain) {
 
 		VK( vkCreateFramebuffer(rtg.device, &create_info, nullptr, &swapchain_framebuffers[i]) );
 	}
+
+	if (culling_mode == CullingMode::HiZ) {
+		create_depth_pyramid();
+	}
 }
 
 void Tutorial::destroy_framebuffers() {
@@ -728,6 +903,303 @@ void Tutorial::destroy_framebuffers() {
 	rtg.helpers.destroy_image(std::move(swapchain_depth_image));
 }
 
+void Tutorial::create_depth_pyramid() {
+	assert(swapchain_depth_image_view != VK_NULL_HANDLE);
+
+	// level 0 is half the depth buffer; the image has the full mip chain below that (down to 1x1):
+	VkExtent2D extent{
+		.width = std::max(1u, swapchain_depth_image.extent.width / 2),
+		.height = std::max(1u, swapchain_depth_image.extent.height / 2),
+	};
+	uint32_t levels = 1;
+	while ((std::max(extent.width, extent.height) >> levels) != 0) ++levels;
+
+	depth_pyramid = rtg.helpers.create_image(
+		extent,
+		VK_FORMAT_R32_SFLOAT,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, // written a level at a time by depth_pyramid.comp, read by it and by cull.comp
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		Helpers::Unmapped,
+		levels
+	);
+	depth_pyramid_built = false;
+
+	{ // create image views (all levels, and each level by itself):
+		VkImageViewCreateInfo create_info{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+			.image = depth_pyramid.handle,
+			.viewType = VK_IMAGE_VIEW_TYPE_2D,
+			.format = depth_pyramid.format,
+			.subresourceRange{
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.baseMipLevel = 0,
+				.levelCount = levels,
+				.baseArrayLayer = 0,
+				.layerCount = 1
+			},
+		};
+		VK( vkCreateImageView(rtg.device, &create_info, nullptr, &depth_pyramid_view) );
+
+		depth_pyramid_level_views.assign(levels, VK_NULL_HANDLE);
+		for (uint32_t level = 0; level < levels; ++level) {
+			create_info.subresourceRange.baseMipLevel = level;
+			create_info.subresourceRange.levelCount = 1;
+			VK( vkCreateImageView(rtg.device, &create_info, nullptr, &depth_pyramid_level_views[level]) );
+		}
+	}
+
+	{ // create the descriptor pool (one reduce set per level, plus the set cull.comp reads the pyramid through):
+		std::array< VkDescriptorPoolSize, 2 > pool_sizes{
+			VkDescriptorPoolSize{
+				.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				.descriptorCount = levels + 1,
+			},
+			VkDescriptorPoolSize{
+				.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+				.descriptorCount = levels,
+			},
+		};
+
+		VkDescriptorPoolCreateInfo create_info{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+			.flags = 0,
+			.maxSets = levels + 1,
+			.poolSizeCount = uint32_t(pool_sizes.size()),
+			.pPoolSizes = pool_sizes.data(),
+		};
+
+		VK( vkCreateDescriptorPool(rtg.device, &create_info, nullptr, &depth_pyramid_descriptor_pool) );
+	}
+
+	{ // allocate and write the descriptor sets:
+		std::vector< VkDescriptorSetLayout > layouts(levels, depth_pyramid_pipeline.set0_Reduce);
+		layouts.emplace_back(cull_pipeline.set1_DepthPyramid);
+		std::vector< VkDescriptorSet > sets(layouts.size());
+
+		VkDescriptorSetAllocateInfo alloc_info{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+			.descriptorPool = depth_pyramid_descriptor_pool,
+			.descriptorSetCount = uint32_t(layouts.size()),
+			.pSetLayouts = layouts.data(),
+		};
+		VK( vkAllocateDescriptorSets(rtg.device, &alloc_info, sets.data()) );
+
+		depth_pyramid_descriptors = sets.back();
+		sets.pop_back();
+		depth_pyramid_reduce_descriptors = std::move(sets);
+
+		// level 0 reads the depth buffer (which render() transitions to read-only before building), the others read the level before them:
+		std::vector< VkDescriptorImageInfo > src_infos, dst_infos;
+		for (uint32_t level = 0; level < levels; ++level) {
+			src_infos.emplace_back(VkDescriptorImageInfo{
+				.sampler = depth_pyramid_sampler,
+				.imageView = (level == 0 ? swapchain_depth_image_view : depth_pyramid_level_views[level - 1]),
+				.imageLayout = (level == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL),
+			});
+			dst_infos.emplace_back(VkDescriptorImageInfo{
+				.sampler = VK_NULL_HANDLE,
+				.imageView = depth_pyramid_level_views[level],
+				.imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+			});
+		}
+		VkDescriptorImageInfo pyramid_info{
+			.sampler = depth_pyramid_sampler,
+			.imageView = depth_pyramid_view,
+			.imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+		};
+
+		std::vector< VkWriteDescriptorSet > writes;
+		for (uint32_t level = 0; level < levels; ++level) {
+			writes.emplace_back(VkWriteDescriptorSet{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.dstSet = depth_pyramid_reduce_descriptors[level],
+				.dstBinding = 0,
+				.dstArrayElement = 0,
+				.descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				.pImageInfo = &src_infos[level],
+			});
+			writes.emplace_back(VkWriteDescriptorSet{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.dstSet = depth_pyramid_reduce_descriptors[level],
+				.dstBinding = 1,
+				.dstArrayElement = 0,
+				.descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+				.pImageInfo = &dst_infos[level],
+			});
+		}
+		writes.emplace_back(VkWriteDescriptorSet{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = depth_pyramid_descriptors,
+			.dstBinding = 0,
+			.dstArrayElement = 0,
+			.descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.pImageInfo = &pyramid_info,
+		});
+
+		vkUpdateDescriptorSets(rtg.device, uint32_t(writes.size()), writes.data(), 0, nullptr);
+	}
+}
+
+void Tutorial::destroy_depth_pyramid() {
+	// (frees the descriptor sets too)
+	vkDestroyDescriptorPool(rtg.device, depth_pyramid_descriptor_pool, nullptr);
+	depth_pyramid_descriptor_pool = VK_NULL_HANDLE;
+	depth_pyramid_reduce_descriptors.clear();
+	depth_pyramid_descriptors = VK_NULL_HANDLE;
+
+	for (VkImageView &view : depth_pyramid_level_views) {
+		vkDestroyImageView(rtg.device, view, nullptr);
+		view = VK_NULL_HANDLE;
+	}
+	depth_pyramid_level_views.clear();
+
+	vkDestroyImageView(rtg.device, depth_pyramid_view, nullptr);
+	depth_pyramid_view = VK_NULL_HANDLE;
+
+	rtg.helpers.destroy_image(std::move(depth_pyramid));
+	depth_pyramid_built = false;
+}
+
+void Tutorial::reserve_frame_data(Workspace &workspace, VkDeviceSize bytes) {
+	if (workspace.frame_data.handle != VK_NULL_HANDLE && workspace.frame_data.size >= bytes) return;
+
+	// at least double, so a slowly growing scene re-allocates O(log n) times:
+	VkDeviceSize new_bytes = std::max(bytes, 2 * workspace.frame_data.size);
+	new_bytes = (new_bytes + 4095) / 4096 * 4096;
+
+	// safe to throw the old buffer away: the workspace's previous frame has finished by the time it is used again
+	if (workspace.frame_data.handle != VK_NULL_HANDLE) {
+		rtg.helpers.destroy_buffer(std::move(workspace.frame_data));
+	}
+
+	workspace.frame_data = rtg.helpers.create_buffer(
+		new_bytes,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, // lines vertices; Camera, World; Transforms
+		frame_data_properties,
+		Helpers::Mapped // written by the CPU every frame
+	);
+
+	write_frame_descriptors(workspace, std::max< VkDeviceSize >(workspace.Transforms_range, sizeof(ObjectsPipeline::Transform)));
+
+	if (rtg.configuration.debug) {
+		std::cout << "Re-allocated frame data to " << new_bytes << " bytes." << std::endl;
+	}
+}
+
+void Tutorial::write_frame_descriptors(Workspace &workspace, VkDeviceSize transforms_bytes) {
+	assert(workspace.frame_data.handle != VK_NULL_HANDLE);
+
+	// offsets are all 0 here; the real offsets are passed to vkCmdBindDescriptorSets every frame:
+	VkDescriptorBufferInfo Camera_info{
+		.buffer = workspace.frame_data.handle,
+		.offset = 0,
+		.range = sizeof(LinesPipeline::Camera),
+	};
+
+	VkDescriptorBufferInfo World_info{
+		.buffer = workspace.frame_data.handle,
+		.offset = 0,
+		.range = sizeof(ObjectsPipeline::World),
+	};
+
+	VkDescriptorBufferInfo Transforms_info{
+		.buffer = workspace.frame_data.handle,
+		.offset = 0,
+		.range = transforms_bytes,
+	};
+
+	std::array< VkWriteDescriptorSet, 4 > writes{
+		VkWriteDescriptorSet{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = workspace.Camera_descriptors, // Which descriptor set to update
+			.dstBinding = 0, // Which binding slot (matches shader)
+			.dstArrayElement = 0,
+			.descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+			.pBufferInfo = &Camera_info, // The actual buffer to bind
+		},
+		VkWriteDescriptorSet{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = workspace.World_descriptors,
+			.dstBinding = 0,
+			.dstArrayElement = 0,
+			.descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+			.pBufferInfo = &World_info,
+		},
+		VkWriteDescriptorSet{ // objects also read CLIP_FROM_WORLD from the same Camera data the lines use
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = workspace.World_descriptors,
+			.dstBinding = 1,
+			.dstArrayElement = 0,
+			.descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+			.pBufferInfo = &Camera_info,
+		},
+		VkWriteDescriptorSet{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = workspace.Transforms_descriptors,
+			.dstBinding = 0,
+			.dstArrayElement = 0,
+			.descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+			.pBufferInfo = &Transforms_info,
+		},
+	};
+
+	vkUpdateDescriptorSets(
+		rtg.device, //device
+		uint32_t(writes.size()), //descriptorWriteCount
+		writes.data(), //pDescriptorWrites
+		0, //descriptorCopyCount
+		nullptr //pDescriptorCopies
+	);
+
+	if (workspace.Cull_descriptors != VK_NULL_HANDLE) { // the GPU culling inputs that live in frame_data:
+		VkDescriptorBufferInfo Cull_info{
+			.buffer = workspace.frame_data.handle,
+			.offset = 0,
+			.range = sizeof(CullPipeline::Cull),
+		};
+
+		std::array< VkWriteDescriptorSet, 2 > cull_writes{
+			VkWriteDescriptorSet{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.dstSet = workspace.Cull_descriptors,
+				.dstBinding = 0,
+				.dstArrayElement = 0,
+				.descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+				.pBufferInfo = &Cull_info,
+			},
+			VkWriteDescriptorSet{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.dstSet = workspace.Cull_descriptors,
+				.dstBinding = 1,
+				.dstArrayElement = 0,
+				.descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+				.pBufferInfo = &Transforms_info,
+			},
+		};
+
+		vkUpdateDescriptorSets(rtg.device, uint32_t(cull_writes.size()), cull_writes.data(), 0, nullptr);
+	}
+
+	workspace.Transforms_range = transforms_bytes;
+}
+
+VkDeviceSize Tutorial::frame_alloc(Workspace &workspace, VkDeviceSize bytes, VkDeviceSize alignment) {
+	VkDeviceSize offset = (workspace.frame_data_head + alignment - 1) / alignment * alignment;
+	assert(offset + bytes <= workspace.frame_data.size && "reserve_frame_data() should have made room");
+	workspace.frame_data_head = offset + bytes;
+	return offset;
+}
+
 
 // Credit: adapted from More (Robust) Frustum Culling by Bruno Opsenica
 static bool SAT_visibility_test(const Tutorial::CullingFrustum& frustum, const mat4& VIEW_FROM_LOCAL, const S72::vec3& bmin, const S72::vec3& bmax)
@@ -838,6 +1310,124 @@ static bool SAT_visibility_test(const Tutorial::CullingFrustum& frustum, const m
 	return true;
 }
 
+// true if the box is entirely inside the frustum (conservative companion to SAT_visibility_test, used to accept whole BVH subtrees):
+static bool inside_frustum_test(const Tutorial::CullingFrustum& frustum, const mat4& VIEW_FROM_LOCAL, const vec3& bmin, const vec3& bmax) {
+	// the frustum is convex, so the box is inside iff all 8 of its corners are:
+	for (uint32_t c = 0; c < 8; ++c) {
+		vec3 corner = VIEW_FROM_LOCAL * vec3{ (c & 1) ? bmax[0] : bmin[0], (c & 2) ? bmax[1] : bmin[1], (c & 4) ? bmax[2] : bmin[2] };
+		float depth = -corner[2]; // camera looks down -z
+		if (corner[2] > frustum.near_plane || corner[2] < frustum.far_plane) return false;
+		if (std::abs(corner[0]) > depth * frustum.near_right / -frustum.near_plane) return false;
+		if (std::abs(corner[1]) > depth * frustum.near_top / -frustum.near_plane) return false;
+	}
+	return true;
+}
+
+// world-space box around a local-space box (Arvo's method: transform the center, and grow the extents by |rotation/scale|):
+static BVH::AABB world_bounds(mat4 const &WORLD_FROM_LOCAL, S72::vec3 const &bmin, S72::vec3 const &bmax) {
+	vec3 center = WORLD_FROM_LOCAL * vec3{ 0.5f * (bmin.x + bmax.x), 0.5f * (bmin.y + bmax.y), 0.5f * (bmin.z + bmax.z) };
+	vec3 half{ 0.5f * (bmax.x - bmin.x), 0.5f * (bmax.y - bmin.y), 0.5f * (bmax.z - bmin.z) };
+
+	BVH::AABB box;
+	for (uint32_t r = 0; r < 3; ++r) {
+		float extent = 0.0f;
+		for (uint32_t c = 0; c < 3; ++c) {
+			extent += std::abs(WORLD_FROM_LOCAL[c * 4 + r]) * half[c];
+		}
+		box.min[r] = center[r] - extent;
+		box.max[r] = center[r] + extent;
+	}
+	return box;
+}
+
+uint32_t Tutorial::select_lod(ObjectInstance const &inst) const {
+	S72::Mesh const &mesh = *inst.mesh;
+	if (mesh.lods.size() < 2) return 0;
+
+	// bounding sphere of the mesh's box, in camera space:
+	S72::vec3 const &bmin = mesh.bbox_min;
+	S72::vec3 const &bmax = mesh.bbox_max;
+	mat4 VIEW_FROM_LOCAL = CAMERA_FROM_WORLD * inst.transform.WORLD_FROM_LOCAL;
+	vec3 center = VIEW_FROM_LOCAL * vec3{ 0.5f * (bmin.x + bmax.x), 0.5f * (bmin.y + bmax.y), 0.5f * (bmin.z + bmax.z) };
+	float scale = 0.0f; // largest axis scale, so errors (in local units) are never underestimated
+	for (uint32_t c = 0; c < 3; ++c) {
+		vec3 axis{ VIEW_FROM_LOCAL[c * 4 + 0], VIEW_FROM_LOCAL[c * 4 + 1], VIEW_FROM_LOCAL[c * 4 + 2] };
+		scale = std::max(scale, std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]));
+	}
+	vec3 size{ bmax.x - bmin.x, bmax.y - bmin.y, bmax.z - bmin.z };
+	float radius = 0.5f * scale * std::sqrt(size[0] * size[0] + size[1] * size[1] + size[2] * size[2]);
+	float distance = std::sqrt(center[0] * center[0] + center[1] * center[1] + center[2] * center[2]) - radius;
+	if (distance <= -frustum.near_plane) return 0; // (the camera is in or right next to it)
+
+	// a length at this distance covers this many pixels (the near plane's top edge is at the top of the screen):
+	float pixels_per_unit = 0.5f * float(rtg.swapchain_extent.height) * (-frustum.near_plane / frustum.near_top) / distance;
+	float tolerance = std::exp2(rtg.configuration.lod_bias);
+
+	uint32_t lod = 0;
+	while (lod + 1 < mesh.lods.size() && mesh.lods[lod + 1].error * scale * pixels_per_unit <= tolerance) {
+		++lod;
+	}
+	return lod;
+}
+
+void Tutorial::update_instance_bvh() {
+	if (object_instances.empty() || moved_instances.empty()) return;
+
+	if (instance_bvh.nodes.empty()) { // first update: every instance has just been placed
+		std::vector< BVH::AABB > bounds(object_instances.size());
+		for (uint32_t i = 0; i < uint32_t(object_instances.size()); ++i) {
+			ObjectInstance const &inst = object_instances[i];
+			bounds[i] = world_bounds(inst.transform.WORLD_FROM_LOCAL, inst.mesh->bbox_min, inst.mesh->bbox_max);
+		}
+		instance_bvh.build(bounds);
+	} else {
+		for (uint32_t i : moved_instances) {
+			ObjectInstance const &inst = object_instances[i];
+			instance_bvh.item_bounds[i] = world_bounds(inst.transform.WORLD_FROM_LOCAL, inst.mesh->bbox_min, inst.mesh->bbox_max);
+		}
+		instance_bvh.refit(moved_instances);
+	}
+	moved_instances.clear();
+}
+
+void Tutorial::read_gpu_profile(Workspace &workspace) {
+	// the workspace's fence has signalled, so these are ready (if they somehow aren't, the frame is just skipped rather than waited for):
+	std::array< uint64_t, GPUPhaseCount + 1 > ticks;
+	if (vkGetQueryPoolResults(rtg.device, workspace.timestamps, 0, uint32_t(ticks.size()), sizeof(ticks), ticks.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) return;
+	std::array< uint64_t, 3 > counts{ 0, 0, 0 }; // vertex invocations, clipping primitives, fragment invocations
+	if (pipeline_statistics) {
+		if (vkGetQueryPoolResults(rtg.device, workspace.statistics, 0, 1, sizeof(counts), counts.data(), sizeof(counts), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) return;
+	}
+
+	auto ms_between = [&](uint32_t a, uint32_t b) {
+		return double((ticks[b] - ticks[a]) & timestamp_mask) * timestamp_period * 1e-6;
+	};
+
+	gpu_profile.frames += 1;
+	for (uint32_t p = 0; p < GPUPhaseCount; ++p) {
+		gpu_profile.phase_ms[p] += ms_between(p, p + 1);
+	}
+	gpu_profile.total_ms += ms_between(0, GPUPhaseCount);
+	if (rtg.configuration.benchmark != "") rtg.benchmark.gpu_ms.emplace_back(ms_between(0, GPUPhaseCount));
+	gpu_profile.vertex_invocations += counts[0];
+	gpu_profile.clipping_primitives += counts[1];
+	gpu_profile.fragment_invocations += counts[2];
+
+	if (gpu_profile_csv.is_open()) {
+		gpu_profile_csv << gpu_profile_frames;
+		for (uint32_t p = 0; p < GPUPhaseCount; ++p) {
+			gpu_profile_csv << "," << ms_between(p, p + 1);
+		}
+		gpu_profile_csv << "," << ms_between(0, GPUPhaseCount);
+		if (pipeline_statistics) {
+			gpu_profile_csv << "," << counts[0] << "," << counts[1] << "," << counts[2] << "\n";
+		} else {
+			gpu_profile_csv << ",,,\n";
+		}
+	}
+	gpu_profile_frames += 1;
+}
+
 void Tutorial::render(RTG &rtg_, RTG::RenderParams const &render_params) {
 	//assert that parameters are valid:
 	assert(&rtg == &rtg_);
@@ -860,192 +1450,320 @@ void Tutorial::render(RTG &rtg_, RTG::RenderParams const &render_params) {
 		VK( vkBeginCommandBuffer(workspace.command_buffer, &begin_info));
 	}
 
-	if (!lines_vertices.empty()) { // upload lines vertices
-		//[re-]allocate lines buffers if needed:
-		size_t needed_bytes = lines_vertices.size() * sizeof(lines_vertices[0]);
-		if (workspace.lines_vertices_src.handle == VK_NULL_HANDLE || workspace.lines_vertices_src.size < needed_bytes) { // if the source buffer is missing or too small
-			//round to next multiple of 4k to avoid re-allocating continuously if vertex count grows slowly
-			int i1 = workspace.lines_vertices_src.handle == VK_NULL_HANDLE;
-			int i2 = workspace.lines_vertices_src.size < needed_bytes;
-			std::cout << "workspace index: " << render_params.workspace_index << ", checks: " << i1 << ", " << i2 << std::endl;
-			size_t new_bytes = ((needed_bytes + 4096) / 4096) * 4096; 
-			if (workspace.lines_vertices_src.handle) {
-				rtg.helpers.destroy_buffer(std::move(workspace.lines_vertices_src));
+	// GPU profiling: timestamps between phases of the frame (BOTTOM_OF_PIPE = once everything before them is done):
+	auto write_timestamp = [&](VkCommandBuffer command_buffer, uint32_t index) {
+		if (!gpu_profiling) return;
+		vkCmdWriteTimestamp(command_buffer, (index == 0 ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT), workspace.timestamps, index);
+	};
+	if (gpu_profiling) {
+		if (workspace.profile_pending) { // this workspace's last frame is done, so its queries can be read:
+			read_gpu_profile(workspace);
+			workspace.profile_pending = false;
+		}
+		if (gpu_profile.frames != 0 && time - gpu_profile_report_time >= 1.0f) { // report about once a second:
+			std::cout << "GPU time: per frame,";
+			for (uint32_t p = 0; p < GPUPhaseCount; ++p) {
+				std::cout << " " << GPUPhaseNames[p] << " " << gpu_profile.phase_ms[p] / gpu_profile.frames << "ms,";
 			}
-			if (workspace.lines_vertices.handle) {
-				rtg.helpers.destroy_buffer(std::move(workspace.lines_vertices));
+			std::cout << " total " << gpu_profile.total_ms / gpu_profile.frames << "ms";
+			if (pipeline_statistics) {
+				std::cout << "; " << gpu_profile.vertex_invocations / gpu_profile.frames << " vertex invocations, "
+				          << gpu_profile.clipping_primitives / gpu_profile.frames << " primitives clipped, "
+				          << gpu_profile.fragment_invocations / gpu_profile.frames << " fragment invocations";
 			}
+			std::cout << " (" << gpu_profile.frames << " frames)." << std::endl;
+			gpu_profile = GPUProfile();
+			gpu_profile_report_time = time;
+		}
 
-			workspace.lines_vertices_src = rtg.helpers.create_buffer(
-				new_bytes, 
-				VK_BUFFER_USAGE_TRANSFER_SRC_BIT, // /going to have GPU copy from this memory
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, // host-visible memory (the memory can be mapped from the CPU side), coherent (no special sync needed) (the memory doesn't require special flush operations to make host writes available)
-				Helpers::Mapped // get a pointer to the memory
-			);
-			workspace.lines_vertices = rtg.helpers.create_buffer(
-				new_bytes,
-				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, // going to use as vertex buffer, also going to have GPU into this memory i.e. the target if memory copy
-				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, // GPU-local memory
-				Helpers::Unmapped // don't get a pointer to memory
-			);
+		// (queries have to be reset before they are written again; this happens outside the render pass, so all of them are reset here)
+		vkCmdResetQueryPool(workspace.command_buffer, workspace.timestamps, 0, GPUPhaseCount + 1);
+		if (pipeline_statistics) vkCmdResetQueryPool(workspace.command_buffer, workspace.statistics, 0, 1);
+		write_timestamp(workspace.command_buffer, GPUPhaseCull);
+	}
 
-			std::cout << "Re-allocated lines buffers to " << new_bytes << " bytes." << std::endl;
+	// per-frame data is written straight into workspace.frame_data, which the GPU reads in place (so no copies or barriers needed;
+	// host-coherent writes are visible to the GPU once the command buffer is submitted):
+	size_t lines_bytes = lines_vertices.size() * sizeof(lines_vertices[0]);
+	size_t transforms_bytes = object_instances.size() * sizeof(ObjectsPipeline::Transform);
+	// the Transforms descriptor's range is fixed when it is written, so the frame always reserves that much (even if fewer instances are live):
+	VkDeviceSize transforms_range = std::max< VkDeviceSize >(transforms_bytes, workspace.Transforms_range);
+	{ // make room for everything this frame writes (including worst-case alignment padding):
+		VkDeviceSize padding = 16 + 3 * uniform_offset_alignment + storage_offset_alignment;
+		reserve_frame_data(workspace, lines_bytes + sizeof(LinesPipeline::Camera) + sizeof(ObjectsPipeline::World) + sizeof(CullPipeline::Cull) + transforms_range + padding);
+		if (transforms_range > workspace.Transforms_range) {
+			write_frame_descriptors(workspace, transforms_range);
 		}
+		workspace.frame_data_head = 0;
+	}
+	char *frame_data = reinterpret_cast< char * >(workspace.frame_data.allocation.data());
 
-		assert(workspace.lines_vertices_src.size == workspace.lines_vertices.size);
-		assert(workspace.lines_vertices_src.size >= needed_bytes);
-
-		// host-side copy into lines_vertices_src
-		// use the CPU to copy from the lines_vertices vector to the workspace.lines_vertices_src staging buffer
-		assert(workspace.lines_vertices_src.allocation.mapped);
-		std::memcpy(workspace.lines_vertices_src.allocation.data(), lines_vertices.data(), needed_bytes);
-
-		// device-side copy from lines_vertices_src -> lines_vertices:
-		// record a command to have the GPU copy the data from the staging buffer to the workspace.lines_vertices buffer.
-		VkBufferCopy copy_region{
-			.srcOffset = 0,
-			.dstOffset = 0,
-			.size = needed_bytes,
-		};
-		vkCmdCopyBuffer(workspace.command_buffer, workspace.lines_vertices_src.handle, workspace.lines_vertices.handle, 1, &copy_region);
+	VkDeviceSize lines_offset = 0;
+	if (!lines_vertices.empty()) { // write lines vertices:
+		lines_offset = frame_alloc(workspace, lines_bytes, 16);
+		std::memcpy(frame_data + lines_offset, lines_vertices.data(), lines_bytes);
 	}
 
-	{ // upload camera info:
+	VkDeviceSize Camera_offset = 0;
+	{ // write camera info:
 		// SceneCamera = storage format kept in CPU; LinesPipeline::Camera = the GPU/shader format that gets uploaded
 		// because The shader is written to read CLIP_FROM_WORLD at offset 0 //TODO: do we need the shader to read more?
 		LinesPipeline::Camera camera{
 			.CLIP_FROM_WORLD = CLIP_FROM_WORLD};
 
-		assert(workspace.Camera_src.size == sizeof(camera));
-
-		// host-side copy into Camera_src:
-		memcpy(workspace.Camera_src.allocation.data(), &camera, sizeof(camera));
-
-		// add device-side copy from Camera_src -> Camera:
-		assert(workspace.Camera_src.size == workspace.Camera.size);
-		VkBufferCopy copy_region{
-			.srcOffset = 0,
-			.dstOffset = 0,
-			.size = workspace.Camera_src.size,
-		};
-		vkCmdCopyBuffer(workspace.command_buffer, workspace.Camera_src.handle, workspace.Camera.handle, 1, &copy_region);
+		Camera_offset = frame_alloc(workspace, sizeof(camera), uniform_offset_alignment);
+		std::memcpy(frame_data + Camera_offset, &camera, sizeof(camera));
 	}
 
-	{ // upload world info:
-		assert(workspace.World_src.size == sizeof(world)); // don't think this is correct //??
-
-		// host-side copy into World_src:
-		memcpy(workspace.World_src.allocation.data(), &world, sizeof(world));
-
-		// add device-side copy from World_src -> World:
-		assert(workspace.World_src.size == workspace.World.size);
-		VkBufferCopy copy_region{
-			.srcOffset = 0,
-			.dstOffset = 0,
-			.size = workspace.World_src.size,
-		};
-		vkCmdCopyBuffer(workspace.command_buffer, workspace.World_src.handle, workspace.World.handle, 1, &copy_region);
+	VkDeviceSize World_offset = 0;
+	{ // write world info:
+		World_offset = frame_alloc(workspace, sizeof(world), uniform_offset_alignment);
+		std::memcpy(frame_data + World_offset, &world, sizeof(world));
 	}
 
+	VkDeviceSize Transforms_offset = 0;
 	// object_instances.clear(); // used for CPU bottleneck testing;
-	if (!object_instances.empty()) { // upload object transforms:
-		//[re-]allocate object buffers if needed:
-		size_t needed_bytes = object_instances.size() * sizeof(object_instances[0]);
-		if (workspace.Transforms_src.handle == VK_NULL_HANDLE || workspace.Transforms_src.size < needed_bytes) { // if the source buffer is missing or too small
-			//round to next multiple of 4k to avoid re-allocating continuously if vertex count grows slowly
-			size_t new_bytes = ((needed_bytes + 4096) / 4096) * 4096; 
-			if (workspace.Transforms_src.handle) {
-				rtg.helpers.destroy_buffer(std::move(workspace.Transforms_src));
-			}
-			if (workspace.Transforms.handle) {
-				rtg.helpers.destroy_buffer(std::move(workspace.Transforms));
-			}
-
-			workspace.Transforms_src = rtg.helpers.create_buffer(
-				new_bytes, 
-				VK_BUFFER_USAGE_TRANSFER_SRC_BIT, // /going to have GPU copy from this memory
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, // host-visible memory (the memory can be mapped from the CPU side), coherent (no special sync needed) (the memory doesn't require special flush operations to make host writes available)
-				Helpers::Mapped // get a pointer to the memory
-			);
-			workspace.Transforms = rtg.helpers.create_buffer(
-				new_bytes,
-				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, // going to use as vertex buffer, also going to have GPU into this memory i.e. the target if memory copy
-				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, // GPU-local memory
-				Helpers::Unmapped // don't get a pointer to memory
+	if (!object_instances.empty()) { // cull, batch, and write object transforms:
+		// visible instances are written in instance_draw_order, so every (mesh, texture) run is contiguous and becomes one DrawBatch:
+		Transforms_offset = frame_alloc(workspace, workspace.Transforms_range, storage_offset_alignment);
+		ObjectsPipeline::Transform *out = reinterpret_cast< ObjectsPipeline::Transform* >(frame_data + Transforms_offset); // struct aliasing violation, but it doesn't matter
+		uint32_t written = 0;
+
+		if (culling_mode == CullingMode::BVH) { // mark visible instances, rejecting (or accepting) whole subtrees where possible:
+			instance_visible.assign(object_instances.size(), 0);
+			uint32_t instances_tested = 0;
+			uint32_t nodes_tested = instance_bvh.traverse(
+				[&](BVH::AABB const &box) {
+					S72::vec3 bmin{ box.min[0], box.min[1], box.min[2] };
+					S72::vec3 bmax{ box.max[0], box.max[1], box.max[2] };
+					if (!SAT_visibility_test(frustum, CAMERA_FROM_WORLD, bmin, bmax)) return BVH::Outside;
+					if (inside_frustum_test(frustum, CAMERA_FROM_WORLD, box.min, box.max)) return BVH::Inside;
+					return BVH::Intersecting;
+				},
+				[&](uint32_t i, bool inside) {
+					if (!inside) { // leaf straddles the frustum; test the instance's own (tighter) box:
+						ObjectInstance const &inst = object_instances[i];
+						instances_tested += 1;
+						if (!SAT_visibility_test(frustum, CAMERA_FROM_WORLD * inst.transform.WORLD_FROM_LOCAL, inst.mesh->bbox_min, inst.mesh->bbox_max)) return;
+					}
+					instance_visible[i] = 1;
+				}
 			);
 
-			// update the descriptor set:
-			// Tells Vulkan "the Transforms shader binding should point to this specific buffer."
-			// It connects your GPU buffer to the shader's descriptor. 
-			// Describe the buffer:
-			VkDescriptorBufferInfo Transforms_info{ 
-				.buffer = workspace.Transforms.handle, // which buffer
-				.offset = 0, // start at beginning
-				.range = workspace.Transforms.size, // use whole buffer
-			};
+			bvh_stats.frames += 1;
+			bvh_stats.nodes_tested += nodes_tested;
+			bvh_stats.instances_tested += instances_tested;
+			for (uint8_t v : instance_visible) bvh_stats.instances_visible += v;
+			if (time - bvh_report_time >= 1.0f) { // report about once a second:
+				std::cout << "BVH culling: per frame, " << bvh_stats.nodes_tested / bvh_stats.frames << " of " << instance_bvh.nodes.size() << " nodes and "
+				          << bvh_stats.instances_tested / bvh_stats.frames << " of " << object_instances.size() << " instances tested, "
+				          << bvh_stats.instances_visible / bvh_stats.frames << " visible." << std::endl;
+				bvh_stats = BVHStats();
+				bvh_report_time = time;
+			}
+		}
 
-			// describe the write operation:
-			std::array< VkWriteDescriptorSet, 1 > writes{
-				VkWriteDescriptorSet{
-					.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,  
-					.dstSet = workspace.Transforms_descriptors, // which descriptor set to update  
-					.dstBinding = 0, // binding 0 in that set
-					.dstArrayElement = 0, // first element (if it were an array)
-					.descriptorCount = 1,  // updating 1 descriptor
-					.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-					.pBufferInfo = &Transforms_info, 
-				},
+		draw_batches.clear();
+		if (gpu_culling()) { // every transform, in draw order; cull.comp decides what gets drawn (below)
+			for (uint32_t i : instance_draw_order) {
+				out[written] = object_instances[i].transform;
+				++written;
+			}
+		} else {
+			// visible instances of each mesh are sorted into lod_instances by level, then written out as one batch per level
+			// once the mesh's run of instance_draw_order ends:
+			S72::Mesh *run_mesh = nullptr;
+			auto finish_run = [&]() {
+				for (uint32_t lod = 0; lod < lod_instances.size(); ++lod) {
+					std::vector< uint32_t > &run = lod_instances[lod];
+					if (run.empty()) continue;
+					draw_batches.emplace_back(DrawBatch{
+						.mesh = run_mesh,
+						.lod = lod,
+						.first_instance = written,
+						.instance_count = uint32_t(run.size()),
+					});
+					for (uint32_t r : run) {
+						out[written] = object_instances[r].transform;
+						++written;
+					}
+					if (!run_mesh->lods.empty()) {
+						lod_stats.instances[lod] += run.size();
+						lod_stats.triangles[lod] += run.size() * (run_mesh->lods[lod].index_count / 3);
+					}
+					run.clear();
+				}
 			};
 
-			// execute the update (update includes all operations above, like the object_instances, etc.)
-			vkUpdateDescriptorSets( 
-				rtg.device,
-				uint32_t(writes.size()), writes.data(), // descriptorWrites count, data
-				0, nullptr // descriptorCopies count, data
-			);
+			for (uint32_t i : instance_draw_order) {
+				ObjectInstance const &inst = object_instances[i];
 
-			std::cout << "Re-allocated object buffers to " << new_bytes << " bytes." << std::endl;
-		}
+				if (culling_mode == CullingMode::BVH && !instance_visible[i]) {
+					continue; // rejected above
+				}
 
-		assert(workspace.Transforms.size == workspace.Transforms.size);
-		assert(workspace.Transforms.size >= needed_bytes);
+				if (culling_mode == CullingMode::Frustum){
+					// Get local-space bounding box corners
+					S72::vec3 const &bmin = inst.mesh->bbox_min;
+					S72::vec3 const &bmax = inst.mesh->bbox_max;
+
+					/* takes in:
+					1. the view matrix of the camera; Transforms points from world space into camera (view) space.
+					2. the model/world transform of object; Converts points from model space into world space.
+					*/
+					mat4 VIEW_FROM_LOCAL = CAMERA_FROM_WORLD * inst.transform.WORLD_FROM_LOCAL;
+
+					if (!SAT_visibility_test(frustum, VIEW_FROM_LOCAL, bmin, bmax)) {
+						continue; // skip this instance if it's not visible
+					}
+				}
 
-		{ //copy transforms into Transforms_src: use the CPU to copy from the transforms to the workspace.Transforms_src staging buffer
-			assert(workspace.Transforms_src.allocation.mapped);
-			ObjectsPipeline::Transform *out = reinterpret_cast< ObjectsPipeline::Transform* >(workspace.Transforms_src.allocation.data()); // struct aliasing violation, but it doesn't matter
-			for (ObjectInstance const &inst : object_instances) {
-				*out = inst.transform;
-				++out;
+				if (run_mesh != inst.mesh) {
+					if (run_mesh) finish_run();
+					run_mesh = inst.mesh;
+				}
+				lod_instances[select_lod(inst)].emplace_back(i);
 			}
+			if (run_mesh) finish_run();
+
+			lod_stats.frames += 1;
 		}
-		// device-side copy from lines_vertices_src -> lines_vertices:
-		// record a command to have the GPU copy the data from the staging buffer to the workspace.lines_vertices buffer.
-		VkBufferCopy copy_region{
-			.srcOffset = 0,
-			.dstOffset = 0,
-			.size = needed_bytes,
-		};
-		vkCmdCopyBuffer(workspace.command_buffer, workspace.Transforms_src.handle, workspace.Transforms.handle, 1, &copy_region);
 	}
 
-	{ // memory barrier to make sure copies compelte before rendering happens
-		VkMemoryBarrier memory_barrier{
-			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
-			.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT,
-			.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT,
+	if (gpu_culling() && cull_batch_count != 0) { // cull on the GPU (fills draw_commands + draw_counts for the indirect draws below):
+		if (workspace.cull_stats_pending) { // this workspace's last frame is done, so its counts can be read:
+			CullPipeline::Stats const &stats = *reinterpret_cast< CullPipeline::Stats const * >(workspace.cull_stats.allocation.data());
+			gpu_cull_stats.frames += 1;
+			gpu_cull_stats.frustum_culled += stats.frustum_culled;
+			gpu_cull_stats.occlusion_culled += stats.occlusion_culled;
+			gpu_cull_stats.visible += stats.visible;
+			lod_stats.frames += 1;
+			for (uint32_t lod = 0; lod < S72::Mesh::MaxLODLevels; ++lod) {
+				lod_stats.instances[lod] += stats.lod_instances[lod];
+				lod_stats.triangles[lod] += stats.lod_triangles[lod];
+			}
+			workspace.cull_stats_pending = false;
+		}
+		if (gpu_cull_stats.frames != 0 && time - gpu_cull_report_time >= 1.0f) { // report about once a second:
+			std::cout << "GPU culling: per frame, " << gpu_cull_stats.frustum_culled / gpu_cull_stats.frames << " outside the frustum, "
+			          << gpu_cull_stats.occlusion_culled / gpu_cull_stats.frames << " occluded, "
+			          << gpu_cull_stats.visible / gpu_cull_stats.frames << " of " << object_instances.size() << " instances visible." << std::endl;
+			gpu_cull_stats = GPUCullStats();
+			gpu_cull_report_time = time;
+		}
+
+		// occlusion tests need last frame's depth pyramid, and they only make sense from the camera that rendered it
+		// (the debug camera draws what the culling camera would see, so it doesn't get occlusion culling):
+		bool occlusion = (culling_mode == CullingMode::HiZ && depth_pyramid_built && camera_mode != CameraMode::Debug);
+
+		VkDeviceSize Cull_offset = frame_alloc(workspace, sizeof(CullPipeline::Cull), uniform_offset_alignment);
+		CullPipeline::Cull cull{
+			.CAMERA_FROM_WORLD = CAMERA_FROM_WORLD,
+			.near_right = frustum.near_right,
+			.near_top = frustum.near_top,
+			.near_plane = frustum.near_plane,
+			.far_plane = frustum.far_plane,
+			.OCCLUSION_CLIP_FROM_WORLD = depth_pyramid_CLIP_FROM_WORLD,
+			.occlusion_viewport = { depth_pyramid_viewport[0], depth_pyramid_viewport[1], depth_pyramid_viewport[2], depth_pyramid_viewport[3] },
+			.occlusion = (occlusion ? 1u : 0u),
+			.lod_pixels = 0.5f * float(rtg.swapchain_extent.height) * (-frustum.near_plane / frustum.near_top), // (as in select_lod)
+			.lod_tolerance = std::exp2(rtg.configuration.lod_bias),
+			.padding_ = 0,
 		};
+		std::memcpy(frame_data + Cull_offset, &cull, sizeof(cull));
+
+		// the shader appends with atomics, so counters start at zero:
+		vkCmdFillBuffer(workspace.command_buffer, workspace.draw_counts.handle, 0, VK_WHOLE_SIZE, 0);
+		vkCmdFillBuffer(workspace.command_buffer, workspace.batch_visible.handle, 0, VK_WHOLE_SIZE, 0);
+		vkCmdFillBuffer(workspace.command_buffer, workspace.cull_stats.handle, 0, VK_WHOLE_SIZE, 0);
+		{ // clears finish before the shader starts counting (and the depth pyramid built at the end of last frame is visible):
+			VkMemoryBarrier memory_barrier{
+				.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+				.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+				.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+			};
+			vkCmdPipelineBarrier(workspace.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+		}
 
-		vkCmdPipelineBarrier(
-			workspace.command_buffer,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,		// srcStageMask; ensures all transfer operations (like buffer copies) complete
-			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, // dstStageMask; wait for all transfer ops before vertex input reads the data
-			0,									// dependencyFlags,
-			1, &memory_barrier,					// memoryBarriers (count, data)
-			0, nullptr,							// bufferMemoryBarriers (count, data)
-			0, nullptr							// imageMemoryBarriers (count, data)
-		);
+		vkCmdBindPipeline(workspace.command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, cull_pipeline.handle);
+		{ // bind Cull descriptor set:
+			std::array< uint32_t, 2 > dynamic_offsets{
+				uint32_t(Cull_offset), // binding 0: Cull
+				uint32_t(Transforms_offset), // binding 1: Transforms
+			};
+			vkCmdBindDescriptorSets(
+				workspace.command_buffer,
+				VK_PIPELINE_BIND_POINT_COMPUTE,
+				cull_pipeline.layout,
+				0, 1, &workspace.Cull_descriptors,
+				uint32_t(dynamic_offsets.size()), dynamic_offsets.data()
+			);
+		}
+		if (culling_mode == CullingMode::HiZ) { // bind the depth pyramid (even when cull.occlusion is off, the shader still has the binding):
+			vkCmdBindDescriptorSets(workspace.command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, cull_pipeline.layout, 1, 1, &depth_pyramid_descriptors, 0, nullptr);
+		}
+
+		{ // pass 0: cull instances
+			CullPipeline::Push push{
+				.pass = 0,
+				.count = uint32_t(object_instances.size()),
+			};
+			vkCmdPushConstants(workspace.command_buffer, cull_pipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+			vkCmdDispatch(workspace.command_buffer, (push.count + CullPipeline::GroupSize - 1) / CullPipeline::GroupSize, 1, 1);
+		}
+		{ // survivor counts are final before pass 1 reads them:
+			VkMemoryBarrier memory_barrier{
+				.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+				.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+				.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+			};
+			vkCmdPipelineBarrier(workspace.command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+		}
+		{ // pass 1: write draw commands
+			CullPipeline::Push push{
+				.pass = 1,
+				.count = cull_batch_count,
+			};
+			vkCmdPushConstants(workspace.command_buffer, cull_pipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+			vkCmdDispatch(workspace.command_buffer, (push.count + CullPipeline::GroupSize - 1) / CullPipeline::GroupSize, 1, 1);
+		}
+		{ // commands, counts, and culled transforms are ready before drawing:
+			VkMemoryBarrier memory_barrier{
+				.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+				.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+				.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+			};
+			vkCmdPipelineBarrier(workspace.command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+		}
+		{ // and the counts are visible to the CPU once the workspace's fence signals:
+			VkMemoryBarrier memory_barrier{
+				.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+				.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+				.dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+			};
+			vkCmdPipelineBarrier(workspace.command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+		}
+		workspace.cull_stats_pending = true;
+	}
+
+	// (levels of detail are counted above on the CPU, or read back from cull.comp with the other culling stats)
+	if (lod_stats.frames != 0 && time - lod_report_time >= 1.0f) { // report about once a second (just meshes that have levels of detail):
+		uint64_t drawn = 0;
+		for (uint64_t count : lod_stats.instances) drawn += count;
+		if (drawn != 0) {
+			std::cout << "LOD: per frame,";
+			for (uint32_t lod = 0; lod < S72::Mesh::MaxLODLevels; ++lod) {
+				std::cout << (lod == 0 ? "" : ",") << " level " << lod << ": " << lod_stats.instances[lod] / lod_stats.frames << " instances ("
+				          << lod_stats.triangles[lod] / lod_stats.frames << " triangles)";
+			}
+			std::cout << std::endl;
+		}
+		lod_stats = LODStats();
+		lod_report_time = time;
 	}
 
+	write_timestamp(workspace.command_buffer, GPUPhaseBackground); // (culling done)
+
 	// put GPU commands here
 	//render pass:
 	std::array< VkClearValue, 2 > clear_values{
@@ -1066,9 +1784,6 @@ void Tutorial::render(RTG &rtg_, RTG::RenderParams const &render_params) {
 		.pClearValues = clear_values.data(),
 	};
 	
-	vkCmdBeginRenderPass(workspace.command_buffer, &begin_info, VK_SUBPASS_CONTENTS_INLINE);
-
-	// run pipelines here:
 	// Calculate viewport dimensions, handling letterbox/pillarbox for scene cameras
 	float viewport_x = 0.0f;
 	float viewport_y = 0.0f;
@@ -1094,147 +1809,278 @@ void Tutorial::render(RTG &rtg_, RTG::RenderParams const &render_params) {
 		// If aspects match exactly, no adjustment needed
 	}
 
-	{ // set scissor rectangle:
-		VkRect2D scissor{
-			.offset = {.x = int32_t(viewport_x), .y = int32_t(viewport_y)},
-			.extent = {.width = uint32_t(viewport_width), .height = uint32_t(viewport_height)},
-		};
-		vkCmdSetScissor(workspace.command_buffer, 0, 1, &scissor);
-	}
-	{ // configure viewport transform:
-		VkViewport viewport{
-			.x = viewport_x,
-			.y = viewport_y,
-			.width = viewport_width,
-			.height = viewport_height,
-			.minDepth = 0.0f,
-			.maxDepth = 1.0f,
-		};
-		vkCmdSetViewport(workspace.command_buffer, 0, 1, &viewport);
-	}
+	bool gpu_culled = gpu_culling();
 
-	{ // draw with the background pipeline:
-		vkCmdBindPipeline(workspace.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, background_pipeline.handle);
-		
-		{ // push time:
-			BackgroundPipeline::Push push{
-				.time = time,
+	// the objects' draws (indirect draws per cull group, or instanced draws per batch) are split into contiguous chunks:
+	uint32_t draw_count = uint32_t(gpu_culled ? cull_groups.size() : draw_batches.size());
+
+	// records everything in the render pass that chunk 'chunk' of 'chunks' is responsible for into 'command_buffer':
+	// (chunk 0 also draws the background and lines; state is set up again in every chunk, since secondary command buffers don't inherit it)
+	auto record_scene = [&](VkCommandBuffer command_buffer, uint32_t chunk, uint32_t chunks) {
+		{ // set scissor rectangle:
+			VkRect2D scissor{
+				.offset = {.x = int32_t(viewport_x), .y = int32_t(viewport_y)},
+				.extent = {.width = uint32_t(viewport_width), .height = uint32_t(viewport_height)},
 			};
-			vkCmdPushConstants(workspace.command_buffer, background_pipeline.layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(push), &push);
+			vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+		}
+		{ // configure viewport transform:
+			VkViewport viewport{
+				.x = viewport_x,
+				.y = viewport_y,
+				.width = viewport_width,
+				.height = viewport_height,
+				.minDepth = 0.0f,
+				.maxDepth = 1.0f,
+			};
+			vkCmdSetViewport(command_buffer, 0, 1, &viewport);
 		}
-		
-		vkCmdDraw(workspace.command_buffer, 3, 1, 0, 0);
-	}
 
-	if (!lines_vertices.empty()) { // draw with the lines pipeline:
-		vkCmdBindPipeline(
-			workspace.command_buffer, 
-			VK_PIPELINE_BIND_POINT_GRAPHICS, 
-			lines_pipeline.handle
-		);
-		
-		{ // use lines vertices (offset 0) as vertex buffer binding 0:
-			std::array< VkBuffer, 1 > vertex_buffers{ workspace.lines_vertices.handle };
-			std::array< VkDeviceSize, 1 > offsets{ 0 };
-			vkCmdBindVertexBuffers(
-				workspace.command_buffer, 
-				0, 
-				uint32_t(vertex_buffers.size()), 
-				vertex_buffers.data(), 
-				offsets.data()
-			);
+		if (chunk == 0) { // draw with the background pipeline:
+			vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, background_pipeline.handle);
+			
+			{ // push time:
+				BackgroundPipeline::Push push{
+					.time = time,
+				};
+				vkCmdPushConstants(command_buffer, background_pipeline.layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(push), &push);
+			}
+			
+			vkCmdDraw(command_buffer, 3, 1, 0, 0);
 		}
+		if (chunk == 0) write_timestamp(command_buffer, GPUPhaseLines); // (background done)
 
-		{ //bind Camera descriptor set:
-			std::array< VkDescriptorSet, 1 > descriptor_sets{
-				workspace.Camera_descriptors, //0: Camera
-			};
-			vkCmdBindDescriptorSets(
-				workspace.command_buffer, //command buffer
-				VK_PIPELINE_BIND_POINT_GRAPHICS, //pipeline bind point
-				lines_pipeline.layout, //pipeline layout
-				0, //first set
-				uint32_t(descriptor_sets.size()), descriptor_sets.data(), //descriptor sets count, ptr
-				0, nullptr //dynamic offsets count, ptr
+		if (chunk == 0 && !lines_vertices.empty()) { // draw with the lines pipeline:
+			vkCmdBindPipeline(
+				command_buffer, 
+				VK_PIPELINE_BIND_POINT_GRAPHICS, 
+				lines_pipeline.handle
 			);
+			
+			{ // use lines vertices (from frame_data) as vertex buffer binding 0:
+				std::array< VkBuffer, 1 > vertex_buffers{ workspace.frame_data.handle };
+				std::array< VkDeviceSize, 1 > offsets{ lines_offset };
+				vkCmdBindVertexBuffers(
+					command_buffer, 
+					0, 
+					uint32_t(vertex_buffers.size()), 
+					vertex_buffers.data(), 
+					offsets.data()
+				);
+			}
+
+			{ //bind Camera descriptor set:
+				std::array< VkDescriptorSet, 1 > descriptor_sets{
+					workspace.Camera_descriptors, //0: Camera
+				};
+				std::array< uint32_t, 1 > dynamic_offsets{
+					uint32_t(Camera_offset),
+				};
+				vkCmdBindDescriptorSets(
+					command_buffer, //command buffer
+					VK_PIPELINE_BIND_POINT_GRAPHICS, //pipeline bind point
+					lines_pipeline.layout, //pipeline layout
+					0, //first set
+					uint32_t(descriptor_sets.size()), descriptor_sets.data(), //descriptor sets count, ptr
+					uint32_t(dynamic_offsets.size()), dynamic_offsets.data() //dynamic offsets count, ptr
+				);
+			}
+
+			// draw lines vertices:
+			vkCmdDraw(command_buffer, uint32_t(lines_vertices.size()), 1, 0, 0);
+		}
+		if (chunk == 0) write_timestamp(command_buffer, GPUPhaseObjects); // (lines done)
+
+		// this chunk's share of the draws:
+		uint32_t draw_begin = uint32_t(uint64_t(draw_count) * chunk / chunks);
+		uint32_t draw_end = uint32_t(uint64_t(draw_count) * (chunk + 1) / chunks);
+
+		if (!object_instances.empty() && draw_begin < draw_end) { // draw with the objects pipeline
+			vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, objects_pipeline.handle);
+
+			{// use object vertices (offset 0) as vertex buffer binding 0: // what does offset 0. and vertex buffer binding mean //vv The shader expects vertex data at binding 0. When you call vkCmdBindVertexBuffers(..., 0, ...), you're saying "attach this buffer to binding 0." 
+				std::array< VkBuffer, 1 > vertex_buffers{ object_vertices.handle };
+				std::array< VkDeviceSize, 1 > offsets{ 0 }; // tells Where in that buffer the data starts 
+				vkCmdBindVertexBuffers(
+					command_buffer,
+					0, // first binding; this corresponds to the "binding = 0" in the vertex shader's input definitions (VkVertexInputAttributeDescription from PosNorTexVertex.cpp)
+					uint32_t(vertex_buffers.size()),
+					vertex_buffers.data(),
+					offsets.data()
+				);
+			}
+
+			if (object_indices.handle != VK_NULL_HANDLE) { // indices are relative to each mesh's first_vertex (passed as vertexOffset when drawing)
+				vkCmdBindIndexBuffer(command_buffer, object_indices.handle, 0, VK_INDEX_TYPE_UINT32);
+			}
+
+			{ // bind World, Transforms, and TEXTURES descriptor sets (once for every draw; each instance's Transform says which texture it uses):
+				std::array< VkDescriptorSet, 3 > descriptor_sets{
+					workspace.World_descriptors, // 0: World
+					gpu_culled ? workspace.culled_Transforms_descriptors : workspace.Transforms_descriptors, // 1: Transforms (just the survivors, if culled on the GPU)
+					TEXTURES_descriptors, // 2: TEXTURES
+				};
+				std::array< uint32_t, 3 > dynamic_offsets{ // in set order, then binding order within each set:
+					uint32_t(World_offset), // set 0, binding 0: World
+					uint32_t(Camera_offset), // set 0, binding 1: Camera
+					gpu_culled ? 0 : uint32_t(Transforms_offset), // set 1, binding 0: Transforms
+				};
+				vkCmdBindDescriptorSets(
+					command_buffer, // command buffer
+					VK_PIPELINE_BIND_POINT_GRAPHICS, // pipeline bind point
+					objects_pipeline.layout, // pipeline layout
+					0, // first set; note that before creating the world descriptor set, our descriptor set got bound as set 1, not set 0.
+					uint32_t(descriptor_sets.size()), descriptor_sets.data(), // descriptor sets count, ptr
+					uint32_t(dynamic_offsets.size()), dynamic_offsets.data() // dynamic offsets count, ptr
+				);
+			}
+
+			// camera descriptor set is still bound (!), but not used <- what does this mean //vv
+			// we didn't need to re-bind the camera descriptor set -- we were able to leave it bound because set 0 for both the lines pipeline and the objects pipeline are compatible.
+			// - You drew lines with the lines pipeline (camera was bound)
+			// - Now you switch to the objects pipeline with vkCmdBindPipeline
+			// - You don't need to rebind the camera descriptor set!
+
+			if (gpu_culled) { // GPU culling: one indirect draw per group; cull.comp wrote how many commands each group actually has
+				for (uint32_t g = draw_begin; g < draw_end; ++g) {
+					CullGroup const &group = cull_groups[g];
+					VkDeviceSize commands_offset = VkDeviceSize(group.first_batch) * CullPipeline::CommandStride;
+					VkDeviceSize count_offset = VkDeviceSize(g) * sizeof(uint32_t);
+					if (group.indexed) {
+						vkCmdDrawIndexedIndirectCount(command_buffer, workspace.draw_commands.handle, commands_offset, workspace.draw_counts.handle, count_offset, group.batch_count, CullPipeline::CommandStride);
+					} else {
+						vkCmdDrawIndirectCount(command_buffer, workspace.draw_commands.handle, commands_offset, workspace.draw_counts.handle, count_offset, group.batch_count, CullPipeline::CommandStride);
+					}
+				}
+			} else { // draw batches (already culled; gl_InstanceIndex starts at first_instance, so it indexes straight into TRANSFORMS):
+				for (uint32_t b = draw_begin; b < draw_end; ++b) {
+					DrawBatch const &batch = draw_batches[b];
+					if (!batch.mesh->lods.empty()) {
+						S72::Mesh::LOD const &lod = batch.mesh->lods[batch.lod];
+						vkCmdDrawIndexed(command_buffer, lod.index_count, batch.instance_count, lod.first_index, int32_t(batch.mesh->first_vertex), batch.first_instance);
+					} else if (batch.mesh->index_count != 0) {
+						vkCmdDrawIndexed(command_buffer, batch.mesh->index_count, batch.instance_count, batch.mesh->first_index, int32_t(batch.mesh->first_vertex), batch.first_instance);
+					} else {
+						vkCmdDraw(command_buffer, batch.mesh->vertex_count, batch.instance_count, batch.mesh->first_vertex, batch.first_instance);
+					}
+				}
+			}
 		}
+	};
 
-		// draw lines vertices:
-		vkCmdDraw(workspace.command_buffer, uint32_t(lines_vertices.size()), 1, 0, 0);
+	if (pipeline_statistics) { // count shader invocations for the whole render pass:
+		vkCmdBeginQuery(workspace.command_buffer, workspace.statistics, 0, 0);
 	}
 
-	if (!object_instances.empty()) { // draw with the objects pipeline
-		vkCmdBindPipeline(workspace.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, objects_pipeline.handle);
+	if (workspace.recorders.empty()) { // record on this thread, straight into the primary command buffer:
+		vkCmdBeginRenderPass(workspace.command_buffer, &begin_info, VK_SUBPASS_CONTENTS_INLINE);
+		record_scene(workspace.command_buffer, 0, 1);
+	} else { // record chunks of the draw list into secondary command buffers in parallel (--record-threads):
+		// never more chunks than draws (but always at least the one that draws the background):
+		uint32_t chunks = std::max(1u, std::min(uint32_t(workspace.recorders.size()), draw_count));
 
-		{// use object vertices (offset 0) as vertex buffer binding 0: // what does offset 0. and vertex buffer binding mean //vv The shader expects vertex data at binding 0. When you call vkCmdBindVertexBuffers(..., 0, ...), you're saying "attach this buffer to binding 0." 
-			std::array< VkBuffer, 1 > vertex_buffers{ object_vertices.handle };
-			std::array< VkDeviceSize, 1 > offsets{ 0 }; // tells Where in that buffer the data starts 
-			vkCmdBindVertexBuffers(
-				workspace.command_buffer,
-				0, // first binding; this corresponds to the "binding = 0" in the vertex shader's input definitions (VkVertexInputAttributeDescription from PosNorTexVertex.cpp)
-				uint32_t(vertex_buffers.size()),
-				vertex_buffers.data(),
-				offsets.data()
-			);
+		VkCommandBufferInheritanceInfo inheritance_info{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+			.renderPass = render_pass,
+			.subpass = 0,
+			.framebuffer = framebuffer,
+			.pipelineStatistics = (pipeline_statistics ? GPUProfileStatistics : 0), // (the statistics query stays active while they run)
+		};
+
+		// chunk i always goes to recorders[i], whichever thread picks it up, so no command pool is ever used by two threads at once:
+		record_pool->parallel_for(chunks, [&](size_t chunk) {
+			Workspace::Recorder &recorder = workspace.recorders[chunk];
+			VK( vkResetCommandPool(rtg.device, recorder.command_pool, 0) ); // this workspace's previous frame is done with it
+			VkCommandBufferBeginInfo secondary_begin_info{
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+				.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, // runs entirely inside the render pass
+				.pInheritanceInfo = &inheritance_info,
+			};
+			VK( vkBeginCommandBuffer(recorder.command_buffer, &secondary_begin_info) );
+			record_scene(recorder.command_buffer, uint32_t(chunk), chunks);
+			VK( vkEndCommandBuffer(recorder.command_buffer) );
+		});
+
+		// executed in chunk order, so the frame comes out the same no matter how the chunks were scheduled:
+		std::vector< VkCommandBuffer > secondaries;
+		secondaries.reserve(chunks);
+		for (uint32_t i = 0; i < chunks; ++i) {
+			secondaries.emplace_back(workspace.recorders[i].command_buffer);
 		}
+		vkCmdBeginRenderPass(workspace.command_buffer, &begin_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		vkCmdExecuteCommands(workspace.command_buffer, uint32_t(secondaries.size()), secondaries.data());
+	}
+	vkCmdEndRenderPass(workspace.command_buffer);
 
-		{ // bind World and Transforms descriptor set:
-			std::array< VkDescriptorSet, 2 > descriptor_sets{
-				workspace.World_descriptors, // 0: World
-				workspace.Transforms_descriptors, // 1: Transforms
+	if (pipeline_statistics) {
+		vkCmdEndQuery(workspace.command_buffer, workspace.statistics, 0);
+	}
+	write_timestamp(workspace.command_buffer, GPUPhaseDepthPyramid); // (objects done)
+
+	if (culling_mode == CullingMode::HiZ && camera_mode != CameraMode::Debug) { // build the depth pyramid that next frame's occlusion tests read:
+		{ // depth writes finish before the depth buffer is sampled; this frame's culling is done reading the pyramid before it is overwritten:
+			std::array< VkImageMemoryBarrier, 2 > barriers{
+				VkImageMemoryBarrier{
+					.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+					.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+					.dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+					.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+					.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+					.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+					.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+					.image = swapchain_depth_image.handle,
+					.subresourceRange{ .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT, .baseMipLevel = 0, .levelCount = 1, .baseArrayLayer = 0, .layerCount = 1 },
+				},
+				VkImageMemoryBarrier{
+					.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+					.srcAccessMask = 0, // (only reads to wait for)
+					.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+					.oldLayout = (depth_pyramid_built ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_UNDEFINED), // (nothing worth keeping in a new pyramid)
+					.newLayout = VK_IMAGE_LAYOUT_GENERAL,
+					.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+					.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+					.image = depth_pyramid.handle,
+					.subresourceRange{ .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0, .levelCount = depth_pyramid.mip_levels, .baseArrayLayer = 0, .layerCount = 1 },
+				},
 			};
-			vkCmdBindDescriptorSets(
-				workspace.command_buffer, // command buffer
-				VK_PIPELINE_BIND_POINT_GRAPHICS, // pipeline bind point
-				objects_pipeline.layout, // pipeline layout
-				0, // first set; note that before creating the world descriptor set, our descriptor set got bound as set 1, not set 0.
-				uint32_t(descriptor_sets.size()), descriptor_sets.data(), // descriptor sets count, ptr
-				0, nullptr // dynamic offsets count, ptr
+			vkCmdPipelineBarrier(workspace.command_buffer,
+				VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+				0, nullptr, 0, nullptr, uint32_t(barriers.size()), barriers.data()
 			);
 		}
 
-		// camera descriptor set is still bound (!), but not used <- what does this mean //vv
-		// we didn't need to re-bind the camera descriptor set -- we were able to leave it bound because set 0 for both the lines pipeline and the objects pipeline are compatible.
-		// - You drew lines with the lines pipeline (camera was bound)
-		// - Now you switch to the objects pipeline with vkCmdBindPipeline
-		// - You don't need to rebind the camera descriptor set!
-
-		// draw all instances:
-		for (ObjectInstance const &inst : object_instances) {
-			if (culling_mode == CullingMode::Frustum){
-				// Get local-space bounding box corners
-				S72::vec3 const &bmin = inst.mesh->bbox_min;
-				S72::vec3 const &bmax = inst.mesh->bbox_max;
-
-				/* takes in:
-				1. the view matrix of the camera; Transforms points from world space into camera (view) space.
-				2. the model/world transform of object; Converts points from model space into world space.
-				*/
-        		mat4 VIEW_FROM_LOCAL = CAMERA_FROM_WORLD * inst.transform.WORLD_FROM_LOCAL;
-
-				if (!SAT_visibility_test(frustum, VIEW_FROM_LOCAL, bmin, bmax)) {
-					continue; // skip this instance if it's not visible
-				}
+		vkCmdBindPipeline(workspace.command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, depth_pyramid_pipeline.handle);
+		for (uint32_t level = 0; level < depth_pyramid.mip_levels; ++level) {
+			if (level != 0) { // previous level is written before this one reads it:
+				VkMemoryBarrier memory_barrier{
+					.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+					.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+					.dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+				};
+				vkCmdPipelineBarrier(workspace.command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
 			}
 
-			uint32_t index = uint32_t(&inst - &object_instances[0]);
-
-			// bind texture descriptor set
-			vkCmdBindDescriptorSets(
-				workspace.command_buffer, // command buffer
-				VK_PIPELINE_BIND_POINT_GRAPHICS, // pipeline bind point
-				objects_pipeline.layout, // pipeline layout
-				2, // set number (slot 2)   
-				1, &texture_descriptors[inst.texture], // descriptor sets count, ptr (which descriptor set to put in slot 2)
-				0, nullptr // dynamic offsets count, ptr
+			vkCmdBindDescriptorSets(workspace.command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, depth_pyramid_pipeline.layout, 0, 1, &depth_pyramid_reduce_descriptors[level], 0, nullptr);
+			uint32_t width = std::max(1u, depth_pyramid.extent.width >> level);
+			uint32_t height = std::max(1u, depth_pyramid.extent.height >> level);
+			vkCmdDispatch(workspace.command_buffer,
+				(width + DepthPyramidPipeline::GroupSize - 1) / DepthPyramidPipeline::GroupSize,
+				(height + DepthPyramidPipeline::GroupSize - 1) / DepthPyramidPipeline::GroupSize,
+				1
 			);
-
-			// vkCmdDraw(workspace.command_buffer, inst.vertices.count, 1, inst.vertices.first, index); // Prev for drawing objects
-			vkCmdDraw(workspace.command_buffer, inst.mesh->count, 1, inst.mesh->first_vertex, index);
 		}
+		// (next frame's culling waits for these writes with the barrier before its dispatches; its render pass waits for the depth reads)
+
+		depth_pyramid_built = true;
+		depth_pyramid_CLIP_FROM_WORLD = CLIP_FROM_WORLD;
+		depth_pyramid_viewport[0] = viewport_x;
+		depth_pyramid_viewport[1] = viewport_y;
+		depth_pyramid_viewport[2] = viewport_width;
+		depth_pyramid_viewport[3] = viewport_height;
 	}
 
-	vkCmdEndRenderPass(workspace.command_buffer);
+	write_timestamp(workspace.command_buffer, GPUPhaseCount); // (depth pyramid done)
+	workspace.profile_pending = gpu_profiling;
 
 	//end recording:
 	VK( vkEndCommandBuffer(workspace.command_buffer ));
@@ -1273,152 +2119,523 @@ void Tutorial::render(RTG &rtg_, RTG::RenderParams const &render_params) {
 	}
 }
 
-// evaluate driver's state at animation_time and write into driver.node.translation/rotation/scale based on driver.values
-void Tutorial::evaluate_driver(S72::Driver& driver, float time) {
-	if (driver.times.empty()) return;
-
-	// find keyframe interval
-	if (time <= driver.times[0]) {
-		// before first keyframe, set to first keyframe value
-		// set the animated value to driver.values start at 0
-		// The values in the values array are grouped into 1D-4D vectors depending on the channel type and interpolation scheme. 
-		// For example, a 3D channel with n times will have 3n values, which should be considered as n 3-vectors.
-		size_t i = 0;
-		if (driver.channel == S72::Driver::Channel::translation) {
-			driver.node.translation = S72::vec3{
-				.x = driver.values[i + 0],
-				.y = driver.values[i + 1],
-				.z = driver.values[i + 2]};
-		}
-		else if (driver.channel == S72::Driver::Channel::rotation) {
-			driver.node.rotation = S72::quat{
-				.x = driver.values[i + 0],
-				.y = driver.values[i + 1],
-				.z = driver.values[i + 2],
-				.w = driver.values[i + 3]};
-		}
-		else if (driver.channel == S72::Driver::Channel::scale) {
-			driver.node.scale = S72::vec3{
-				.x = driver.values[i + 0],
-				.y = driver.values[i + 1],
-				.z = driver.values[i + 2]};
-		}
-	} else if (time > driver.times.back()) {
-		// after last keyframe, set to last keyframe value
-		// set the animated value to driver.values.back()
-		size_t stride = (driver.channel == S72::Driver::Channel::rotation) ? 4 : 3;                                                                                                                           
-  		size_t i = driver.values.size() - stride;    
-		if (driver.channel == S72::Driver::Channel::translation) {
-			driver.node.translation = S72::vec3{
-				.x = driver.values[i + 0],
-				.y = driver.values[i + 1],
-				.z = driver.values[i + 2]     
-			};
-		} else if (driver.channel == S72::Driver::Channel::rotation) {
-			driver.node.rotation = S72::quat{   
-				.x = driver.values[i + 0],
-				.y = driver.values[i + 1],
-				.z = driver.values[i + 2],
-				.w = driver.values[i + 3] 
-			}; 
-		} else if (driver.channel == S72::Driver::Channel::scale) {
-			driver.node.scale = S72::vec3{
-				.x = driver.values[i + 0],
-				.y = driver.values[i + 1],
-				.z = driver.values[i + 2]   
-			};
-		}
-	} else {
-		// time is between keyframes, find the interval [times[i], times[i+1]] that contains animation_time
-		size_t i = 0;
-		while (i < driver.times.size() && driver.times[i] <= time) {
-			i++;
-		}
-		assert(0 < i && i < driver.times.size()); // because time > driver.times[0] and time < driver.times.back()
-
-		if (driver.interpolation == S72::Driver::Interpolation::STEP) {
-			// the output value in the middle of a time interval is the value at the beginning of that interval.
-			size_t start_i = (i - 1) * (driver.channel == S72::Driver::Channel::rotation ? 4 : 3);
-			if (driver.channel == S72::Driver::Channel::translation) {
-				driver.node.translation = S72::vec3{
-					.x = driver.values[start_i + 0],
-					.y = driver.values[start_i + 1],
-					.z = driver.values[start_i + 2]     
-				};
-			} else if (driver.channel == S72::Driver::Channel::rotation) {
-				driver.node.rotation = S72::quat{   
-					.x = driver.values[start_i + 0],
-					.y = driver.values[start_i + 1],
-					.z = driver.values[start_i + 2],
-					.w = driver.values[start_i + 3] 
-				};
-			} else if (driver.channel == S72::Driver::Channel::scale) {
-				driver.node.scale = S72::vec3{
-					.x = driver.values[start_i + 0],
-					.y = driver.values[start_i + 1],
-					.z = driver.values[start_i + 2]   
-				};
+// -- scene graph transform helpers --
+// Building Local Transform from node's TRS (Translation, Rotation Scale: local = Translation × Rotation × Scale
+// Where: Translation = mat4 with (tx, ty, tz) in last column; Rotation = quaternion (x,y,z,w) → 3x3 rotation matrix; Scale = diagonal mat4 with (sx, sy, sz, 1)
+
+// helper: make translation matrix from S72::vec3
+static mat4 translate(S72::vec3 const &t) {
+	return mat4{
+		1.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		t.x,  t.y,  t.z,  1.0f,
+	};
+}
+
+// helper: scale matrix
+static mat4 scale(S72::vec3 const &s) {
+	return mat4{
+		s.x, 0.0f, 0.0f, 0.0f,
+		0.0f, s.y, 0.0f, 0.0f,
+		0.0f, 0.0f, s.z, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f,
+	};
+}
+
+// helper: rotation matrix from quaternion (column-major)
+static mat4 rotation_from_quat(S72::quat const &q) {
+	float x = q.x, y = q.y, z = q.z, w = q.w;
+	float xx = x * x, yy = y * y, zz = z * z;
+	float xy = x * y, xz = x * z, yz = y * z;
+	float wx = w * x, wy = w * y, wz = w * z;
+	// 3x3 rotation
+	float m00 = 1.0f - 2.0f * (yy + zz);
+	float m01 = 2.0f * (xy - wz);
+	float m02 = 2.0f * (xz + wy);
+
+	float m10 = 2.0f * (xy + wz);
+	float m11 = 1.0f - 2.0f * (xx + zz);
+	float m12 = 2.0f * (yz - wx);
+
+	float m20 = 2.0f * (xz - wy);
+	float m21 = 2.0f * (yz + wx);
+	float m22 = 1.0f - 2.0f * (xx + yy);
+
+	return mat4{
+		m00, m10, m20, 0.0f,
+		m01, m11, m21, 0.0f,
+		m02, m12, m22, 0.0f,
+		0.0f,0.0f,0.0f,1.0f,
+	};
+}
+
+// helper: transpose a mat4
+static mat4 transpose(mat4 const &A) {
+	mat4 R;
+	for (int c = 0; c < 4; ++c) for (int r = 0; r < 4; ++r) R[c*4 + r] = A[r*4 + c];
+	return R;
+}
+
+// helper: inverse of an affine mat4 (bottom row = 0,0,0,1). If not invertible, returns identity.
+static mat4 inverse_affine(mat4 const &M) {
+	// Extract upper-left 3x3 (column-major)
+	float a00 = M[0], a10 = M[1], a20 = M[2];
+	float a01 = M[4], a11 = M[5], a21 = M[6];
+	float a02 = M[8], a12 = M[9], a22 = M[10];
+
+	// compute determinant
+	float det = a00*(a11*a22 - a12*a21) - a01*(a10*a22 - a12*a20) + a02*(a10*a21 - a11*a20);
+	if (std::fabs(det) < 1e-12f) return mat4_identity;
+	float invdet = 1.0f / det;
+
+	// inverse 3x3 = adjugate / det
+	float b00 =  (a11*a22 - a12*a21) * invdet;
+	float b01 = -(a01*a22 - a02*a21) * invdet;
+	float b02 =  (a01*a12 - a02*a11) * invdet;
+
+	float b10 = -(a10*a22 - a12*a20) * invdet;
+	float b11 =  (a00*a22 - a02*a20) * invdet;
+	float b12 = -(a00*a12 - a02*a10) * invdet;
+
+	float b20 =  (a10*a21 - a11*a20) * invdet;
+	float b21 = -(a00*a21 - a01*a20) * invdet;
+	float b22 =  (a00*a11 - a01*a10) * invdet;
+
+	// translation vector
+	float tx = M[12], ty = M[13], tz = M[14];
+
+	// invT = -invM * t
+	float itx = -(b00*tx + b01*ty + b02*tz);
+	float ity = -(b10*tx + b11*ty + b12*tz);
+	float itz = -(b20*tx + b21*ty + b22*tz);
+
+	mat4 R;
+	// column 0
+	R[0] = b00; R[1] = b10; R[2] = b20; R[3] = 0.0f;
+	// column 1
+	R[4] = b01; R[5] = b11; R[6] = b21; R[7] = 0.0f;
+	// column 2
+	R[8] = b02; R[9] = b12; R[10] = b22; R[11] = 0.0f;
+	// column 3 (translation)
+	R[12] = itx; R[13] = ity; R[14] = itz; R[15] = 1.0f;
+	return R;
+}
+
+void Tutorial::build_scene_nodes() {
+	scene_nodes.clear();
+	scene_node_indices.assign(s72.nodes.size(), {});
+	object_instances.clear();
+	scene_camera_instances.clear();
+
+	// 1. traverse the scene graph from root; "roots" is an optional array of references to nodes at which to start drawing the scene.
+	// nodes are appended in preorder, so a parent is always stored before its children and every subtree is a contiguous range
+	std::function< void(S72::NodeHandle, uint32_t) > flatten = [&](S72::NodeHandle handle, uint32_t parent) {
+		S72::Node &node = s72[handle];
+		uint32_t index = uint32_t(scene_nodes.size());
+		scene_nodes.emplace_back(SceneNode{
+			.node = &node,
+			.parent = parent,
+		});
+		scene_node_indices[handle.index].emplace_back(index);
+
+		if (node.mesh) {
+			S72::Mesh &mesh = s72[node.mesh];
+			// Determine texture index from material
+			uint32_t tex_index = 0; // default white texture
+			if (mesh.material) {
+				tex_index = material_albedo_indices[mesh.material.index];
 			}
-		} else if (driver.interpolation == S72::Driver::Interpolation::LINEAR) {
-			// the output value in the middle of a time interval is a linear mix of the starting and ending values.
-			size_t start_i = (i - 1) * (driver.channel == S72::Driver::Channel::rotation ? 4 : 3);
-			size_t end_i = i * (driver.channel == S72::Driver::Channel::rotation ? 4 : 3);
-
-			float t = (time - driver.times[i-1]) / (driver.times[i] - driver.times[i-1]); // normalized time in [0, 1]
-			if (driver.channel == S72::Driver::Channel::translation) {
-				driver.node.translation = S72::vec3{
-					.x = (1.0f - t) * driver.values[start_i + 0] + t * driver.values[end_i + 0],
-					.y = (1.0f - t) * driver.values[start_i + 1] + t * driver.values[end_i + 1],
-					.z = (1.0f - t) * driver.values[start_i + 2] + t * driver.values[end_i + 2],    
-				};
-			} else if (driver.channel == S72::Driver::Channel::rotation) {
-				driver.node.rotation = S72::quat{   
-					.x = (1.0f - t) * driver.values[start_i + 0] + t * driver.values[end_i + 0],
-					.y = (1.0f - t) * driver.values[start_i + 1] + t * driver.values[end_i + 1],
-					.z = (1.0f - t) * driver.values[start_i + 2] + t * driver.values[end_i + 2],
-					.w = (1.0f - t) * driver.values[start_i + 3] + t * driver.values[end_i + 3], 
-				}; // TODO: check - would this linear mix work for rotation?
-			} else if (driver.channel == S72::Driver::Channel::scale) {
-				driver.node.scale = S72::vec3{
-					.x = (1.0f - t) * driver.values[start_i + 0] + t * driver.values[end_i + 0],
-					.y = (1.0f - t) * driver.values[start_i + 1] + t * driver.values[end_i + 1],
-					.z = (1.0f - t) * driver.values[start_i + 2] + t * driver.values[end_i + 2],   
-				};
+
+			scene_nodes[index].object_instance = uint32_t(object_instances.size());
+			object_instances.emplace_back(ObjectInstance{
+				.mesh = &mesh,
+				.transform = { .TEXTURE = tex_index }, // matrices filled in by update_scene_nodes()
+				.texture = tex_index,
+			});
+		}
+
+		if (node.camera) {
+			scene_nodes[index].scene_camera_instance = uint32_t(scene_camera_instances.size());
+			scene_camera_instances.emplace_back(SceneCamera{
+				.camera = &s72[node.camera],
+				.WORLD_FROM_LOCAL = mat4_identity, // filled in by update_scene_nodes()
+			});
+		}
+
+		for (S72::NodeHandle child : node.children) {
+			flatten(child, index);
+		}
+
+		scene_nodes[index].subtree_end = uint32_t(scene_nodes.size());
+	};
+
+	for (S72::NodeHandle root : s72.scene.roots) {
+		if (root) flatten(root, -1U);
+	}
+
+	// 2. group instances that can share a draw (textures are indexed per-instance, so only the mesh matters; texture order just keeps neighbors sampling the same image):
+	instance_draw_order.resize(object_instances.size());
+	for (uint32_t i = 0; i < uint32_t(instance_draw_order.size()); ++i) {
+		instance_draw_order[i] = i;
+	}
+	std::stable_sort(instance_draw_order.begin(), instance_draw_order.end(), [this](uint32_t a, uint32_t b) {
+		ObjectInstance const &A = object_instances[a];
+		ObjectInstance const &B = object_instances[b];
+		if ((A.mesh->index_count != 0) != (B.mesh->index_count != 0)) return A.mesh->index_count == 0; // so GPU culling can draw all indexed and all non-indexed meshes as two groups
+		if (A.mesh != B.mesh) return A.mesh < B.mesh; // (both point into s72.meshes, so this is mesh handle order)
+		return A.texture < B.texture;
+	});
+
+	// 3. bucket nodes by depth, for level-by-level transform updates:
+	std::vector< uint32_t > depth(scene_nodes.size(), 0);
+	scene_level_begin.assign(1, 0);
+	for (uint32_t n = 0; n < uint32_t(scene_nodes.size()); ++n) {
+		if (scene_nodes[n].parent != -1U) depth[n] = depth[scene_nodes[n].parent] + 1; // (parents come first in preorder)
+		if (depth[n] + 2 > scene_level_begin.size()) scene_level_begin.resize(depth[n] + 2, 0);
+		scene_level_begin[depth[n] + 1] += 1;
+	}
+	for (uint32_t d = 1; d < uint32_t(scene_level_begin.size()); ++d) {
+		scene_level_begin[d] += scene_level_begin[d - 1];
+	}
+	scene_levels.resize(scene_nodes.size());
+	std::vector< uint32_t > level_head(scene_level_begin.begin(), scene_level_begin.end() - 1);
+	for (uint32_t n = 0; n < uint32_t(scene_nodes.size()); ++n) {
+		scene_levels[level_head[depth[n]]++] = n;
+	}
+	scene_node_moved.assign(scene_nodes.size(), 0);
+
+	// 4. group drivers by node (pointing straight at the scene_nodes entries they dirty, so evaluation needs no lookups):
+	driver_groups.clear();
+	std::vector< uint32_t > node_group(s72.nodes.size(), -1U); // by node handle: index into driver_groups
+	for (S72::Driver &driver : s72.drivers) {
+		if (driver.times.empty()) continue;
+		uint32_t &g = node_group[driver.node.index];
+		if (g == -1U) {
+			g = uint32_t(driver_groups.size());
+			std::vector< uint32_t > const &indices = scene_node_indices[driver.node.index];
+			driver_groups.emplace_back(DriverGroup{
+				.node = &s72[driver.node],
+				.scene_nodes = (indices.empty() ? nullptr : &indices),
+			});
+		}
+		DriverGroup &group = driver_groups[g];
+		if (driver.channel == S72::Driver::Channel::translation) group.translation.emplace_back(&driver);
+		else if (driver.channel == S72::Driver::Channel::rotation) group.rotation.emplace_back(&driver);
+		else if (driver.channel == S72::Driver::Channel::scale) group.scale.emplace_back(&driver);
+	}
+}
+
+void Tutorial::build_cull_batches() {
+	cull_groups.clear();
+	cull_batch_count = 0;
+	if (instance_draw_order.empty()) return;
+
+	// instance_draw_order is sorted by (indexed-ness, mesh, texture), so groups and runs of one mesh are both runs of it:
+	std::vector< CullPipeline::Batch > batches;
+	std::vector< uint32_t > instance_batches(instance_draw_order.size());
+	culled_count = 0;
+	for (uint32_t begin = 0, end = 0; begin < uint32_t(instance_draw_order.size()); begin = end) {
+		S72::Mesh const &mesh = *object_instances[instance_draw_order[begin]].mesh;
+		end = begin + 1;
+		while (end < uint32_t(instance_draw_order.size()) && object_instances[instance_draw_order[end]].mesh == &mesh) ++end;
+		bool indexed = (mesh.index_count != 0);
+
+		if (cull_groups.empty() || cull_groups.back().indexed != indexed) {
+			cull_groups.emplace_back(CullGroup{
+				.indexed = indexed,
+				.first_batch = uint32_t(batches.size()),
+			});
+		}
+
+		// one batch per level (any of which could end up holding the whole run, so each gets room for all of it):
+		uint32_t first_batch = uint32_t(batches.size());
+		uint32_t levels = std::max(1u, uint32_t(mesh.lods.size()));
+		for (uint32_t lod = 0; lod < levels; ++lod) {
+			S72::Mesh::LOD level = (mesh.lods.empty() ? S72::Mesh::LOD{ .first_index = mesh.first_index, .index_count = mesh.index_count } : mesh.lods[lod]);
+			batches.emplace_back(CullPipeline::Batch{
+				.bbox_min = { mesh.bbox_min.x, mesh.bbox_min.y, mesh.bbox_min.z, 0.0f },
+				.bbox_max = { mesh.bbox_max.x, mesh.bbox_max.y, mesh.bbox_max.z, 0.0f },
+				.first_instance = culled_count,
+				.group = uint32_t(cull_groups.size()) - 1,
+				.first_command = cull_groups.back().first_batch,
+				.indexed = (indexed ? 1u : 0u),
+				.element_count = (indexed ? level.index_count : mesh.vertex_count),
+				.first_element = (indexed ? level.first_index : mesh.first_vertex),
+				.vertex_offset = int32_t(mesh.first_vertex),
+				.lod_count = uint32_t(mesh.lods.size()),
+				.lod_error = level.error,
+				.padding_ = { 0, 0, 0 },
+			});
+			culled_count += end - begin;
+		}
+		cull_groups.back().batch_count += levels;
+
+		for (uint32_t i = begin; i < end; ++i) {
+			instance_batches[i] = first_batch;
+		}
+	}
+	cull_batch_count = uint32_t(batches.size());
+
+	{ // upload the static parts:
+		size_t batches_bytes = batches.size() * sizeof(batches[0]);
+		cull_batches = rtg.helpers.create_buffer(
+			batches_bytes,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			Helpers::Unmapped
+		);
+		rtg.helpers.upload_to_buffer(batches.data(), batches_bytes, cull_batches);
+
+		size_t instance_batches_bytes = instance_batches.size() * sizeof(instance_batches[0]);
+		cull_instance_batches = rtg.helpers.create_buffer(
+			instance_batches_bytes,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			Helpers::Unmapped
+		);
+		rtg.helpers.upload_to_buffer(instance_batches.data(), instance_batches_bytes, cull_instance_batches);
+	}
+
+	for (Workspace &workspace : workspaces) {
+		// culling outputs, only ever touched by the GPU:
+		workspace.culled_transforms = rtg.helpers.create_buffer(
+			culled_count * sizeof(ObjectsPipeline::Transform),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			Helpers::Unmapped
+		);
+		workspace.draw_commands = rtg.helpers.create_buffer(
+			cull_batch_count * CullPipeline::CommandStride,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			Helpers::Unmapped
+		);
+		workspace.draw_counts = rtg.helpers.create_buffer(
+			cull_groups.size() * sizeof(uint32_t),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, // (cleared with vkCmdFillBuffer)
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			Helpers::Unmapped
+		);
+		workspace.batch_visible = rtg.helpers.create_buffer(
+			cull_batch_count * sizeof(uint32_t),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, // (cleared with vkCmdFillBuffer)
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			Helpers::Unmapped
+		);
+		workspace.cull_stats = rtg.helpers.create_buffer(
+			sizeof(CullPipeline::Stats),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, // (cleared with vkCmdFillBuffer)
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			Helpers::Mapped // read back by the CPU
+		);
+
+		// point the Cull set's static bindings (2-8) and the culled Transforms set at them (bindings 0 and 1 are in write_frame_descriptors):
+		std::array< VkDescriptorBufferInfo, 7 > infos{
+			VkDescriptorBufferInfo{ .buffer = cull_batches.handle, .offset = 0, .range = VK_WHOLE_SIZE },
+			VkDescriptorBufferInfo{ .buffer = cull_instance_batches.handle, .offset = 0, .range = VK_WHOLE_SIZE },
+			VkDescriptorBufferInfo{ .buffer = workspace.culled_transforms.handle, .offset = 0, .range = VK_WHOLE_SIZE },
+			VkDescriptorBufferInfo{ .buffer = workspace.draw_commands.handle, .offset = 0, .range = VK_WHOLE_SIZE },
+			VkDescriptorBufferInfo{ .buffer = workspace.draw_counts.handle, .offset = 0, .range = VK_WHOLE_SIZE },
+			VkDescriptorBufferInfo{ .buffer = workspace.batch_visible.handle, .offset = 0, .range = VK_WHOLE_SIZE },
+			VkDescriptorBufferInfo{ .buffer = workspace.cull_stats.handle, .offset = 0, .range = VK_WHOLE_SIZE },
+		};
+		VkDescriptorBufferInfo culled_Transforms_info{
+			.buffer = workspace.culled_transforms.handle,
+			.offset = 0,
+			.range = workspace.culled_transforms.size, // (a dynamic descriptor with offset 0 always, so the range can be the whole buffer)
+		};
+
+		std::vector< VkWriteDescriptorSet > writes;
+		for (uint32_t i = 0; i < uint32_t(infos.size()); ++i) {
+			writes.emplace_back(VkWriteDescriptorSet{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.dstSet = workspace.Cull_descriptors,
+				.dstBinding = 2 + i,
+				.dstArrayElement = 0,
+				.descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.pBufferInfo = &infos[i],
+			});
+		}
+		writes.emplace_back(VkWriteDescriptorSet{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = workspace.culled_Transforms_descriptors,
+			.dstBinding = 0,
+			.dstArrayElement = 0,
+			.descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+			.pBufferInfo = &culled_Transforms_info,
+		});
+
+		vkUpdateDescriptorSets(rtg.device, uint32_t(writes.size()), writes.data(), 0, nullptr);
+	}
+
+	if (rtg.configuration.debug) {
+		std::cout << "GPU culling: " << object_instances.size() << " instances in " << cull_batch_count << " batches, drawn as " << cull_groups.size() << " indirect draws." << std::endl;
+	}
+}
+
+// runs job(begin, end) over [0, count) in chunks of (up to) 'chunk' items: across the pool if there is one and more than one chunk, otherwise inline.
+// (chunks don't depend on the thread count, and jobs only write their own items, so results are the same either way)
+static void for_each_chunk(ThreadPool *pool, size_t count, size_t chunk, std::function< void(size_t, size_t) > const &job) {
+	size_t chunks = (count + chunk - 1) / chunk;
+	if (pool && chunks > 1) {
+		pool->parallel_for(chunks, [&](size_t c) {
+			job(c * chunk, std::min(count, (c + 1) * chunk));
+		});
+	} else if (count != 0) {
+		job(0, count);
+	}
+}
+
+void Tutorial::update_scene_nodes() {
+	// writes a node's new world transform to whatever it carries:
+	auto place = [&](SceneNode &sn) {
+		if (sn.object_instance != -1U) {
+			ObjectsPipeline::Transform &tf = object_instances[sn.object_instance].transform;
+			tf.WORLD_FROM_LOCAL = sn.WORLD_FROM_LOCAL;
+			tf.WORLD_FROM_LOCAL_NORMAL = transpose(inverse_affine(sn.WORLD_FROM_LOCAL));
+		}
+		if (sn.scene_camera_instance != -1U) {
+			scene_camera_instances[sn.scene_camera_instance].WORLD_FROM_LOCAL = sn.WORLD_FROM_LOCAL;
+		}
+	};
+
+	if (animation_pool) { // level by level, each level split across the pool (every parent is finished before its children start):
+		for (uint32_t d = 0; d + 1 < uint32_t(scene_level_begin.size()); ++d) {
+			uint32_t begin = scene_level_begin[d];
+			for_each_chunk(animation_pool.get(), scene_level_begin[d + 1] - begin, 256, [&](size_t first, size_t last) {
+				for (size_t l = begin + first; l < begin + last; ++l) {
+					uint32_t j = scene_levels[l];
+					SceneNode &sn = scene_nodes[j];
+					bool parent_moved = (sn.parent != -1U && scene_node_moved[sn.parent]);
+					scene_node_moved[j] = (sn.dirty || parent_moved);
+					if (!scene_node_moved[j]) continue;
+					if (sn.dirty) {
+						S72::Node const &node = *sn.node;
+						sn.LOCAL = translate(node.translation) * rotation_from_quat(node.rotation) * scale(node.scale);
+						sn.dirty = false;
+					}
+					if (sn.parent == -1U) sn.WORLD_FROM_LOCAL = sn.LOCAL;
+					else sn.WORLD_FROM_LOCAL = scene_nodes[sn.parent].WORLD_FROM_LOCAL * sn.LOCAL;
+					place(sn);
+				}
+			});
+		}
+		if (culling_mode == CullingMode::BVH) { // (in preorder, like the inline path below)
+			for (uint32_t j = 0; j < uint32_t(scene_nodes.size()); ++j) {
+				if (scene_node_moved[j] && scene_nodes[j].object_instance != -1U) moved_instances.emplace_back(scene_nodes[j].object_instance);
 			}
-		} else if (driver.interpolation == S72::Driver::Interpolation::SLERP) {
-			// TODO: the output value in the middle of a time interval is a "spherical linear interpolation" between the starting and ending values. 
-			// (Doesn't make sense for 1D signals or non-normalized signals.)
-			size_t start_i = (i - 1) * (driver.channel == S72::Driver::Channel::rotation ? 4 : 3);
-			size_t end_i = i * (driver.channel == S72::Driver::Channel::rotation ? 4 : 3);
-
-			float t = (time - driver.times[i-1]) / (driver.times[i] - driver.times[i-1]); // normalized time in [0, 1]
-			if (driver.channel == S72::Driver::Channel::translation) {
-				driver.node.translation = S72::vec3{
-					.x = (1.0f - t) * driver.values[start_i + 0] + t * driver.values[end_i + 0],
-					.y = (1.0f - t) * driver.values[start_i + 1] + t * driver.values[end_i + 1],
-					.z = (1.0f - t) * driver.values[start_i + 2] + t * driver.values[end_i + 2],    
-				};
-			} else if (driver.channel == S72::Driver::Channel::rotation) {
-				glm::quat q_start{ driver.values[start_i + 0], driver.values[start_i + 1], driver.values[start_i + 2], driver.values[start_i + 3] };
-				glm::quat q_end{ driver.values[end_i + 0], driver.values[end_i + 1], driver.values[end_i + 2], driver.values[end_i + 3] };
-				glm::quat q_interp = glm::slerp(q_start, q_end, t);
-				driver.node.rotation = S72::quat{   
-					.x = q_interp.x,
-					.y = q_interp.y,
-					.z = q_interp.z,
-					.w = q_interp.w, 
-				};
-			} else if (driver.channel == S72::Driver::Channel::scale) {
-				driver.node.scale = S72::vec3{
-					.x = (1.0f - t) * driver.values[start_i + 0] + t * driver.values[end_i + 0],
-					.y = (1.0f - t) * driver.values[start_i + 1] + t * driver.values[end_i + 1],
-					.z = (1.0f - t) * driver.values[start_i + 2] + t * driver.values[end_i + 2],   
-				};
+		}
+		return;
+	}
+
+	uint32_t i = 0;
+	while (i < scene_nodes.size()) {
+		if (!scene_nodes[i].dirty) {
+			++i;
+			continue;
+		}
+
+		// everything below a dirty node needs a new world transform, clean or not:
+		uint32_t end = scene_nodes[i].subtree_end;
+		for (uint32_t j = i; j < end; ++j) {
+			SceneNode &sn = scene_nodes[j];
+			if (sn.dirty) {
+				// 2. build local TRS = Translation * Rotation * Scale
+				S72::Node const &node = *sn.node;
+				sn.LOCAL = translate(node.translation) * rotation_from_quat(node.rotation) * scale(node.scale);
+				sn.dirty = false;
 			}
+			// child's world = parent_world × local (parent was already updated, since it comes earlier in preorder)
+			if (sn.parent == -1U) sn.WORLD_FROM_LOCAL = sn.LOCAL;
+			else sn.WORLD_FROM_LOCAL = scene_nodes[sn.parent].WORLD_FROM_LOCAL * sn.LOCAL;
+
+			place(sn);
+			if (sn.object_instance != -1U && culling_mode == CullingMode::BVH) moved_instances.emplace_back(sn.object_instance);
 		}
+		i = end;
 	}
 }
 
+// where a driver is at 'time': mix values k0 and k1 by t
+// (clamped to the first/last value outside the keyframes; STEP holds the value from the start of the interval):
+struct DriverKeys {
+	size_t k0, k1;
+	float t;
+};
+static DriverKeys driver_keys(S72::Driver &driver, float time) {
+	size_t k0 = driver.seek(time);
+	size_t k1 = std::min(k0 + 1, driver.times.size() - 1);
+	float span = driver.times[k1] - driver.times[k0];
+	float t = (span > 0.0f ? std::clamp((time - driver.times[k0]) / span, 0.0f, 1.0f) : 0.0f);
+	if (driver.interpolation == S72::Driver::Interpolation::STEP) t = 0.0f;
+	return DriverKeys{ .k0 = k0, .k1 = k1, .t = t };
+}
+
+// evaluate each driver's state at 'time' and write into driver.node.translation/rotation/scale based on driver.values
+void Tutorial::evaluate_drivers(float time) {
+	for_each_chunk(animation_pool.get(), driver_groups.size(), 64, [&](size_t first, size_t last) {
+		for (size_t g = first; g < last; ++g) {
+			DriverGroup const &group = driver_groups[g];
+			S72::Node &node = *group.node;
+			bool moved = false; // the node only gets marked dirty if a driver actually moved it
+
+			// translation and scale: 3-vectors, mixed linearly (SLERP doesn't make sense for them, so it is linear too):
+			for (auto [drivers, channel] : std::array< std::pair< std::vector< S72::Driver * > const *, S72::vec3 S72::Node::* >, 2 >{
+				std::pair{ &group.translation, &S72::Node::translation },
+				std::pair{ &group.scale, &S72::Node::scale },
+			}) {
+				for (S72::Driver *driver : *drivers) {
+					DriverKeys keys = driver_keys(*driver, time);
+					float const *a = driver->values.data() + 3 * keys.k0;
+					float const *b = driver->values.data() + 3 * keys.k1;
+					S72::vec3 value{
+						.x = (1.0f - keys.t) * a[0] + keys.t * b[0],
+						.y = (1.0f - keys.t) * a[1] + keys.t * b[1],
+						.z = (1.0f - keys.t) * a[2] + keys.t * b[2],
+					};
+					S72::vec3 &current = node.*channel;
+					if (std::memcmp(&current, &value, sizeof(value)) != 0) {
+						current = value;
+						moved = true;
+					}
+				}
+			}
+
+			// rotation: quaternions, mixed linearly or slerped:
+			for (S72::Driver *driver : group.rotation) {
+				DriverKeys keys = driver_keys(*driver, time);
+				float const *a = driver->values.data() + 4 * keys.k0;
+				float const *b = driver->values.data() + 4 * keys.k1;
+				S72::quat value;
+				if (driver->interpolation == S72::Driver::Interpolation::SLERP) {
+					glm::quat q = glm::slerp(glm::quat{ a[0], a[1], a[2], a[3] }, glm::quat{ b[0], b[1], b[2], b[3] }, keys.t);
+					value = S72::quat{ .x = q.x, .y = q.y, .z = q.z, .w = q.w };
+				} else {
+					value = S72::quat{
+						.x = (1.0f - keys.t) * a[0] + keys.t * b[0],
+						.y = (1.0f - keys.t) * a[1] + keys.t * b[1],
+						.z = (1.0f - keys.t) * a[2] + keys.t * b[2],
+						.w = (1.0f - keys.t) * a[3] + keys.t * b[3],
+					}; // TODO: check - would this linear mix work for rotation?
+				}
+				if (std::memcmp(&node.rotation, &value, sizeof(value)) != 0) {
+					node.rotation = value;
+					moved = true;
+				}
+			}
+
+			if (moved && group.scene_nodes) {
+				for (uint32_t index : *group.scene_nodes) {
+					scene_nodes[index].dirty = true;
+				}
+			}
+		}
+	});
+}
+
 void Tutorial::update(float dt) {
 	time  = std::fmod(time + dt, 60.0f);
 	if (animation_playing) {
@@ -1428,9 +2645,7 @@ void Tutorial::update(float dt) {
 			// TODO: in headless mode, using the times from the AVAILABLE events.
 		}
 
-		for (S72::Driver& driver : s72.drivers) {
-			evaluate_driver(driver, animation_time);
-		}
+		evaluate_drivers(animation_time);
 	}
 
 	auto push_edge = [&](vec3 a, vec3 b,
@@ -1446,160 +2661,10 @@ void Tutorial::update(float dt) {
 		});
 	};
 
-	{ // add each s72 mesh to object_instances (previously create some objects: sphere surrounded by rotating torus)
-		// TODO: think about - can we move this chunk outside of update? is it necessary to re-traverse the tree and re-create object instances every frame?
-		object_instances.clear();
-		scene_camera_instances.clear();
-
-		// 1. traverse the scene graph from root; "roots" is an optional array of references to nodes at which to start drawing the scene.
-
-		// 2. Building Local Transform from node's TRS (Translation, Rotation Scale: local = Translation × Rotation × Scale      
-		// Where: Translation = mat4 with (tx, ty, tz) in last column; Rotation = quaternion (x,y,z,w) → 3x3 rotation matrix; Scale = diagonal mat4 with (sx, sy, sz, 1)  
-
-		// TODO: clean up
-		// helper: make translation matrix from S72::vec3
-		auto translate = [](S72::vec3 const &t) -> mat4 {
-			return mat4{
-				1.0f, 0.0f, 0.0f, 0.0f,
-				0.0f, 1.0f, 0.0f, 0.0f,
-				0.0f, 0.0f, 1.0f, 0.0f,
-				t.x,  t.y,  t.z,  1.0f,
-			};
-		};
-
-		// helper: scale matrix
-		auto scale = [](S72::vec3 const &s) -> mat4 {
-			return mat4{
-				s.x, 0.0f, 0.0f, 0.0f,
-				0.0f, s.y, 0.0f, 0.0f,
-				0.0f, 0.0f, s.z, 0.0f,
-				0.0f, 0.0f, 0.0f, 1.0f,
-			};
-		};
-
-		// helper: rotation matrix from quaternion (column-major)
-		auto rotation_from_quat = [](S72::quat const &q) -> mat4 {
-			float x = q.x, y = q.y, z = q.z, w = q.w;
-			float xx = x * x, yy = y * y, zz = z * z;
-			float xy = x * y, xz = x * z, yz = y * z;
-			float wx = w * x, wy = w * y, wz = w * z;
-			// 3x3 rotation
-			float m00 = 1.0f - 2.0f * (yy + zz);
-			float m01 = 2.0f * (xy - wz);
-			float m02 = 2.0f * (xz + wy);
-
-			float m10 = 2.0f * (xy + wz);
-			float m11 = 1.0f - 2.0f * (xx + zz);
-			float m12 = 2.0f * (yz - wx);
-
-			float m20 = 2.0f * (xz - wy);
-			float m21 = 2.0f * (yz + wx);
-			float m22 = 1.0f - 2.0f * (xx + yy);
-
-			return mat4{
-				m00, m10, m20, 0.0f,
-				m01, m11, m21, 0.0f,
-				m02, m12, m22, 0.0f,
-				0.0f,0.0f,0.0f,1.0f,
-			};
-		};
-
-		// helper: transpose a mat4
-		auto transpose = [](mat4 const &A) -> mat4 {
-			mat4 R;
-			for (int c = 0; c < 4; ++c) for (int r = 0; r < 4; ++r) R[c*4 + r] = A[r*4 + c];
-			return R;
-		};
-
-		// helper: inverse of an affine mat4 (bottom row = 0,0,0,1). If not invertible, returns identity.
-		auto inverse_affine = [](mat4 const &M) -> mat4 {
-			// Extract upper-left 3x3 (column-major)
-			float a00 = M[0], a10 = M[1], a20 = M[2];
-			float a01 = M[4], a11 = M[5], a21 = M[6];
-			float a02 = M[8], a12 = M[9], a22 = M[10];
-
-			// compute determinant
-			float det = a00*(a11*a22 - a12*a21) - a01*(a10*a22 - a12*a20) + a02*(a10*a21 - a11*a20);
-			if (std::fabs(det) < 1e-12f) return mat4_identity;
-			float invdet = 1.0f / det;
-
-			// inverse 3x3 = adjugate / det
-			float b00 =  (a11*a22 - a12*a21) * invdet;
-			float b01 = -(a01*a22 - a02*a21) * invdet;
-			float b02 =  (a01*a12 - a02*a11) * invdet;
-
-			float b10 = -(a10*a22 - a12*a20) * invdet;
-			float b11 =  (a00*a22 - a02*a20) * invdet;
-			float b12 = -(a00*a12 - a02*a10) * invdet;
-
-			float b20 =  (a10*a21 - a11*a20) * invdet;
-			float b21 = -(a00*a21 - a01*a20) * invdet;
-			float b22 =  (a00*a11 - a01*a10) * invdet;
-
-			// translation vector
-			float tx = M[12], ty = M[13], tz = M[14];
-
-			// invT = -invM * t
-			float itx = -(b00*tx + b01*ty + b02*tz);
-			float ity = -(b10*tx + b11*ty + b12*tz);
-			float itz = -(b20*tx + b21*ty + b22*tz);
-
-			mat4 R;
-			// column 0
-			R[0] = b00; R[1] = b10; R[2] = b20; R[3] = 0.0f;
-			// column 1
-			R[4] = b01; R[5] = b11; R[6] = b21; R[7] = 0.0f;
-			// column 2
-			R[8] = b02; R[9] = b12; R[10] = b22; R[11] = 0.0f;
-			// column 3 (translation)
-			R[12] = itx; R[13] = ity; R[14] = itz; R[15] = 1.0f;
-			return R;
-		};
-
-		// recursive traversal
-		std::function< void(S72::Node*, mat4 const &) > traverse = [&](S72::Node* node, mat4 const &parent_world) {
-			// build local TRS = Translation * Rotation * Scale
-			mat4 local = translate(node->translation) * rotation_from_quat(node->rotation) * scale(node->scale);
-			mat4 world = parent_world * local; // child's world = parent_world × local
-
-			if (node->mesh != nullptr) {
-				ObjectsPipeline::Transform tf;
-				tf.WORLD_FROM_LOCAL = world;
-				tf.CLIP_FROM_LOCAL = CLIP_FROM_WORLD * world;
-				tf.WORLD_FROM_LOCAL_NORMAL = transpose(inverse_affine(world));
-
-				// Determine texture index from material
-				uint32_t tex_index = 0; // default white texture
-				if (node->mesh->material != nullptr) {
-					auto it = material_albedo_map.find(node->mesh->material);
-					if (it != material_albedo_map.end()) {
-						tex_index = it->second;
-					}
-				}
-
-				object_instances.emplace_back(ObjectInstance{
-					.mesh = node->mesh,
-					.transform = tf,
-					.texture = tex_index,
-				});
-			}
-
-			if (node->camera != nullptr) {
-				scene_camera_instances.emplace_back(SceneCamera{
-					.camera = node->camera,
-					.WORLD_FROM_LOCAL = world,
-				});
-			}
-
-			for (S72::Node* child : node->children) {
-				traverse(child, world);
-			}
-		};
-
-		// start traversal from roots using identity as parent
-		for (S72::Node* root : s72.scene.roots) {
-			if (root) traverse(root, mat4_identity);
-		}
+	{ // refresh object_instances and scene_camera_instances from the cached scene graph (built once in build_scene_nodes)
+		// (nothing here depends on the camera; CLIP_FROM_WORLD is applied in objects.vert)
+		update_scene_nodes();
+		if (culling_mode == CullingMode::BVH) update_instance_bvh();
 	}
 
 	lines_vertices.clear();
@@ -4,8 +4,14 @@
 #include "PosNorTexVertex.hpp"
 #include "mat4.hpp"
 
+#include "BVH.hpp"
 #include "RTG.hpp"
 #include "S72.hpp"
+#include "ThreadPool.hpp"
+
+#include <array>
+#include <fstream>
+#include <memory>
 
 struct Tutorial : RTG::Application {
 
@@ -70,7 +76,7 @@ struct Tutorial : RTG::Application {
 		// descriptor set layouts:
 		VkDescriptorSetLayout set0_World = VK_NULL_HANDLE;
 		VkDescriptorSetLayout set1_Transforms;
-		VkDescriptorSetLayout set2_TEXTURE;
+		VkDescriptorSetLayout set2_TEXTURES = VK_NULL_HANDLE;
 
 		// types for descriptors:
 		struct World {
@@ -81,12 +87,20 @@ struct Tutorial : RTG::Application {
 		};
 		static_assert(sizeof(World) == 4*4 + 4*4 + 4*4 + 4*4, "World is the expected size.");
 
+		// same layout as LinesPipeline::Camera; bound as set0 binding 1 so the vertex shader can do CLIP_FROM_WORLD * WORLD_FROM_LOCAL
+		using Camera = LinesPipeline::Camera;
+
+		// only the camera-independent part lives per-instance, so moving the camera doesn't touch any instance:
 		struct Transform {
-			mat4 CLIP_FROM_LOCAL; // from object's local space to clip space, for gl_Position
 			mat4 WORLD_FROM_LOCAL; // from local positions to world space, for positions (lighting calculations); Where the object IS in the world (position + orientation)
 			mat4 WORLD_FROM_LOCAL_NORMAL; // for normals = transpose(inverse(WORLD_FROM_LOCAL))
+			uint32_t TEXTURE; // index into the TEXTURES array (set 2)
+			uint32_t padding_[3]; // (array elements of a struct holding a mat4 are 16-byte aligned)
 		};
-		static_assert(sizeof(Transform) == 16*4 + 16*4 + 16*4, "Transform is the expected size.");
+		static_assert(sizeof(Transform) == 16*4 + 16*4 + 4*4, "Transform is the expected size.");
+
+		// size of the TEXTURES array in the set layout (sets are allocated with just as many as the scene has):
+		static constexpr uint32_t MaxTextures = 4096;
 
 		// no push constants
 
@@ -102,41 +116,155 @@ struct Tutorial : RTG::Application {
 		void destroy(RTG &);
 	} objects_pipeline;
 
+	// compute pipeline for CullingMode::GPU and CullingMode::HiZ (see cull.comp):
+	struct CullPipeline {
+		// descriptor set layouts:
+		VkDescriptorSetLayout set0_Cull = VK_NULL_HANDLE;
+		VkDescriptorSetLayout set1_DepthPyramid = VK_NULL_HANDLE; // only with occlusion
+
+		// types for descriptors:
+		struct Cull {
+			mat4 CAMERA_FROM_WORLD;
+			float near_right, near_top, near_plane, far_plane; // CullingFrustum
+			mat4 OCCLUSION_CLIP_FROM_WORLD; // camera the depth pyramid was rendered with
+			float occlusion_viewport[4]; // (x, y, width, height) the depth pyramid was rendered with
+			uint32_t occlusion; // 1 if there is a depth pyramid to test against
+			float lod_pixels; // pixels covered by one unit of length one unit from the camera (select_lod's pixels_per_unit * distance)
+			float lod_tolerance; // 2^lod_bias
+			uint32_t padding_;
+		};
+		static_assert(sizeof(Cull) == 16*4 + 4*4 + 16*4 + 4*4 + 4*4, "Cull is the expected size.");
+
+		// counted by pass 0, read back once the frame is done:
+		struct Stats {
+			uint32_t frustum_culled;
+			uint32_t occlusion_culled;
+			uint32_t visible;
+			uint32_t lod_instances[S72::Mesh::MaxLODLevels]; // drawn at each level (just meshes that have levels of detail)
+			uint32_t lod_triangles[S72::Mesh::MaxLODLevels];
+		};
+		static_assert(sizeof(Stats) == 3*4 + 2*4*S72::Mesh::MaxLODLevels, "Stats is the expected size.");
+
+		// one per level of detail (just one if the mesh has none) of each mesh run of instance_draw_order;
+		// a run's levels are consecutive, and cull.comp picks one per instance (like Tutorial::select_lod):
+		struct Batch {
+			float bbox_min[4]; // xyz; w unused (std430 aligns vec3 to 16 bytes anyway)
+			float bbox_max[4];
+			uint32_t first_instance; // into the culled transforms (every level of a run has room for the whole run)
+			uint32_t group; // which draw count this batch's command is appended to
+			uint32_t first_command; // group's first command
+			uint32_t indexed;
+			uint32_t element_count; // index_count or vertex_count
+			uint32_t first_element; // first_index or first_vertex
+			int32_t vertex_offset; // first_vertex (indexed only)
+			uint32_t lod_count; // levels of detail of the mesh (0 if it has none); this batch's level is its distance from the run's first batch
+			float lod_error; // this level's error (local units)
+			uint32_t padding_[3];
+		};
+		static_assert(sizeof(Batch) == 4*4 + 4*4 + 12*4, "Batch is the expected size.");
+
+		// commands are written with the stride of the larger (indexed) kind, so both kinds can share a buffer:
+		static constexpr uint32_t CommandStride = sizeof(VkDrawIndexedIndirectCommand);
+		static constexpr uint32_t GroupSize = 64; // local_size_x in cull.comp
+
+		// push constants
+		struct Push {
+			uint32_t pass; // 0: cull instances, 1: write draw commands
+			uint32_t count; // instances (pass 0) or batches (pass 1)
+		};
+
+		VkPipelineLayout layout = VK_NULL_HANDLE;
+
+		VkPipeline handle = VK_NULL_HANDLE;
+
+		void create(RTG &, bool occlusion); // occlusion: test against the depth pyramid too (set1_DepthPyramid)
+		void destroy(RTG &);
+	} cull_pipeline;
+
+	// compute pipeline for CullingMode::HiZ (see depth_pyramid.comp); each dispatch reduces one level into the next:
+	struct DepthPyramidPipeline {
+		// descriptor set layouts:
+		VkDescriptorSetLayout set0_Reduce = VK_NULL_HANDLE;
+
+		static constexpr uint32_t GroupSize = 8; // local_size_x and local_size_y in depth_pyramid.comp
+
+		// no push constants
+
+		VkPipelineLayout layout = VK_NULL_HANDLE;
+
+		VkPipeline handle = VK_NULL_HANDLE;
+
+		void create(RTG &);
+		void destroy(RTG &);
+	} depth_pyramid_pipeline;
+
 	//pools from which per-workspace things are allocated:
 	VkCommandPool command_pool = VK_NULL_HANDLE;
 	VkDescriptorPool descriptor_pool = VK_NULL_HANDLE;
 
+	// --record-threads: threads that record the render pass's draws into the workspaces' recorders (null = record inline):
+	std::unique_ptr< ThreadPool > record_pool;
+	// --animation-threads: threads that evaluate drivers and propagate transforms in update() (null = do it inline, in preorder):
+	std::unique_ptr< ThreadPool > animation_pool;
+
 	//workspaces hold per-render resources:
 	struct Workspace {
 		VkCommandBuffer command_buffer = VK_NULL_HANDLE; //from the command pool above; reset at the start of every render.
 
-		// location for lines data: (streamed to GPU per-frame)
-		Helpers::AllocatedBuffer lines_vertices_src; // hose corehent; mapped
-		Helpers::AllocatedBuffer lines_vertices; //device-local
-		
-		// location for LinesPipeline::Camera data: (streamed to GPU per-frame)
-		Helpers::AllocatedBuffer Camera_src; // host coherent; mapped
-		Helpers::AllocatedBuffer Camera; // device-local
-		VkDescriptorSet Camera_descriptors; // references Camera
-
-		// location for ObjectsPipeline::World data: (streamed to GPU per-frame)
-		Helpers::AllocatedBuffer World_src; // host coherent; mapped
-		Helpers::AllocatedBuffer World; // device-local
-		VkDescriptorSet World_descriptors; // the descriptor set, references World
-		
-		// we'll need a descriptor set and a buffer to point it at.
-		// We'll stream the transformations per-frame, so we'll define them per workspace
-		// location for ObjectsPipeline::Transforms data: (streamed to GPU per-frame)
-		Helpers::AllocatedBuffer Transforms_src; // host coherent; mapped
-		Helpers::AllocatedBuffer Transforms; // device-local
-		VkDescriptorSet Transforms_descriptors; // references Transforms, the descriptor set
+		// with a record_pool, the render pass's draws are split into chunks recorded in parallel, one secondary command buffer each.
+		// Command pools can't be used from two threads at once, so every chunk has its own (reset at the start of every render):
+		struct Recorder {
+			VkCommandPool command_pool = VK_NULL_HANDLE;
+			VkCommandBuffer command_buffer = VK_NULL_HANDLE; // secondary; from command_pool
+		};
+		std::vector< Recorder > recorders; // record_pool->size() of them (empty without a record_pool)
+
+		// all per-frame data (lines vertices, Camera, World, Transforms) is written straight into this one buffer,
+		// which stays mapped and is read by the GPU in place -- no staging copies or transfer barriers.
+		// The workspace's previous frame is done by the time render() reuses it, so the arena restarts at 0 every frame:
+		Helpers::AllocatedBuffer frame_data; // frame_data_properties memory; mapped
+		VkDeviceSize frame_data_head = 0; // next free byte in frame_data this frame
+
+		// descriptor sets point at frame_data with dynamic offsets, so they only need re-writing when frame_data is re-allocated:
+		VkDescriptorSet Camera_descriptors; // LinesPipeline set0: Camera
+		VkDescriptorSet World_descriptors; // ObjectsPipeline set0: World (binding 0) and Camera (binding 1)
+		VkDescriptorSet Transforms_descriptors; // ObjectsPipeline set1: Transforms
+		VkDeviceSize Transforms_range = 0; // storage buffer range Transforms_descriptors was written with (dynamic descriptors have a fixed range)
+
+		// CullingMode::GPU only; written by cull.comp every frame, sized for every instance / batch in the scene:
+		VkDescriptorSet Cull_descriptors = VK_NULL_HANDLE; // CullPipeline set0
+		VkDescriptorSet culled_Transforms_descriptors = VK_NULL_HANDLE; // ObjectsPipeline set1, pointing at culled_transforms
+		Helpers::AllocatedBuffer culled_transforms; // visible instances' Transforms, packed per batch
+		Helpers::AllocatedBuffer draw_commands; // CullPipeline::CommandStride bytes per batch, packed per group
+		Helpers::AllocatedBuffer draw_counts; // uint32_t per group: commands written
+		Helpers::AllocatedBuffer batch_visible; // uint32_t per batch: instances that survived
+		Helpers::AllocatedBuffer cull_stats; // CullPipeline::Stats; mapped, so render() can read the counts once this workspace's frame is done
+		bool cull_stats_pending = false; // cull_stats holds counts from a frame that haven't been read yet
+
+		// --gpu-profile only; read back (without waiting) the next time render() uses this workspace:
+		VkQueryPool timestamps = VK_NULL_HANDLE; // GPUPhaseCount + 1 timestamps: before every phase, and after the last one
+		VkQueryPool statistics = VK_NULL_HANDLE; // one VK_QUERY_TYPE_PIPELINE_STATISTICS query around the render pass (if the device has them)
+		bool profile_pending = false; // the queries hold results from a frame that haven't been read yet
 	};
 	std::vector< Workspace > workspaces;
 
+	// per-frame data goes in HOST_VISIBLE | DEVICE_LOCAL memory (resizable BAR) when the device has it, plain host memory otherwise:
+	VkMemoryPropertyFlags frame_data_properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	VkDeviceSize uniform_offset_alignment = 1; // minUniformBufferOffsetAlignment
+	VkDeviceSize storage_offset_alignment = 1; // minStorageBufferOffsetAlignment
+
+	// make sure workspace.frame_data can hold at least 'bytes' (grows geometrically; re-writes descriptors when it does):
+	void reserve_frame_data(Workspace &workspace, VkDeviceSize bytes);
+	// point workspace's descriptor sets at frame_data (Transforms range covering 'transforms_bytes'):
+	void write_frame_descriptors(Workspace &workspace, VkDeviceSize transforms_bytes);
+	// bump-allocate from workspace.frame_data; returns the offset:
+	VkDeviceSize frame_alloc(Workspace &workspace, VkDeviceSize bytes, VkDeviceSize alignment);
+
 	//-------------------------------------------------------------------
 	//static scene resources:
 
 	Helpers::AllocatedBuffer object_vertices; // why don't we want this to be per workspace? why are lines_vertices per workspace //vv because objects are static, can share among workspaces
+	Helpers::AllocatedBuffer object_indices; // pooled uint32_t indices for indexed meshes (S72::indices); empty if no mesh is indexed
 	// struct ObjectVertices {
 	// 	uint32_t first = 0;
 	// 	uint32_t count = 0;
@@ -147,10 +275,10 @@ struct Tutorial : RTG::Application {
 	std::vector< Helpers::AllocatedImage > textures; // holds actual image data
 	std::vector< VkImageView > texture_views;
 	VkSampler texture_sampler = VK_NULL_HANDLE; // gives the sampler state (wrapping, interpolation, etc)
-	VkDescriptorPool texture_descriptor_pool = VK_NULL_HANDLE; // from which we allocate texture descriptor sets
-	std::vector< VkDescriptorSet > texture_descriptors; // allocated from texture_descriptor_pool; includes a descriptor for each of our textures.
-	std::unordered_map< S72::Texture*, uint32_t > texture_index_map; // maps S72 texture pointers to texture indices
-	std::unordered_map< S72::Material*, uint32_t > material_albedo_map; // maps materials to their albedo texture index
+	VkDescriptorPool texture_descriptor_pool = VK_NULL_HANDLE; // (update-after-bind) from which TEXTURES_descriptors is allocated
+	VkDescriptorSet TEXTURES_descriptors = VK_NULL_HANDLE; // ObjectsPipeline set2: a descriptor for each of our textures, indexed by Transform::TEXTURE
+	std::vector< uint32_t > s72_texture_indices; // by S72::TextureHandle: index into textures (0, default white, if the image didn't load)
+	std::vector< uint32_t > material_albedo_indices; // by S72::MaterialHandle: index into textures of the material's albedo
 
 	//--------------------------------------------------------------------
 	//Resources that change when the swapchain is resized:
@@ -163,6 +291,22 @@ struct Tutorial : RTG::Application {
 	//used from on_swapchain and the destructor: (framebuffers are created in on_swapchain)
 	void destroy_framebuffers();
 
+	// CullingMode::HiZ: farthest-depth pyramid of the last frame's depth buffer, built at the end of every frame.
+	// Level 0 is half the size of the depth buffer, rounded down (odd edge rows/columns are folded into the last texel); levels halve down to 1x1. Kept in VK_IMAGE_LAYOUT_GENERAL:
+	Helpers::AllocatedImage depth_pyramid; // R32_SFLOAT
+	VkImageView depth_pyramid_view = VK_NULL_HANDLE; // every level (read by cull.comp)
+	std::vector< VkImageView > depth_pyramid_level_views; // one per level (written and then read by depth_pyramid.comp)
+	VkSampler depth_pyramid_sampler = VK_NULL_HANDLE; // nearest, clamped (the shaders only use texelFetch)
+	VkDescriptorPool depth_pyramid_descriptor_pool = VK_NULL_HANDLE; // re-created along with the pyramid
+	std::vector< VkDescriptorSet > depth_pyramid_reduce_descriptors; // DepthPyramidPipeline set0, one per level
+	VkDescriptorSet depth_pyramid_descriptors = VK_NULL_HANDLE; // CullPipeline set1
+	bool depth_pyramid_built = false; // false until the first frame after (re)creation has filled it in
+	mat4 depth_pyramid_CLIP_FROM_WORLD = mat4_identity; // the camera and viewport the pyramid was rendered with
+	float depth_pyramid_viewport[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+	//used from on_swapchain (after the depth image exists) and the destructor:
+	void create_depth_pyramid();
+	void destroy_depth_pyramid();
+
 	//--------------------------------------------------------------------
 	//Resources that change when time passes or the user interacts:
 
@@ -180,13 +324,80 @@ struct Tutorial : RTG::Application {
 	float animation_time = 0.0f; // current playback position (seconds)
 	bool animation_playing = true;
 
-	void evaluate_driver(S72::Driver& driver, float t);
+	// drivers grouped by the node they drive (in order of each node's first driver), built by build_scene_nodes().
+	// Groups touch nothing another group does, so they can be evaluated in parallel (--animation-threads);
+	// within a group, each channel's drivers are evaluated by one loop in file order, so a later driver still wins:
+	struct DriverGroup {
+		S72::Node *node;
+		std::vector< uint32_t > const *scene_nodes; // scene_node_indices entry of node: marked dirty when it moves (null if unreachable)
+		std::vector< S72::Driver * > translation, rotation, scale;
+	};
+	std::vector< DriverGroup > driver_groups;
+	void evaluate_drivers(float t); // pose every driven node at animation time t
 
 	// -- camera & culling --
 	enum class CullingMode {
 		None = 0,
 		Frustum = 1,
+		GPU = 2, // frustum culling in a compute shader, drawn with vkCmdDraw*IndirectCount
+		BVH = 3, // frustum culling through instance_bvh, so off-screen subtrees are rejected in one test
+		HiZ = 4, // GPU culling, plus occlusion culling against the depth pyramid of the previous frame
 	} culling_mode = CullingMode::None; 
+	bool gpu_culling() const { return culling_mode == CullingMode::GPU || culling_mode == CullingMode::HiZ; }
+
+	// GPU culling counts (from the workspaces' cull_stats), summed since the last report:
+	struct GPUCullStats {
+		uint32_t frames = 0;
+		uint64_t frustum_culled = 0;
+		uint64_t occlusion_culled = 0;
+		uint64_t visible = 0;
+	} gpu_cull_stats;
+	float gpu_cull_report_time = 0.0f;
+
+	// --gpu-profile: the frame's commands are split into phases, with a timestamp written between each:
+	enum GPUPhase : uint32_t {
+		GPUPhaseCull, // culling compute shader (and the clears before it); empty unless culling on the GPU
+		GPUPhaseBackground, // start of the render pass (attachment clears) and the background
+		GPUPhaseLines,
+		GPUPhaseObjects,
+		GPUPhaseDepthPyramid, // empty unless --culling hiz
+		GPUPhaseCount
+	};
+	static constexpr std::array< char const *, GPUPhaseCount > GPUPhaseNames{ "cull", "background", "lines", "objects", "depth_pyramid" };
+	bool gpu_profiling = false; // --gpu-profile, and the graphics queue has timestamps
+	bool pipeline_statistics = false; // also counting invocations (needs the pipelineStatisticsQuery feature, and inheritedQueries with --record-threads)
+	static constexpr VkQueryPipelineStatisticFlags GPUProfileStatistics = // (results come back in bit order: vertex, clipping, fragment)
+		VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT
+		| VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT
+		| VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+	double timestamp_period = 1.0; // nanoseconds per timestamp tick
+	uint64_t timestamp_mask = ~0ull; // timestampValidBits of the graphics queue family
+	struct GPUProfile {
+		uint32_t frames = 0;
+		std::array< double, GPUPhaseCount > phase_ms{};
+		double total_ms = 0.0;
+		uint64_t vertex_invocations = 0;
+		uint64_t clipping_primitives = 0; // primitives that reached clipping
+		uint64_t fragment_invocations = 0;
+	} gpu_profile; // summed since last report
+	float gpu_profile_report_time = 0.0f;
+	uint64_t gpu_profile_frames = 0; // frames read back so far (the CSV's frame column)
+	std::ofstream gpu_profile_csv; // --gpu-profile-csv; one line per frame
+	void read_gpu_profile(Workspace &workspace); // adds workspace's last frame to gpu_profile (and the CSV)
+
+	// CullingMode::BVH: world-space boxes of object_instances (item i = object_instances[i]);
+	// built on the first update() and refit for the instances update_scene_nodes() moves:
+	BVH instance_bvh;
+	std::vector< uint32_t > moved_instances; // instances whose transforms changed since the last refit
+	void update_instance_bvh();
+	std::vector< uint8_t > instance_visible; // by object_instances index, filled by render() each frame
+	struct BVHStats {
+		uint32_t frames = 0;
+		uint64_t nodes_tested = 0; // BVH nodes classified against the frustum
+		uint64_t instances_tested = 0; // instances that still needed their own test (leaves straddling the frustum)
+		uint64_t instances_visible = 0;
+	} bvh_stats; // summed since last report
+	float bvh_report_time = 0.0f;
 
 	// Credit: adapted from More (Robust) Frustum Culling by Bruno Opsenica
 	struct CullingFrustum {
@@ -249,6 +460,66 @@ struct Tutorial : RTG::Application {
 	};
 	std::vector< ObjectInstance > object_instances;
 
+	// indices into object_instances, sorted by (indexed-ness, mesh, texture); none of these change after build_scene_nodes(), so this is sorted once there.
+	// render() walks instances in this order so that runs sharing a mesh become a single instanced draw (each instance picks its own texture):
+	std::vector< uint32_t > instance_draw_order;
+
+	// one instanced draw: instance_count visible instances of mesh, whose Transforms are contiguous starting at first_instance:
+	struct DrawBatch {
+		S72::Mesh *mesh = nullptr;
+		uint32_t lod = 0; // index into mesh->lods (if it has any)
+		uint32_t first_instance = 0;
+		uint32_t instance_count = 0;
+	};
+	std::vector< DrawBatch > draw_batches; // rebuilt every frame by render(), after culling
+
+	// level of detail: the coarsest of the mesh's lods whose error, at this instance's distance from the culling camera, covers
+	// at most 2^lod_bias pixels (measured at the point of the instance's bounding sphere nearest the camera):
+	uint32_t select_lod(ObjectInstance const &inst) const;
+	std::array< std::vector< uint32_t >, S72::Mesh::MaxLODLevels > lod_instances; // scratch for render(): one run's visible instances, by level
+	struct LODStats {
+		uint32_t frames = 0;
+		std::array< uint64_t, S72::Mesh::MaxLODLevels > instances{}; // drawn at each level
+		std::array< uint64_t, S72::Mesh::MaxLODLevels > triangles{};
+	} lod_stats; // summed since last report
+	float lod_report_time = 0.0f;
+
+	// CullingMode::GPU: batches cover *every* instance (the compute shader decides how many of each get drawn),
+	// so they are built once along with the scene. Batches of the same draw kind form a group,
+	// which is drawn with a single vkCmdDraw[Indexed]IndirectCount:
+	struct CullGroup {
+		bool indexed = false;
+		uint32_t first_batch = 0; // also the group's first command slot
+		uint32_t batch_count = 0; // max commands
+	};
+	std::vector< CullGroup > cull_groups;
+	uint32_t cull_batch_count = 0;
+	Helpers::AllocatedBuffer cull_batches; // CullPipeline::Batch per batch
+	Helpers::AllocatedBuffer cull_instance_batches; // uint32_t per instance (in instance_draw_order): its run's first (level 0) batch
+	uint32_t culled_count = 0; // room in each workspace's culled_transforms (more than the instance count when runs have several levels)
+	void build_cull_batches(); // (after build_scene_nodes) fills the above, creates the workspaces' culling buffers, and writes Cull_descriptors
+
+	// flattened scene graph, built once; cached transforms are only recomposed for dirty subtrees
+	struct SceneNode {
+		S72::Node *node = nullptr;
+		uint32_t parent = -1U; // index into scene_nodes, -1U for roots
+		uint32_t subtree_end = 0; // one past the last descendant; scene_nodes is in preorder, so the subtree is [this, subtree_end)
+		uint32_t object_instance = -1U; // index into object_instances if node has a mesh
+		uint32_t scene_camera_instance = -1U; // index into scene_camera_instances if node has a camera
+		mat4 LOCAL = mat4_identity; // cached Translation * Rotation * Scale
+		mat4 WORLD_FROM_LOCAL = mat4_identity; // cached parent WORLD_FROM_LOCAL * LOCAL
+		bool dirty = true; // node's TRS changed since LOCAL was last computed
+	};
+	std::vector< SceneNode > scene_nodes;
+	// with an animation_pool, update_scene_nodes() goes level by level instead (every parent is done before any of its children start):
+	std::vector< uint32_t > scene_levels; // scene_nodes indices, by depth (preorder within a depth)
+	std::vector< uint32_t > scene_level_begin; // scene_levels[scene_level_begin[d], scene_level_begin[d+1]) are the nodes at depth d
+	std::vector< uint8_t > scene_node_moved; // by scene_nodes index: WORLD_FROM_LOCAL was recomputed this update
+	std::vector< std::vector< uint32_t > > scene_node_indices; // by S72::NodeHandle: its scene_nodes entries (a node can be reached from several parents, so it may have several)
+
+	void build_scene_nodes(); // (re)builds scene_nodes, object_instances (+ instance_draw_order), scene_camera_instances, and the *_drivers groups
+	void update_scene_nodes(); // recomposes dirty subtrees and writes the results into the instances
+
 	std::vector< S72::Mesh > s72_meshes;
 
 	//--------------------------------------------------------------------
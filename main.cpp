@@ -3,6 +3,7 @@
 #include "S72.hpp"
 
 #include "Tutorial.hpp"
+#include "ThreadPool.hpp"
 
 #include <iostream>
 
@@ -13,26 +14,26 @@ void print_info(S72 &s72){
 	std::cout << "--- S72 Scene Objects ---"<< std::endl;
 	std::cout << "Scene: " << s72.scene.name << std::endl;
 	std::cout << "Roots: ";
-	for (S72::Node* root : s72.scene.roots) {
-		std::cout << root->name << ", ";
+	for (S72::NodeHandle root : s72.scene.roots) {
+		std::cout << s72[root].name << ", ";
 	}
 	std::cout << std::endl;
 
 	std::cout << "Nodes: ";
-	for (auto const& pair : s72.nodes) {
-		std::cout << pair.first << ", ";
+	for (S72::Node const& node : s72.nodes) {
+		std::cout << node.name << ", ";
 	}
 	std::cout << std::endl;
 
 	std::cout << "Meshes: ";
-	for (auto const& pair : s72.meshes) {
-		std::cout << pair.first << ", ";
+	for (S72::Mesh const& mesh : s72.meshes) {
+		std::cout << mesh.name << ", ";
 	}
 	std::cout << std::endl;
 
 	std::cout << "Cameras: ";
-	for (auto const& pair : s72.cameras) {
-		std::cout << pair.first << ", ";
+	for (S72::Camera const& camera : s72.cameras) {
+		std::cout << camera.name << ", ";
 	}
 	std::cout << std::endl;
 
@@ -43,54 +44,56 @@ void print_info(S72 &s72){
 	std::cout << std::endl;
 
 	std::cout << "Materials: ";
-	for (auto const& pair : s72.materials) {
-		std::cout << pair.first << ", ";
+	for (S72::Material const& material : s72.materials) {
+		std::cout << material.name << ", ";
 	}
 	std::cout << std::endl;
 
 	std::cout << "Environment: ";
-	for (auto const& pair : s72.environments) {
-		std::cout << pair.first << ", ";
+	for (S72::Environment const& environment : s72.environments) {
+		std::cout << environment.name << ", ";
 	}
 	std::cout << std::endl;
 
 	std::cout << "Lights: ";
-	for (auto const& pair : s72.lights) {
-		std::cout << pair.first << ", ";
+	for (S72::Light const& light : s72.lights) {
+		std::cout << light.name << ", ";
 	}
 	std::cout << std::endl;
 }
 
-void traverse_children(S72 &s72, S72::Node* node, std::string prefix){
+void traverse_children(S72 &s72, S72::NodeHandle handle, std::string prefix){
+	S72::Node const &node = s72[handle];
 	//Print node information
-	std::cout << prefix << node->name << ": {";
-	if(node->camera != nullptr){
-		std::cout << "Camera: " << node->camera->name;
+	std::cout << prefix << node.name << ": {";
+	if(node.camera){
+		std::cout << "Camera: " << s72[node.camera].name;
 	}
-	if(node->mesh != nullptr){
-		std::cout << "Mesh: " << node->mesh->name;
-		if(node->mesh->material != nullptr){
-			std::cout << " {Material: " <<node->mesh->material->name << "}";
+	if(node.mesh){
+		S72::Mesh const &mesh = s72[node.mesh];
+		std::cout << "Mesh: " << mesh.name;
+		if(mesh.material){
+			std::cout << " {Material: " << s72[mesh.material].name << "}";
 		}
 	}
-	if(node->environment != nullptr){
-		std::cout << "Environment: " << node->environment->name;
+	if(node.environment){
+		std::cout << "Environment: " << s72[node.environment].name;
 	}
-	if(node->light != nullptr){
-		std::cout << "Light: " << node->light->name;
+	if(node.light){
+		std::cout << "Light: " << s72[node.light].name;
 	}
 
 	std::cout << "}" <<std::endl;
 
 	std::string new_prefix = prefix + "- ";
-	for(S72::Node* child : node->children){
+	for(S72::NodeHandle child : node.children){
 		traverse_children(s72, child, new_prefix);
 	}
 }
 
 void print_scene_graph(S72 &s72){
 	std::cout << std::endl << "--- S72 Scene Graph ---"<< std::endl;
-	for (S72::Node* root : s72.scene.roots) {
+	for (S72::NodeHandle root : s72.scene.roots) {
 		std::cout << "Root: ";
 		std::string prefix = "";
 		traverse_children(s72, root, prefix);
@@ -132,9 +135,30 @@ int main(int argc, char **argv) {
 		// load s72 scene:
 		S72 s72;
 		try {
-			s72 = S72::load(configuration.scene_file);
-			s72.process_meshes(); // extract vertices from binary data
-			s72.process_textures(); // load texture images from disk
+			// a compiled copy of the processed scene skips parsing, mesh processing, and image decoding:
+			S72::CacheOptions cache_options{ .weld = configuration.weld_meshes, .lod_levels = configuration.lod_levels };
+			std::string cache_file = configuration.scene_file + "c";
+			std::optional< S72 > cached;
+			if (configuration.scene_cache && !configuration.rebuild_cache) {
+				cached = S72::load_cache(cache_file, cache_options);
+			}
+
+			if (cached) {
+				s72 = std::move(*cached);
+			} else {
+				ThreadPool pool(configuration.load_threads); // only needed while loading
+				s72 = S72::load(configuration.scene_file, &pool);
+				s72.process_meshes(configuration.weld_meshes, &pool, configuration.lod_levels); // extract vertices (and indices) from binary data
+				s72.process_textures(&pool); // load texture images from disk
+
+				if (configuration.scene_cache) {
+					try {
+						s72.save_cache(cache_file, configuration.scene_file, cache_options);
+					} catch (std::exception &e) {
+						std::cerr << "WARNING: couldn't write scene cache: " << e.what() << std::endl;
+					}
+				}
+			}
 		} catch (std::exception &e) {
 			// - e — the caught exception object
 			// - .what() — returns a const char* (C-string) containing the message passed when the exception was thrown
@@ -1,4 +1,5 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(set=0, binding=0, std140) uniform World {
     vec3 SKY_DIRECTION;
@@ -7,11 +8,12 @@ layout(set=0, binding=0, std140) uniform World {
     vec3 SUN_ENERGY; // energy supplied by sun to a surface patch with normal = SUN_DIRECTION
 };
 
-layout(set=2, binding=0) uniform sampler2D TEXTURE;
+layout(set=2, binding=0) uniform sampler2D TEXTURES[]; // every texture in the scene; bound once per frame
 
 layout(location=0) in vec3 position;
 layout(location=1) in vec3 normal;
 layout(location=2) in vec2 texCoord;
+layout(location=3) flat in uint textureIndex;
 
 layout(location = 0) out vec4 outColor;
 
@@ -22,7 +24,8 @@ void main() {
     // with lighting:
     // Basic hemispherical lighting equation in glsl syntax, where: n is the per-pixel normal (remember to normalize after interpolation!); texCoord is the interpolated texture coordinate; *_DIRECTION are uniforms giving the light directions; *_ENERGY are uniforms giving the light energy in appropriate units; ALBEDO is the albedo texture; and outColor is the value that gets written to the framebuffer.
     vec3 n = normalize(normal);
-    vec3 albedo = texture(TEXTURE, texCoord).rgb;
+    // (instances in one draw can use different textures, so the index isn't dynamically uniform)
+    vec3 albedo = texture(TEXTURES[nonuniformEXT(textureIndex)], texCoord).rgb;
     // hemisphere sky + directional sun TODO: understand this
     vec3 e = SKY_ENERGY * (0.5 * dot(n, SKY_DIRECTION) + 0.5)
            + SUN_ENERGY * max(0.0, dot(n, SUN_DIRECTION));
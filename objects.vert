@@ -1,9 +1,13 @@
 #version 450
 
+layout(set=0, binding=1, std140) uniform Camera {
+    mat4 CLIP_FROM_WORLD; // once per frame, so camera motion doesn't touch the per-instance transforms
+};
+
 struct Transform {
-    mat4 CLIP_FROM_LOCAL; // from object's local space to clip space
     mat4 WORLD_FROM_LOCAL; // from local positions to world space
     mat4 WORLD_FROM_LOCAL_NORMAL; // normals
+    uint TEXTURE; // index into TEXTURES (objects.frag)
 };
 
 layout(set=1, binding=0, std140) readonly buffer Transforms {
@@ -17,10 +21,13 @@ layout(location = 2) in vec2 TexCoord;
 layout(location = 0) out vec3 position; // lowercase variables for varyings (vertex shader outputs / fragment shader inputs)
 layout(location = 1) out vec3 normal;
 layout(location = 2) out vec2 texCoord;
+layout(location = 3) flat out uint textureIndex;
 
 void main() {
-    gl_Position = TRANSFORMS[gl_InstanceIndex].CLIP_FROM_LOCAL * vec4(Position, 1.0);
-    position = mat4x3(TRANSFORMS[gl_InstanceIndex].WORLD_FROM_LOCAL) * vec4(Position, 1.0);
+    vec4 world_position = TRANSFORMS[gl_InstanceIndex].WORLD_FROM_LOCAL * vec4(Position, 1.0);
+    gl_Position = CLIP_FROM_WORLD * world_position;
+    position = world_position.xyz;
     normal = mat3(TRANSFORMS[gl_InstanceIndex].WORLD_FROM_LOCAL_NORMAL) * Normal;
-    texCoord = TexCoord;
+    texCoord = vec2(TexCoord.x, 1.0 - TexCoord.y); // s72 texcoords have their origin at the bottom left; flip V here so vertex data can be used as stored
+    textureIndex = TRANSFORMS[gl_InstanceIndex].TEXTURE;
 }
\ No newline at end of file
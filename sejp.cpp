@@ -6,6 +6,7 @@
 #include <fstream>
 #include <sstream>
 #include <charconv>
+#include <algorithm>
 
 namespace sejp {
 
@@ -14,7 +15,7 @@ struct parsed {
 	std::vector< std::optional< double > > numbers;
 	//(nothing to store for booleans and nulls)
 	std::vector< std::optional< std::vector< value > > > arrays;
-	std::vector< std::optional< std::map< std::string, value > > > objects;
+	std::vector< std::optional< object > > objects;
 };
 
 enum Masks : uint32_t {
@@ -33,53 +34,43 @@ enum Types : uint32_t {
 	Empty   = 0xe0000000, //<--- used during parsing
 };
 
-value parse(std::istream &from) {
-	//helpers to read from string:
+void read(std::string_view text, handler &handler) {
+	//helpers to read from the text (a cursor walks it once; nothing is copied unless it has to be):
+	char const *at = text.data();
+	char const *const end = text.data() + text.size();
 
-	auto skip_wsp = [&from]() {
-		for(;;) {
-			std::istream::int_type c = from.peek();
-			if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
-				from.get();
-			} else {
-				break;
-			}
+	auto skip_wsp = [&]() {
+		while (at != end && (*at == ' ' || *at == '\t' || *at == '\n' || *at == '\r')) {
+			++at;
 		}
 	};
 
-	auto read_char = [&from]() -> char {
-		char c;
-		if (!from.get(c)) throw std::runtime_error("parse error: unexpected EOF.");
-		return c;
+	auto read_char = [&]() -> char {
+		if (at == end) throw std::runtime_error("parse error: unexpected EOF.");
+		return *at++;
+	};
+
+	auto peek = [&]() -> int {
+		return (at == end ? -1 : *at);
 	};
-	
-	auto read_exactly = [&read_char](std::string const &expect) {
+
+	auto read_exactly = [&read_char](std::string_view expect) {
 		for (auto e : expect) {
 			char c = read_char();
 			if (c != e) throw std::runtime_error(std::string("parse error: expected '") + e + "', got '" + c + "'.");
 		}
 	};
 
-	auto read_number = [&from,&read_char](char first) -> double {
-		std::string acc;
-		acc += first;
-	
+	auto read_number = [&](char first) -> double {
+		char const *begin = at - 1; //(first was already read)
+
 		if (first == '-') {
 			//advance to first digit:
 			first = read_char();
-			acc += first;
 		}
 
-		auto digits = [&acc,&from]() {
-			for(;;) {
-				std::istream::int_type p = from.peek();
-				if ('0' <= p && p <= '9') {
-					acc += char(p);
-					from.get();
-				} else {
-					break;
-				}
-			}
+		auto digits = [&]() {
+			while (at != end && '0' <= *at && *at <= '9') ++at;
 		};
 
 		if (first == '0') {
@@ -92,42 +83,44 @@ value parse(std::istream &from) {
 		}
 
 		//fraction:
-		if (from.peek() == '.') {
-			acc += read_char();
+		if (peek() == '.') {
+			++at;
 			char c = read_char();
 			if (!('0' <= c && c <= '9')) throw std::runtime_error(std::string("parse error: wanted fraction digits, got '") + c + "'.");
-			acc += c;
 			digits();
 		}
 
 		//exponent:
-		if (from.peek() == 'E' || from.peek() == 'e') {
-			acc += read_char();
-			if (from.peek() == '-' || from.peek() == '+') {
-				acc += read_char();
-			}
+		if (peek() == 'E' || peek() == 'e') {
+			++at;
+			if (peek() == '-' || peek() == '+') ++at;
 			char c = read_char();
 			if (!('0' <= c && c <= '9')) throw std::runtime_error(std::string("parse error: wanted exponent digits, got '") + c + "'.");
-			acc += c;
 			digits();
 		}
 
-		double val;
+		//[begin, at) is now a valid JSON number:
+		double val = 0.0;
 		#ifdef __APPLE__
 		//parse in the default locale
 		// -- based on https://www.reddit.com/r/cpp/comments/2e68nd/stdstod_is_locale_dependant_but_the_docs_does_not/
-		std::istringstream iss(acc);
+		std::istringstream iss(std::string(begin, at));
 		iss.imbue(std::locale("C"));
 		iss >> val;
 		#else
-		const char *begin = acc.data();
-		std::from_chars(begin, begin + acc.size(), val);
+		if (std::from_chars(begin, at, val).ec != std::errc()) {
+			throw std::runtime_error("parse error: number '" + std::string(begin, at) + "' is out of range.");
+		}
 		#endif
 		return val;
 	};
 
-	auto read_string = [&read_char]() -> std::string {
-		std::string ret;
+	auto read_string = [&]() -> std::string {
+		//common case: no escapes, so the whole string can be copied at once:
+		char const *begin = at;
+		while (at != end && *at != '"' && *at != '\\') ++at;
+		std::string ret(begin, at);
+
 		for (char c = read_char(); c != '"'; c = read_char()) {
 			if (c == '\\') {
 				//handle escapes:
@@ -179,117 +172,99 @@ value parse(std::istream &from) {
 		return ret;
 	};
 
-
 	//-------------------
-	//parsing:
-
-	std::shared_ptr< sejp::parsed > parsed = std::make_shared< sejp::parsed >();
+	//reading:
 
-	value root = value(parsed, -1U);
-	std::vector< uint32_t > parents; //containing maps/arrays
+	//open containers (true = object), and whether each has had a member yet:
+	struct Open {
+		bool object;
+		bool empty;
+	};
+	std::vector< Open > open;
+	bool have_root = false;
 
-	//overall parsing idea:
-	//value: (target is empty)
+	//overall reading idea:
+	//value:
 	// whitespace
-	//  set up next entry if target is object or array:
-	//    (only if) target is object:
-	//         '}' -> finish target, continue
+	//  set up next entry if inside an object or array:
+	//    (only if) in object:
+	//         '}' -> end object, continue
 	//         expect ',' if non-empty
-	//         '"' -> expect key, ':', push empty, fall through
-	//    (only if) target is array:
-	//         ']' -> finish target, continue
+	//         '"' -> key, expect ':', fall through
+	//    (only if) in array:
+	//         ']' -> end array, continue
 	//         expect ',' if non-empty
-	//         push empty, fall through
-	//  now target is empty, fill with value:
-	//  '{' -> key_or_object_end [new object, set target to object, continue]
-	//  '[' -> value_or_array_end [new array, set target to array, continue]
+	//         fall through
+	//  now read a value:
+	//  '{' -> begin object, continue
+	//  '[' -> begin array, continue
 	//   '"' -> string
 	//   '-', '0'-'9' -> number
 	//   't' -> bool ("true")
 	//   'f' -> bool ("false")
 	//   'n' -> null ("null")
-	//   finish target
 
-	while (root.index == -1U || !parents.empty()) {
+	while (!have_root || !open.empty()) {
 		skip_wsp();
 		char c = read_char(); //first character of value
 
-		//value to be filled in later:
-		value *target = nullptr;
-
-		//figure out which value to fill in:
-		if (parents.empty()) {
-			target = &root;
-		} else if ((parents.back() & TypeBits) == Object) {
+		if (open.empty()) {
+			have_root = true;
+		} else if (open.back().object) {
 			if (c == '}') {
-				parents.pop_back();
+				open.pop_back();
+				handler.end_object();
 				continue;
 			}
-			std::map< std::string, value > &map = parsed->objects.at( parents.back() & IndexBits ).value();
-			if (!map.empty()) {
+			if (!open.back().empty) {
 				//consume comma between entries:
 				if (c != ',') throw std::runtime_error("parse error: expected ',' between object members.");
 				skip_wsp();
 				c = read_char();
 			}
+			open.back().empty = false;
 			if (c != '"') throw std::runtime_error("parse error: expecting '\"' at start of key.");
-			std::string key = read_string();
+			handler.key(read_string());
 			skip_wsp();
 			c = read_char();
 			if (c != ':') throw std::runtime_error("parse error: expecting ':' after value.");
 			skip_wsp();
 			c = read_char(); //actual first character of value
-			auto ret = map.insert_or_assign(key, value(parsed, -1U));
-			target = &ret.first->second;
-			//(fall through to value-getting code)
-		} else if ((parents.back() & TypeBits) == Array) {
+			//(fall through to value-reading code)
+		} else {
 			if (c == ']') {
-				parents.pop_back();
+				open.pop_back();
+				handler.end_array();
 				continue;
 			}
-			std::vector< value > &array = parsed->arrays.at( parents.back() & IndexBits ).value();
-			if (!array.empty()) {
+			if (!open.back().empty) {
 				if (c != ',') throw std::runtime_error(std::string("parse error: expected ',' between array entries; got '") + c + "'.");
 				skip_wsp();
 				c = read_char(); //actual first character of value
 			}
-			array.emplace_back(parsed, -1U);
-			target = &array.back();
-			//(fall through to value-getting code)
+			open.back().empty = false;
+			//(fall through to value-reading code)
 		}
 
-		//actually fill in the value:
-		assert(target && (target->index & TypeBits) == Empty);
-
 		if        (c == '{') { //object
-			if (uint32_t(parsed->objects.size()) & ~IndexBits) throw std::runtime_error("parser error: too many objects.");
-			target->index = Object | uint32_t(parsed->objects.size());
-			parents.emplace_back(target->index);
-			parsed->objects.emplace_back(std::in_place);
-			continue;
+			open.emplace_back(Open{ .object = true, .empty = true });
+			handler.begin_object();
 		} else if (c == '[') { //array
-			if (uint32_t(parsed->arrays.size()) & ~IndexBits) throw std::runtime_error("parser error: too many arrays.");
-			target->index = Array | uint32_t(parsed->arrays.size());
-			parents.emplace_back(target->index);
-			parsed->arrays.emplace_back(std::in_place);
-			continue;
+			open.emplace_back(Open{ .object = false, .empty = true });
+			handler.begin_array();
 		} else if (c == '"') { //string
-			if (uint32_t(parsed->strings.size()) & ~IndexBits) throw std::runtime_error("parser error: too many strings.");
-			target->index = String | uint32_t(parsed->strings.size());
-			parsed->strings.emplace_back(read_string());
+			handler.string(read_string());
 		} else if (c == '-' || (c >= '0' && c <= '9')) { //number
-			if (uint32_t(parsed->numbers.size()) & ~IndexBits) throw std::runtime_error("parser error: too many numbers.");
-			target->index = Number | uint32_t(parsed->numbers.size());
-			parsed->numbers.emplace_back(read_number(c));
+			handler.number(read_number(c));
 		} else if (c == 't') { //true
 			read_exactly("rue");
-			target->index = True;
+			handler.boolean(true);
 		} else if (c == 'f') { //false
 			read_exactly("alse");
-			target->index = False;
+			handler.boolean(false);
 		} else if (c == 'n') { //null
 			read_exactly("ull");
-			target->index = Null;
+			handler.null();
 		} else {
 			throw std::runtime_error(std::string("parse error: value cannot start with '") + c + "'.");
 		}
@@ -297,9 +272,112 @@ value parse(std::istream &from) {
 
 	skip_wsp();
 
-	if (from.peek() != std::iostream::traits_type::eof()) throw std::runtime_error("parse error: trailing junk.");
+	if (at != end) throw std::runtime_error("parse error: trailing junk.");
+}
+
+//------------------------------------------
+//building values from read() events:
+
+builder::builder() : data(std::make_shared< parsed >()) {
+}
+
+builder::~builder() {
+}
+
+//where the next value goes (a new member of / entry in the innermost open container, or the root):
+value &builder::next() {
+	if (parents.empty()) {
+		if (root) throw std::runtime_error("sejp::builder: more than one root value.");
+		root.emplace(data.get(), -1U);
+		return *root;
+	} else if ((parents.back() & TypeBits) == Object) {
+		object &obj = data->objects[ parents.back() & IndexBits ].value();
+		obj.members.emplace_back(std::move(pending_key), value(data.get(), -1U));
+		return obj.members.back().second;
+	} else {
+		std::vector< value > &array = data->arrays[ parents.back() & IndexBits ].value();
+		array.emplace_back(data.get(), -1U);
+		return array.back();
+	}
+}
+
+void builder::begin_object() {
+	if (uint32_t(data->objects.size()) & ~IndexBits) throw std::runtime_error("parser error: too many objects.");
+	value &target = next();
+	target.index = Object | uint32_t(data->objects.size());
+	parents.emplace_back(target.index);
+	data->objects.emplace_back(std::in_place);
+}
+
+void builder::key(std::string &&key) {
+	pending_key = std::move(key);
+}
+
+//objects' members are appended as they are read, then sorted (and de-duplicated) when the object closes:
+void builder::end_object() {
+	object &obj = data->objects[ parents.back() & IndexBits ].value();
+	std::stable_sort(obj.members.begin(), obj.members.end(), [](object::member const &a, object::member const &b) {
+		return a.first < b.first;
+	});
+	//keep the last of any run of equal keys:
+	size_t out = 0;
+	for (size_t i = 0; i < obj.members.size(); ++i) {
+		if (i + 1 < obj.members.size() && obj.members[i + 1].first == obj.members[i].first) continue;
+		if (out != i) obj.members[out] = std::move(obj.members[i]);
+		++out;
+	}
+	obj.members.erase(obj.members.begin() + out, obj.members.end());
+	parents.pop_back();
+}
+
+void builder::begin_array() {
+	if (uint32_t(data->arrays.size()) & ~IndexBits) throw std::runtime_error("parser error: too many arrays.");
+	value &target = next();
+	target.index = Array | uint32_t(data->arrays.size());
+	parents.emplace_back(target.index);
+	data->arrays.emplace_back(std::in_place);
+}
+
+void builder::end_array() {
+	parents.pop_back();
+}
+
+void builder::string(std::string &&string) {
+	if (uint32_t(data->strings.size()) & ~IndexBits) throw std::runtime_error("parser error: too many strings.");
+	next().index = String | uint32_t(data->strings.size());
+	data->strings.emplace_back(std::move(string));
+}
+
+void builder::number(double number) {
+	if (uint32_t(data->numbers.size()) & ~IndexBits) throw std::runtime_error("parser error: too many numbers.");
+	next().index = Number | uint32_t(data->numbers.size());
+	data->numbers.emplace_back(number);
+}
+
+void builder::boolean(bool value) {
+	next().index = (value ? True : False);
+}
+
+void builder::null() {
+	next().index = Null;
+}
 
-	return root;
+bool builder::done() const {
+	return root && parents.empty();
+}
+
+document builder::take() {
+	assert(done());
+	document ret(data, root->index);
+	root.reset();
+	data = std::make_shared< parsed >();
+	return ret;
+}
+
+document parse(std::string_view text) {
+	builder builder;
+	read(text, builder);
+	return builder.take();
 }
 
 //------------------------------------------
@@ -355,8 +433,8 @@ std::optional< std::vector< value > > const &value::as_array() const {
 	}
 }
 
-std::optional< std::map< std::string, value > > const &value::as_object() const {
-	static std::optional< std::map< std::string, value > > const empty;
+std::optional< object > const &value::as_object() const {
+	static std::optional< object > const empty;
 	if ((index & TypeBits) == Object) {
 		return data->objects[index & IndexBits];
 	} else {
@@ -366,14 +444,46 @@ std::optional< std::map< std::string, value > > const &value::as_object() const
 
 //-------------------------------
 
-value load(std::string const &filename) {
-	std::ifstream in(filename, std::ios::binary);
-	return parse(in);
+object::iterator object::find(std::string_view key) {
+	auto f = std::lower_bound(members.begin(), members.end(), key, [](member const &m, std::string_view k) { return m.first < k; });
+	return (f != members.end() && f->first == key ? f : members.end());
+}
+
+object::const_iterator object::find(std::string_view key) const {
+	auto f = std::lower_bound(members.begin(), members.end(), key, [](member const &m, std::string_view k) { return m.first < k; });
+	return (f != members.end() && f->first == key ? f : members.end());
+}
+
+value &object::at(std::string_view key) {
+	auto f = find(key);
+	if (f == members.end()) throw std::out_of_range("sejp::object has no member \"" + std::string(key) + "\".");
+	return f->second;
+}
+
+value const &object::at(std::string_view key) const {
+	auto f = find(key);
+	if (f == members.end()) throw std::out_of_range("sejp::object has no member \"" + std::string(key) + "\".");
+	return f->second;
+}
+
+//-------------------------------
+
+//read the whole file at once (much cheaper than parsing through an istream a character at a time):
+static std::string slurp(std::string const &filename) {
+	std::ifstream in(filename, std::ios::binary | std::ios::ate);
+	if (!in) throw std::runtime_error("failed to open '" + filename + "'.");
+	std::string text(size_t(in.tellg()), '\0');
+	in.seekg(0);
+	if (!in.read(text.data(), text.size())) throw std::runtime_error("failed to read '" + filename + "'.");
+	return text;
+}
+
+document load(std::string const &filename) {
+	return parse(slurp(filename));
 }
 
-value parse(std::string const &string) {
-	std::istringstream in(string, std::ios::binary);
-	return parse(in);
+void read_file(std::string const &filename, handler &handler) {
+	read(slurp(filename), handler);
 }
 
 } //namespace sejp
\ No newline at end of file
@@ -5,22 +5,34 @@
 //then provides a generic "value" handle to the root.
 
 #include <string>
+#include <string_view>
 #include <vector>
-#include <map>
 #include <optional>
 #include <memory>
+#include <utility>
 #include <cstdint>
 
 namespace sejp {
 	//sejp::parsed represents the results of scanning a JSON file:
 	struct parsed;
-	
+
+	struct object;
+	struct document;
+
 	//generic value:
+	//  NOTE: values don't own the parsed data they refer to -- the sejp::document that load()/parse() returned does,
+	//        so keep that around for as long as you use any value from inside it
 	struct value {
 		//internals:
-		std::shared_ptr< parsed const > data;
+		parsed const *data;
 		uint32_t index; //(opaque) index data's value storage
-		value(std::shared_ptr< parsed const > const &data_, uint32_t index_) : data(data_), index(index_) { }
+		value(parsed const *data_, uint32_t index_) : data(data_), index(index_) { }
+
+		//copying a document into a plain value would drop the data it refers to, so don't:
+		value(value const &) = default;
+		value &operator=(value const &) = default;
+		value(document const &) = delete;
+		value &operator=(document const &) = delete;
 
 		//interface:
 		//  NOTE: these functions take O(1) time
@@ -29,14 +41,93 @@ namespace sejp {
 		std::optional< bool > const &as_bool() const;
 		std::optional< nullptr_t > const &as_null() const;
 		std::optional< std::vector< value > > const &as_array() const;
-		std::optional< std::map< std::string, value > > const &as_object() const;
+		std::optional< object > const &as_object() const;
+	};
+
+	//objects are stored flat, as (key, value) members sorted by key, instead of as a std::map;
+	//lookups are binary searches, and the interface is the subset of std::map's that loaders use:
+	//  NOTE: duplicate keys keep the last value (like std::map::insert_or_assign)
+	struct object {
+		using member = std::pair< std::string, value >;
+		using iterator = std::vector< member >::iterator;
+		using const_iterator = std::vector< member >::const_iterator;
+
+		std::vector< member > members;
+
+		iterator begin() { return members.begin(); }
+		iterator end() { return members.end(); }
+		const_iterator begin() const { return members.begin(); }
+		const_iterator end() const { return members.end(); }
+		size_t size() const { return members.size(); }
+		bool empty() const { return members.empty(); }
+
+		iterator find(std::string_view key);
+		const_iterator find(std::string_view key) const;
+		bool contains(std::string_view key) const { return find(key) != end(); }
+		value &at(std::string_view key); //throws std::out_of_range if missing
+		value const &at(std::string_view key) const;
+		iterator erase(const_iterator at) { return members.erase(at); }
+	};
+
+	//the root value of some parsed data, which it keeps alive:
+	//  (only the root holds the shared_ptr -- array entries and object members are stored inside the data, so they can't)
+	struct document : value {
+		std::shared_ptr< parsed const > storage;
+		document(std::shared_ptr< parsed const > const &storage_, uint32_t index_) : value(storage_.get(), index_), storage(storage_) { }
 	};
 
 	//how you make values:
 	//  NOTE: O(length of data) time, space.
-	//  NOTE: loaded data is retained via shared_ptr until values referring to it go out of scope
+	//  NOTE: loaded data is retained via shared_ptr until the returned document goes out of scope
 	//  NOTE: throws on parse error
-	value load(std::string const &filename);
-	value parse(std::string const &string);
+	document load(std::string const &filename); //(reads the whole file into memory, then parses that)
+	document parse(std::string_view text);
+
+	//event-driven ("SAX-style") reading, for callers that would rather build their own structures than keep values around:
+	//  NOTE: events arrive in document order; key() comes before each object member's value
+	//  NOTE: the text has been checked up to each event, so a handler can count on begin/end pairs matching
+	struct handler {
+		virtual ~handler() = default;
+		virtual void begin_object() = 0;
+		virtual void key(std::string &&key) = 0;
+		virtual void end_object() = 0;
+		virtual void begin_array() = 0;
+		virtual void end_array() = 0;
+		virtual void string(std::string &&string) = 0;
+		virtual void number(double number) = 0;
+		virtual void boolean(bool value) = 0;
+		virtual void null() = 0;
+	};
+
+	//  NOTE: throws on parse error (and passes along anything the handler throws)
+	void read(std::string_view text, handler &handler);
+	void read_file(std::string const &filename, handler &handler); //(reads the whole file into memory, then reads that)
+
+	//handler that builds a value from the events (parse() is read() into one of these);
+	//it can also be handed the events for just part of a document, one value at a time:
+	struct builder : handler {
+		builder();
+		virtual ~builder();
+
+		void begin_object() override;
+		void key(std::string &&key) override;
+		void end_object() override;
+		void begin_array() override;
+		void end_array() override;
+		void string(std::string &&string) override;
+		void number(double number) override;
+		void boolean(bool value) override;
+		void null() override;
+
+		bool done() const; //a whole value has been built
+		document take(); //hand over the built value (and the data behind it) and start fresh, so each document only keeps its own data alive
+
+	private:
+		std::shared_ptr< parsed > data;
+		std::optional< value > root;
+		std::vector< uint32_t > parents; //open objects/arrays (in the same opaque format as value::index)
+		std::string pending_key; //for the next member of the innermost open object
+		value &next();
+	};
 
-} //namespace sejp
\ No newline at end of file
+} //namespace sejp